@@ -4,81 +4,98 @@
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
 
+#include "ingress-filter.h"
+#include "packet-pool.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "spoof-generator.h"
+#include "watchpoint.h"
+
+#include <fstream>
+#include <sstream>
+
 using namespace ns3;
 
 /* ============================================================
- * TRUE INGRESS FILTER (DETECTION ONLY)
+ * TRUE INGRESS FILTER (ENFORCEMENT)
  * ============================================================ */
-static void IngressFilterRx (
+static bool g_verbose = false;
+
+static void IngressFilterDrop (
   Ptr<const Packet> packet,
-  Ptr<Ipv4> ipv4,
   uint32_t interface)
 {
-  // Only attacker-facing interface (router interface 1)
-  if (interface != 1)
-    return;
-
-  Ptr<Packet> p = packet->Copy ();
-  Ipv4Header ip;
-  if (!p->PeekHeader (ip))
-    return;
-
-  // Only UDP packets (our attacker traffic)
-  if (ip.GetProtocol () != 17)
-    return;
-
-  Ipv4Address src = ip.GetSource ();
-
-  // Ignore router-originated packets
-  if (ipv4->IsDestinationAddress (src, interface))
+  if (!g_verbose)
     return;
 
-  // Interface subnet
-  Ipv4InterfaceAddress ifAddr =
-      ipv4->GetAddress (interface, 0);
-
-  Ipv4Address ifaceSubnet =
-      ifAddr.GetLocal ().CombineMask (ifAddr.GetMask ());
-
-  // TRUE ingress filtering rule
-  if (src.CombineMask (ifAddr.GetMask ()) != ifaceSubnet)
-    {
-      std::cout << Simulator::Now ().GetSeconds ()
-                << "s  INGRESS FILTER: DETECTED spoofed packet from "
-                << src
-                << " on interface "
-                << interface
-                << std::endl;
-    }
+  uint8_t hdr[16];
+  packet->CopyData (hdr, sizeof (hdr));
+  Ipv4Address src;
+  src.Set ((uint32_t (hdr[12]) << 24) | (uint32_t (hdr[13]) << 16) |
+           (uint32_t (hdr[14]) << 8) | hdr[15]);
+
+  std::cout << Simulator::Now ().GetSeconds ()
+            << "s  INGRESS FILTER: DROPPED spoofed packet from "
+            << src
+            << " on interface "
+            << interface
+            << std::endl;
 }
 
 /* ============================================================
- * SEND SPOOFED PACKETS (RAW SOCKET)
+ * MAIN
  * ============================================================ */
-static void
-SendSpoofedPacket (
-  Ptr<Socket> socket,
-  Ipv4Address spoofedSrc,
-  Ipv4Address dst)
+int main (int argc, char *argv[])
 {
-  Ptr<Packet> pkt = Create<Packet> (512);
-
-  Ipv4Header ip;
-  ip.SetSource (spoofedSrc);
-  ip.SetDestination (dst);
-  ip.SetProtocol (17); // UDP
-  ip.SetPayloadSize (512);
-  ip.SetTtl (64);
+  std::string prefixFile = "";
+  double attackRate = 5;
+  uint32_t batchSize = 1;
+  std::string spoofMode = "List";
+  bool summary = false;
+  bool packetPool = false;
+  std::string watchList = "";
+  std::string resultCache = "";
+
+  CommandLine cmd;
+  cmd.AddValue ("verbose", "Print every dropped spoofed packet", g_verbose);
+  cmd.AddValue ("prefixFile",
+                "Extra allowed prefixes (a.b.c.d/len per line) for the attacker interface",
+                prefixFile);
+  cmd.AddValue ("attackRate", "Packets per second of each attack flow", attackRate);
+  cmd.AddValue ("batchSize", "Packets emitted per generator event", batchSize);
+  cmd.AddValue ("spoofMode",
+                "Sources of the filtered flow: List (10.1.2.10) or Random8",
+                spoofMode);
+  cmd.AddValue ("summary", "Print a machine-readable SUMMARY line with event throughput", summary);
+  cmd.AddValue ("packetPool", "Serve packet allocations from per-thread free lists", packetPool);
+  cmd.AddValue ("watch",
+                "Watchpoints, ';'-separated predicate[=value][:actions] with predicate "
+                "spoofedDrops=n and actions snapshot,quiet,stop",
+                watchList);
+  cmd.AddValue ("resultCache",
+                "Directory of cached results; a known configuration is not re-run (empty = off)",
+                resultCache);
+  cmd.Parse (argc, argv);
+
+  // The prefix file's name says nothing about its contents
+  ResultCache cache (resultCache);
+  if (!prefixFile.empty ())
+    {
+      std::ifstream in (prefixFile);
+      std::ostringstream prefixes;
+      prefixes << in.rdbuf ();
+      cache.Add ("prefixFile", prefixes.str ());
+    }
+  if (cache.Replay (argc, argv))
+    {
+      return 0;
+    }
 
-  pkt->AddHeader (ip);
-  socket->SendTo (pkt, 0, InetSocketAddress (dst, 9));
-}
+  if (packetPool)
+    {
+      PacketPool::Enable ();
+    }
 
-/* ============================================================
- * MAIN
- * ============================================================ */
-int main ()
-{
   NodeContainer nodes;
   nodes.Create (3); // 0=attacker, 1=router, 2=victim
 
@@ -107,46 +124,76 @@ int main ()
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
   /* Attach ingress filter to router */
-  Ptr<Ipv4> ipv4Router =
-      nodes.Get (1)->GetObject<Ipv4> ();
-      
- //It connects your function IngressFilterRx() to the router’s IPv4 receive event.So whenever any IPv4 packet is received by the router, your function is automatically called.
-  ipv4Router->TraceConnectWithoutContext (
-      "Rx",
-      MakeCallback (&IngressFilterRx));
-
-  /* RAW socket on attacker */
-  Ptr<Socket> raw =
-      Socket::CreateSocket (
-          nodes.Get (0),
-          Ipv4RawSocketFactory::GetTypeId ());
-
-  raw->SetAttribute ("Protocol", UintegerValue (17));
-  raw->SetAttribute ("IpHeaderInclude", BooleanValue (true));
-  raw->BindToNetDevice (d01.Get (0));
-
-  /* Schedule spoofed packets */
-  for (double t = 1.0; t <= 2.0; t += 0.2)
+  // Only the attacker-facing interface (router interface 1) is filtered:
+  // sources must belong to its own subnet or to a configured prefix.
+  Ptr<IngressFilter> filter = CreateObject<IngressFilter> ();
+  filter->AllowConnectedSubnets (nodes.Get (1), 1);
+  if (!prefixFile.empty ())
+    {
+      uint32_t loaded = filter->LoadPrefixes (1, prefixFile);
+      NS_ABORT_MSG_IF (loaded == 0, "No valid prefixes in " << prefixFile);
+      std::cout << "Loaded " << loaded << " prefixes from " << prefixFile << "\n";
+    }
+  filter->Install (nodes.Get (1));
+  filter->TraceConnectWithoutContext (
+      "Drop",
+      MakeCallback (&IngressFilterDrop));
+
+  /* Spoofed traffic generators on attacker */
+  // Same subnet spoof → allowed
+  Ptr<SpoofGenerator> allowed = CreateObject<SpoofGenerator> ();
+  allowed->SetAttribute ("Remote", Ipv4AddressValue (if12.GetAddress (1)));
+  allowed->SetAttribute ("PacketRate", DoubleValue (attackRate));
+  allowed->SetAttribute ("BatchSize", UintegerValue (batchSize));
+  allowed->SetAttribute ("SourceMode", StringValue ("SameSubnet"));
+  nodes.Get (0)->AddApplication (allowed);
+  allowed->SetStartTime (Seconds (1.0));
+  allowed->SetStopTime (Seconds (2.01));
+
+  // Different subnet spoof → dropped
+  Ptr<SpoofGenerator> spoofed = CreateObject<SpoofGenerator> ();
+  spoofed->SetAttribute ("Remote", Ipv4AddressValue (if12.GetAddress (1)));
+  spoofed->SetAttribute ("PacketRate", DoubleValue (attackRate));
+  spoofed->SetAttribute ("BatchSize", UintegerValue (batchSize));
+  spoofed->SetAttribute ("SourceMode", StringValue (spoofMode));
+  spoofed->AddSource (Ipv4Address ("10.1.2.10"));
+  nodes.Get (0)->AddApplication (spoofed);
+  spoofed->SetStartTime (Seconds (1.1));
+  spoofed->SetStopTime (Seconds (2.11));
+
+  // e.g. --watch="spoofedDrops=100:stop" ends the run once the filter has
+  // caught 100 spoofed packets
+  Watchpoints watch;
+  watch.SetSnapshot ([filter] (std::ostream &os) { filter->PrintCounters (os); });
+  watch.SetQuiet ([] () { g_verbose = false; });
+  for (const Watchpoints::Spec &w : Watchpoints::Parse (watchList))
     {
-      // Same subnet spoof → allowed
-      Simulator::Schedule (
-          Seconds (t),
-          &SendSpoofedPacket,
-          raw,
-          Ipv4Address ("10.1.1.10"),
-          if12.GetAddress (1));
-
-      // Different subnet spoof → detected
-      Simulator::Schedule (
-          Seconds (t + 0.1),
-          &SendSpoofedPacket,
-          raw,
-          Ipv4Address ("10.1.2.10"),
-          if12.GetAddress (1));
+      NS_ABORT_MSG_IF (w.predicate != "spoofedDrops", "Unknown watchpoint " << w.predicate);
+      watch.OnCount<Ptr<const Packet>, uint32_t> (filter, "Drop", uint64_t (w.value),
+                                                  "spoofedDrops")
+          .Then (w.actions);
     }
 
   Simulator::Stop (Seconds (3.0));
+  RunStats runStats;
+  runStats.Start ();
   Simulator::Run ();
+  runStats.Stop ();
+
+  std::cout << "Attack: " << allowed->GetSent () + spoofed->GetSent ()
+            << " packets in " << allowed->GetEvents () + spoofed->GetEvents ()
+            << " events\n";
+  filter->PrintCounters (std::cout);
+  watch.Print (std::cout);
+  PacketPool::Print (std::cout);
+  if (summary)
+    {
+      runStats.PrintSummary (std::cout);
+      PacketPool::PrintSummary (std::cout);
+      watch.PrintSummary (std::cout);
+    }
+  cache.Store ();
+
   Simulator::Destroy ();
 
   return 0;
@@ -0,0 +1,253 @@
+/*
+ * Converts binary animation traces written by AnimRecorder into NetAnim XML.
+ *
+ * Topology and node updates are handled in file order by the main thread;
+ * runs of packet records are cut into blocks that worker threads format in
+ * parallel, and the blocks are written back in order.
+ *
+ * Usage:
+ *    ./ns3 run "anim-convert --input=scratch/tcp-vs-udp.anim"
+ *    ./ns3 run "anim-convert --input=scratch/tcp-vs-udp.anim --output=a.xml --threads=8"
+ */
+
+#include "anim-recorder.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+using namespace std;
+
+static const size_t kBlock = 1 << 15;
+
+struct Piece
+{
+    size_t begin = 0; // packet records [begin, end) of the buffer
+    size_t end = 0;
+    string text;      // already formatted node updates when begin == end
+};
+
+static string Escape(const string &s)
+{
+    string out;
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+static void FormatPackets(const AnimRecord *r, size_t n, string *out)
+{
+    char line[256];
+    out->reserve(n * 120);
+    for (size_t i = 0; i < n; i++)
+    {
+        int len = snprintf(line, sizeof(line),
+                           "<p fId=\"%u\" fbTx=\"%.9f\" lbTx=\"%.9f\" tId=\"%u\" "
+                           "fbRx=\"%.9f\" lbRx=\"%.9f\" />\n",
+                           r[i].node, r[i].timeNs / 1e9, r[i].packet.lbTxNs / 1e9,
+                           r[i].peer, r[i].packet.fbRxNs / 1e9, r[i].packet.lbRxNs / 1e9);
+        out->append(line, len);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string input = "";
+    string output = "";
+    unsigned threads = 0;
+
+    CommandLine cmd;
+    cmd.AddValue("input", "Binary animation trace (.anim)", input);
+    cmd.AddValue("output", "NetAnim XML file (default: input with .xml)", output);
+    cmd.AddValue("threads", "Formatting threads (0 = all cores)", threads);
+    cmd.Parse(argc, argv);
+
+    BinaryRecordReader<AnimRecord> reader;
+    if (input.empty() || !reader.Open(input, ANIM_TRACE_MAGIC))
+    {
+        cerr << "Cannot read animation trace '" << input << "'" << endl;
+        return 1;
+    }
+    if (output.empty())
+    {
+        size_t dot = input.rfind('.');
+        output = input.substr(0, dot) + ".xml";
+    }
+    if (threads == 0)
+    {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    ofstream out(output);
+
+    vector<AnimRecord> buffer(kBlock * threads * 4);
+    size_t n = reader.Read(buffer.data(), buffer.size());
+
+    /* ---------- TOPOLOGY (leading link/position records) ---------- */
+    map<uint32_t, pair<double, double>> nodes;
+    vector<pair<uint32_t, uint32_t>> links;
+    size_t first = 0;
+    for (; first < n; first++)
+    {
+        const AnimRecord &r = buffer[first];
+        if (r.event == ANIM_LINK)
+        {
+            links.push_back({r.node, r.peer});
+        }
+        else if (r.event == ANIM_NODE_POSITION)
+        {
+            nodes[r.node] = {r.position.x, r.position.y};
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    for (const auto &node : nodes)
+    {
+        minX = min(minX, node.second.first);
+        minY = min(minY, node.second.second);
+        maxX = max(maxX, node.second.first);
+        maxY = max(maxY, node.second.second);
+    }
+    out << "<anim ver=\"netanim-3.108\" filetype=\"animation\" >\n"
+        << "<topology minX=\"" << minX << "\" minY=\"" << minY
+        << "\" maxX=\"" << maxX << "\" maxY=\"" << maxY << "\">\n";
+    for (const auto &node : nodes)
+    {
+        out << "<node id=\"" << node.first << "\" sysId=\"0\" locX=\""
+            << node.second.first << "\" locY=\"" << node.second.second << "\" />\n";
+    }
+    for (const auto &link : links)
+    {
+        out << "<link fromId=\"" << link.first << "\" toId=\"" << link.second
+            << "\" fd=\"\" td=\"\" ld=\"\" />\n";
+    }
+    out << "</topology>\n";
+
+    /* ---------- BODY ---------- */
+    uint64_t packets = 0;
+    string descr;          // description being reassembled from continuations
+    uint32_t descrNode = 0;
+    uint32_t descrLength = 0;
+    int64_t descrTime = 0;
+
+    while (n > 0)
+    {
+        // Split the buffer into formatted node updates and packet blocks
+        vector<Piece> pieces(1);
+        for (size_t i = first; i < n; i++)
+        {
+            const AnimRecord &r = buffer[i];
+            if (r.event == ANIM_PACKET)
+            {
+                Piece &last = pieces.back();
+                if (!last.text.empty() || last.end != i || last.end - last.begin >= kBlock)
+                {
+                    pieces.push_back(Piece());
+                    pieces.back().begin = i;
+                }
+                pieces.back().end = i + 1;
+                continue;
+            }
+
+            if (pieces.back().end > pieces.back().begin)
+            {
+                pieces.push_back(Piece());
+            }
+            string &text = pieces.back().text;
+            char line[256];
+            double t = r.timeNs / 1e9;
+            switch (r.event)
+            {
+            case ANIM_NODE_POSITION:
+                snprintf(line, sizeof(line), "<nu p=\"p\" t=\"%.9f\" id=\"%u\" x=\"%g\" y=\"%g\" />\n",
+                         t, r.node, r.position.x, r.position.y);
+                text += line;
+                break;
+            case ANIM_NODE_COLOR:
+                snprintf(line, sizeof(line), "<nu p=\"c\" t=\"%.9f\" id=\"%u\" r=\"%u\" g=\"%u\" b=\"%u\" />\n",
+                         t, r.node, r.rgb[0], r.rgb[1], r.rgb[2]);
+                text += line;
+                break;
+            case ANIM_NODE_DESCRIPTION:
+                descr.clear();
+                descrNode = r.node;
+                descrLength = r.size;
+                descrTime = r.timeNs;
+                // fall through
+            case ANIM_TEXT_CONTINUATION:
+                descr.append(r.text, min<size_t>(sizeof(r.text), descrLength - descr.size()));
+                if (descr.size() == descrLength)
+                {
+                    snprintf(line, sizeof(line), "<nu p=\"d\" t=\"%.9f\" id=\"%u\" descr=\"",
+                             descrTime / 1e9, descrNode);
+                    text += line + Escape(descr) + "\" />\n";
+                }
+                break;
+            case ANIM_LINK:
+            default:
+                break;
+            }
+        }
+
+        // Format the packet blocks in parallel
+        vector<Piece *> work;
+        for (Piece &p : pieces)
+        {
+            if (p.end > p.begin)
+            {
+                work.push_back(&p);
+                packets += p.end - p.begin;
+            }
+        }
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        for (unsigned t = 0; t < min<size_t>(threads, work.size()); t++)
+        {
+            pool.emplace_back([&]() {
+                size_t w;
+                while ((w = next++) < work.size())
+                {
+                    FormatPackets(&buffer[work[w]->begin], work[w]->end - work[w]->begin,
+                                  &work[w]->text);
+                }
+            });
+        }
+        for (thread &t : pool)
+        {
+            t.join();
+        }
+
+        for (const Piece &p : pieces)
+        {
+            out << p.text;
+        }
+
+        n = reader.Read(buffer.data(), buffer.size());
+        first = 0;
+    }
+
+    out << "</anim>\n";
+    cerr << "Wrote " << packets << " packets to " << output << "\n";
+    return 0;
+}
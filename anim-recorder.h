@@ -0,0 +1,311 @@
+/*
+ * NetAnim recording with a compact binary mode.
+ *
+ * AnimRecorder stands in for AnimationInterface in the topology scripts.
+ * In "xml" mode it is a thin wrapper around AnimationInterface. In "binary"
+ * mode every point-to-point transmission becomes one fixed-size record
+ * (first/last bit tx/rx times computed from the link rate and delay, as
+ * NetAnim does), pushed through a BinaryRecordWriter, optionally limited to
+ * a time window and to 1 in N packets. "none" only places the nodes.
+ *
+ * Usage:
+ *    AnimRecorder anim("scratch/tcp-vs-udp", animMode);   // after the links exist
+ *    anim.SetSampling(10);
+ *    anim.SetConstantPosition(node, 5, 10);
+ *    anim.UpdateNodeDescription(node, "Client");
+ *
+ * Convert with: ./ns3 run "anim-convert --input=scratch/tcp-vs-udp.anim"
+ */
+
+#ifndef ANIM_RECORDER_H
+#define ANIM_RECORDER_H
+
+#include "record-ring.h"
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/netanim-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+
+namespace ns3
+{
+
+static const char ANIM_TRACE_MAGIC[8] = {'A', 'N', 'I', 'M', 'B', 'I', 'N', '1'};
+
+enum AnimEvent : uint8_t
+{
+    ANIM_LINK = 0,
+    ANIM_NODE_POSITION = 1,
+    ANIM_NODE_DESCRIPTION = 2, // size = full text length
+    ANIM_TEXT_CONTINUATION = 3,
+    ANIM_NODE_COLOR = 4,
+    ANIM_PACKET = 5
+};
+
+struct AnimRecord
+{
+    int64_t timeNs; // first bit tx for packets
+    uint32_t node;
+    uint32_t peer; // receiving node of packets and links
+    uint8_t event;
+    uint8_t rgb[3];
+    uint32_t size; // packet bytes, or description length
+
+    union {
+        struct
+        {
+            int64_t lbTxNs;
+            int64_t fbRxNs;
+            int64_t lbRxNs;
+        } packet;
+
+        struct
+        {
+            double x;
+            double y;
+        } position;
+
+        char text[24];
+    };
+};
+
+static_assert(sizeof(AnimRecord) == 48, "AnimRecord must stay 48 bytes");
+
+class AnimRecorder
+{
+  public:
+    enum Mode
+    {
+        ANIM_XML,
+        ANIM_BINARY,
+        ANIM_NONE
+    };
+
+    // prefix gets ".xml" or ".anim" appended; mode is "xml", "binary" or "none"
+    AnimRecorder(const std::string& prefix, const std::string& mode)
+    {
+        if (mode == "xml")
+        {
+            m_mode = ANIM_XML;
+            m_xml.reset(new AnimationInterface(prefix + ".xml"));
+        }
+        else if (mode == "binary")
+        {
+            m_mode = ANIM_BINARY;
+            NS_ABORT_MSG_IF(!m_writer.Open(prefix + ".anim", ANIM_TRACE_MAGIC, 1 << 16),
+                            "AnimRecorder: cannot open " << prefix << ".anim");
+            InstallBinary();
+        }
+        else
+        {
+            NS_ABORT_MSG_IF(mode != "none", "Unknown animation mode " << mode);
+            m_mode = ANIM_NONE;
+        }
+    }
+
+    ~AnimRecorder()
+    {
+        Close();
+    }
+
+    // Only packets whose first bit leaves in [start, stop] are recorded
+    void SetWindow(Time start, Time stop)
+    {
+        m_start = start;
+        m_stop = stop;
+        if (m_xml)
+        {
+            m_xml->SetStartTime(start);
+            m_xml->SetStopTime(stop);
+        }
+    }
+
+    // Ends the window now, e.g. once a watchpoint has the answer
+    void StopRecording()
+    {
+        SetWindow(m_start, Simulator::Now());
+    }
+
+    // Records 1 in n packets (binary mode only)
+    void SetSampling(uint32_t n)
+    {
+        m_sampling = std::max<uint32_t>(n, 1);
+    }
+
+    void SetConstantPosition(Ptr<Node> node, double x, double y)
+    {
+        AnimationInterface::SetConstantPosition(node, x, y);
+        if (m_mode == ANIM_BINARY)
+        {
+            WritePosition(node->GetId(), x, y);
+        }
+    }
+
+    void UpdateNodeDescription(Ptr<Node> node, const std::string& descr)
+    {
+        if (m_xml)
+        {
+            m_xml->UpdateNodeDescription(node, descr);
+        }
+        else if (m_mode == ANIM_BINARY)
+        {
+            AnimRecord r = NewRecord(ANIM_NODE_DESCRIPTION, node->GetId());
+            r.size = descr.size();
+            for (size_t offset = 0; offset == 0 || offset < descr.size();
+                 offset += sizeof(r.text))
+            {
+                descr.copy(r.text, sizeof(r.text), offset);
+                m_writer.Write(r);
+                r = NewRecord(ANIM_TEXT_CONTINUATION, node->GetId());
+            }
+        }
+    }
+
+    void UpdateNodeColor(Ptr<Node> node, uint8_t red, uint8_t green, uint8_t blue)
+    {
+        if (m_xml)
+        {
+            m_xml->UpdateNodeColor(node, red, green, blue);
+        }
+        else if (m_mode == ANIM_BINARY)
+        {
+            AnimRecord r = NewRecord(ANIM_NODE_COLOR, node->GetId());
+            r.rgb[0] = red;
+            r.rgb[1] = green;
+            r.rgb[2] = blue;
+            m_writer.Write(r);
+        }
+    }
+
+    // Packets written in binary mode
+    uint64_t GetPacketCount() const
+    {
+        return m_packets;
+    }
+
+    void Close()
+    {
+        m_writer.Close();
+        m_xml.reset();
+    }
+
+  private:
+    struct Link
+    {
+        AnimRecorder* recorder;
+        uint32_t node;
+        uint32_t peer;
+        DataRate rate;
+        Time delay;
+
+        void PhyTxBegin(Ptr<const Packet> p)
+        {
+            recorder->WritePacket(*this, p->GetSize());
+        }
+    };
+
+    static AnimRecord NewRecord(AnimEvent event, uint32_t node)
+    {
+        AnimRecord r;
+        std::memset(&r, 0, sizeof(r));
+        r.timeNs = Simulator::Now().GetNanoSeconds();
+        r.event = event;
+        r.node = node;
+        return r;
+    }
+
+    void WritePosition(uint32_t node, double x, double y)
+    {
+        AnimRecord r = NewRecord(ANIM_NODE_POSITION, node);
+        r.position.x = x;
+        r.position.y = y;
+        m_writer.Write(r);
+    }
+
+    // Links first, then every node's current position, so a converter can
+    // build the topology from the leading records
+    void InstallBinary()
+    {
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); i++)
+        {
+            Ptr<Node> node = NodeList::GetNode(i);
+            for (uint32_t d = 0; d < node->GetNDevices(); d++)
+            {
+                Ptr<PointToPointNetDevice> dev =
+                    DynamicCast<PointToPointNetDevice>(node->GetDevice(d));
+                if (!dev)
+                {
+                    continue;
+                }
+                Ptr<Channel> channel = dev->GetChannel();
+                Ptr<NetDevice> peer = channel->GetDevice(channel->GetDevice(0) == dev ? 1 : 0);
+
+                Link link;
+                link.recorder = this;
+                link.node = node->GetId();
+                link.peer = peer->GetNode()->GetId();
+                DataRateValue rate;
+                dev->GetAttribute("DataRate", rate);
+                link.rate = rate.Get();
+                TimeValue delay;
+                channel->GetAttribute("Delay", delay);
+                link.delay = delay.Get();
+                m_links.push_back(link);
+                dev->TraceConnectWithoutContext("PhyTxBegin",
+                                                MakeCallback(&Link::PhyTxBegin, &m_links.back()));
+
+                if (link.node < link.peer)
+                {
+                    AnimRecord r = NewRecord(ANIM_LINK, link.node);
+                    r.peer = link.peer;
+                    m_writer.Write(r);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); i++)
+        {
+            Ptr<Node> node = NodeList::GetNode(i);
+            Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+            Vector pos = mobility ? mobility->GetPosition() : Vector();
+            WritePosition(node->GetId(), pos.x, pos.y);
+        }
+    }
+
+    void WritePacket(const Link& link, uint32_t size)
+    {
+        Time now = Simulator::Now();
+        if (now < m_start || (!m_stop.IsZero() && now > m_stop) || m_seen++ % m_sampling != 0)
+        {
+            return;
+        }
+        AnimRecord r = NewRecord(ANIM_PACKET, link.node);
+        int64_t tx = link.rate.CalculateBytesTxTime(size).GetNanoSeconds();
+        r.peer = link.peer;
+        r.size = size;
+        r.packet.lbTxNs = r.timeNs + tx;
+        r.packet.fbRxNs = r.timeNs + link.delay.GetNanoSeconds();
+        r.packet.lbRxNs = r.packet.lbTxNs + link.delay.GetNanoSeconds();
+        m_writer.Write(r);
+        m_packets++;
+    }
+
+    Mode m_mode;
+    std::unique_ptr<AnimationInterface> m_xml;
+    BinaryRecordWriter<AnimRecord> m_writer;
+    std::list<Link> m_links; // stable addresses for the bound callbacks
+    Time m_start;
+    Time m_stop;
+    uint32_t m_sampling = 1;
+    uint64_t m_seen = 0;
+    uint64_t m_packets = 0;
+};
+
+} // namespace ns3
+
+#endif /* ANIM_RECORDER_H */
@@ -6,73 +6,154 @@
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "delay-sketch.h"
+#include "lazy-routing.h"
+#include "packet-pool.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "steady-state.h"
+#include "topology-builder.h"
+#include "warm-start.h"
+
 using namespace ns3;
 
+// Bytes the bottleneck device put on the wire since the senders started
+static Time g_measureStart = Seconds (1.0);
+static uint64_t g_bottleneckTxBytes = 0;
+
+static void
+BottleneckTxEnd (Ptr<const Packet> packet)
+{
+  if (Simulator::Now () >= g_measureStart)
+    {
+      g_bottleneckTxBytes += packet->GetSize ();
+    }
+}
+
 int main (int argc, char *argv[])
 {
   Time::SetResolution (Time::NS);
 
-  NodeContainer sources, router, sink;
-  sources.Create (2);
-  router.Create (1);
-  sink.Create (1);
+  // ---------- Parameters ----------
+  double minTh = 2;
+  double maxTh = 5;
+  std::string queueSize = "20p";
+  std::string linkRate = "5Mbps";
+  std::string linkDelay = "10ms";
+  bool gentle = true;
+  uint32_t meanPktSize = 1500;
+  double simTime = 20.0;
+  uint32_t nSenders = 2;
+  std::string routing = "global";
+  bool summary = false;
+  bool packetPool = false;
+  bool steadyState = false;
+  double ssTolerance = 0.05;
+  double ssWindow = 100;
+  double branchAt = 0;
+  std::string variants = "";
+  unsigned jobs = 0;
+  std::string resultCache = "";
 
-  // ---------- Access links ----------
-  PointToPointHelper access;
-  access.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
-  access.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  CommandLine cmd;
+  cmd.AddValue ("minTh", "RED minimum threshold (packets)", minTh);
+  cmd.AddValue ("maxTh", "RED maximum threshold (packets)", maxTh);
+  cmd.AddValue ("queueSize", "RED MaxSize", queueSize);
+  cmd.AddValue ("linkRate", "Bottleneck data rate", linkRate);
+  cmd.AddValue ("linkDelay", "Bottleneck delay", linkDelay);
+  cmd.AddValue ("gentle", "RED gentle mode", gentle);
+  cmd.AddValue ("meanPktSize", "RED MeanPktSize (bytes)", meanPktSize);
+  cmd.AddValue ("nSenders", "Number of bulk TCP senders", nSenders);
+  cmd.AddValue ("simTime", "Simulation duration (s); the upper bound with --steadyState", simTime);
+  cmd.AddValue ("steadyState", "Stop once throughput, delay and loss have converged", steadyState);
+  cmd.AddValue ("ssTolerance", "Relative 95% CI half-width that counts as converged", ssTolerance);
+  cmd.AddValue ("ssWindow", "Steady-state sampling window (ms)", ssWindow);
+  cmd.AddValue ("branchAt", "Fork one process per variant at this time (s, 0 = no branching)", branchAt);
+  cmd.AddValue ("variants",
+                "Bottleneck variants for --branchAt, ';'-separated lists of "
+                "qdisc=Red|PfifoFast,minTh=,maxTh=,queueSize=,gentle=,meanPktSize=",
+                variants);
+  cmd.AddValue ("jobs", "Branches running at once (0 = one per core)", jobs);
+  cmd.AddValue ("routing", "Routing: global (full SPF at start) or lazy (on demand)", routing);
+  cmd.AddValue ("summary", "Print machine-readable SUMMARY lines", summary);
+  cmd.AddValue ("packetPool", "Serve packet allocations from per-thread free lists", packetPool);
+  cmd.AddValue ("resultCache",
+                "Directory of cached results; a known configuration is not re-run (empty = off)",
+                resultCache);
+  cmd.Parse (argc, argv);
 
-  NetDeviceContainer d0r = access.Install (sources.Get (0), router.Get (0));
-  NetDeviceContainer d1r = access.Install (sources.Get (1), router.Get (0));
+  ResultCache cache (resultCache);
+  if (cache.Replay (argc, argv))
+    {
+      return 0;
+    }
 
-  // ---------- Bottleneck ----------
-  PointToPointHelper bottleneck;
-  bottleneck.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
-  bottleneck.SetChannelAttribute ("Delay", StringValue ("10ms"));
+  if (packetPool)
+    {
+      PacketPool::Enable ();
+    }
 
+  // ---------- Topology: nSenders -- access -- router -- bottleneck -- sink ----------
   // Disable device buffering.the queue size is set to 1 packet (1p), which is effectively almost no buffering. Normally, a network device (NetDevice) has a default hardware/software buffer for packets. By setting it to just 1 packet, you are minimizing the device’s internal queue, so the queue won't store multiple packets, which is why the comment says “disable device buffering”.
 
 //It doesn’t completely remove the queue (you always need at least 1 packet), but it prevents large queue buildup that could hide the effects of the AQM discipline being tested.
-  bottleneck.SetQueue ("ns3::DropTailQueue<Packet>",
-                       "MaxSize", QueueSizeValue (QueueSize ("1p")));
-
-  NetDeviceContainer drs = bottleneck.Install (router.Get (0), sink.Get (0));
-
-  // ---------- Internet ----------
-  InternetStackHelper stack;
-  stack.InstallAll ();
-
-  Ipv4AddressHelper address;
-
-  address.SetBase ("10.1.1.0", "255.255.255.0");
-  address.Assign (d0r);
-
-  address.SetBase ("10.1.2.0", "255.255.255.0");
-  address.Assign (d1r);
+  TopologyBuilder builder;
+  LazyGlobalRoutingHelper lazyRouting;
+  if (routing == "lazy")
+    {
+      builder.SetRoutingHelper (lazyRouting.GetListRouting ());
+    }
+  Topology topo = builder.Dumbbell (nSenders, 1,
+                                    LinkSpec ("100Mbps", "2ms"),
+                                    LinkSpec (linkRate, linkDelay, "1p"));
 
-  address.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer sinkIf = address.Assign (drs);
+  NodeContainer sources = topo.senders;
+  NodeContainer sink = topo.receivers;
+  NetDeviceContainer drs = topo.bottleneck;
+  Ipv4InterfaceContainer sinkIf = topo.bottleneckIf;
 
-  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  if (routing == "global")
+    {
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+    }
 
   //TrafficControlHelper in NS-3 is used to install and configure queue disciplines (like RED, CoDel, or DropTail) on NetDevices. It allows you to control how packets are queued, scheduled, and dropped to manage congestion
-  TrafficControlHelper tch;
+  // Bottleneck queue disc of one configuration; keys a variant does not
+  // give keep the command-line values
+  auto bottleneckQdisc = [&] (const std::map<std::string, std::string> &v)
+    {
+      auto get = [&v] (const std::string &key, const std::string &base)
+        {
+          auto it = v.find (key);
+          return it != v.end () ? it->second : base;
+        };
+      TrafficControlHelper tch;
+      if (get ("qdisc", "Red") == "PfifoFast")
+        {
+          tch.SetRootQueueDisc ("ns3::PfifoFastQueueDisc",
+                                "MaxSize", QueueSizeValue (QueueSize (get ("queueSize", queueSize))));
+          return tch;
+        }
+      //we are installing the actual AQM (RED) queue on the bottleneck device.RED will start probabilistically dropping packets when the average queue length is between MinTh and MaxTh.SetRootQueueDisc is a method of TrafficControlHelper used to assign a specific queue discipline (e.g., RED, CoDel) as the root queue on a network device. It also allows setting the configuration parameters of that queue discipline, such as thresholds, queue size, and packet handling behavior.
+      tch.SetRootQueueDisc (
+          "ns3::RedQueueDisc",
+          "MinTh", DoubleValue (std::stod (get ("minTh", std::to_string (minTh)))),
+          "MaxTh", DoubleValue (std::stod (get ("maxTh", std::to_string (maxTh)))),
+          "MaxSize", QueueSizeValue (QueueSize (get ("queueSize", queueSize))),
+          "LinkBandwidth", StringValue (linkRate),
+          "LinkDelay", StringValue (linkDelay),
+          "MeanPktSize", UintegerValue (std::stoul (get ("meanPktSize", std::to_string (meanPktSize)))),
+          "Gentle", BooleanValue (get ("gentle", gentle ? "1" : "0") != "0")
+      );
+      return tch;
+    };
+
+  TrafficControlHelper tch = bottleneckQdisc ({});
 
   // REMOVE default queue disc FIRST
   tch.Uninstall (drs.Get (0));
-  //we are installing the actual AQM (RED) queue on the bottleneck device.RED will start probabilistically dropping packets when the average queue length is between MinTh and MaxTh.SetRootQueueDisc is a method of TrafficControlHelper used to assign a specific queue discipline (e.g., RED, CoDel) as the root queue on a network device. It also allows setting the configuration parameters of that queue discipline, such as thresholds, queue size, and packet handling behavior.
-  tch.SetRootQueueDisc (
-      "ns3::RedQueueDisc",
-      "MinTh", DoubleValue (2),
-      "MaxTh", DoubleValue (5),
-      "MaxSize", QueueSizeValue (QueueSize ("20p")),
-      "LinkBandwidth", StringValue ("5Mbps"),
-      "LinkDelay", StringValue ("10ms"),
-      "MeanPktSize", UintegerValue (1500),
-      "Gentle", BooleanValue (true)
-  );
-
   tch.Install (drs.Get (0));
+  drs.Get (0)->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&BottleneckTxEnd));
 
   // ---------- Applications ----------
   uint16_t port = 50000;
@@ -81,7 +162,7 @@ int main (int argc, char *argv[])
                             InetSocketAddress (Ipv4Address::GetAny (), port));
   ApplicationContainer sinkApps = sinkApp.Install (sink.Get (0));
   sinkApps.Start (Seconds (0.0));
-  sinkApps.Stop (Seconds (20.0));
+  sinkApps.Stop (Seconds (simTime));
 
   for (uint32_t i = 0; i < sources.GetN (); i++)
     {
@@ -90,36 +171,154 @@ int main (int argc, char *argv[])
       bulk.SetAttribute ("MaxBytes", UintegerValue (0));
 
       ApplicationContainer app = bulk.Install (sources.Get (i));
-      app.Start (Seconds (1.0));
-      app.Stop (Seconds (20.0));
+      app.Start (g_measureStart);
+      app.Stop (Seconds (simTime));
     }
 
   // ---------- Flow Monitor ----------
   FlowMonitorHelper flowmon;
   Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
 
-  Simulator::Stop (Seconds (20.0));
+  // Per-flow delay/jitter percentiles, updated on the receive path
+  DelaySketchMonitor sketches;
+  sketches.Install (NodeContainer::GetGlobal (),
+                    DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ()));
+
+  // Warm-up truncation and early stop on the bulk data flows
+  SteadyStateMonitor steady;
+  if (steadyState)
+    {
+      steady.SetWindow (Time::FromDouble (ssWindow, Time::MS));
+      steady.SetTolerance (ssTolerance);
+      steady.SetPorts ({port});
+      steady.Install (monitor, DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ()),
+                      Seconds (1.0));
+    }
+
+  // What-if variants share the run up to branchAt, then each swaps the
+  // bottleneck queue disc in its own process
+  WarmStartBrancher brancher;
+  if (branchAt > 0)
+    {
+      for (const std::string &spec : SplitList (variants, ';'))
+        {
+          brancher.AddVariant (spec, [&drs, &bottleneckQdisc, spec] ()
+            {
+              TrafficControlHelper variant = bottleneckQdisc (ParseVariant (spec));
+              ReplaceRootQueueDisc (drs.Get (0), variant);
+            });
+        }
+      brancher.Schedule (Seconds (branchAt), jobs);
+    }
+
+  Simulator::Stop (Seconds (simTime));
+  RunStats runStats;
+  runStats.Start ();
   Simulator::Run ();
+  runStats.Stop ();
+
+  if (brancher.IsParent ())
+    {
+      brancher.Print (std::cout);
+      cache.Store ();
+      Simulator::Destroy ();
+      return 0;
+    }
 
   monitor->CheckForLostPackets ();
 
+  // Busy fraction of the bottleneck link over the measurement interval,
+  // which ends early when the steady-state monitor stopped the run
+  double measured = (Simulator::Now () - g_measureStart).GetSeconds ();
+  double utilization = measured > 0
+      ? g_bottleneckTxBytes * 8.0 / (DataRate (linkRate).GetBitRate () * measured)
+      : 0;
+
   Ptr<Ipv4FlowClassifier> classifier =
       DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
 
+  // Totals cover the bulk data flows only, not the reverse ACK flows
+  uint64_t totalTx = 0, totalRx = 0, totalLost = 0;
+  double totalDelay = 0, totalThroughput = 0;
+  DelaySketch totalSketch;
+
   for (auto const &flow : monitor->GetFlowStats ())
     {
       auto t = classifier->FindFlow (flow.first);
       std::cout << "Flow " << flow.first << " (" << t.sourceAddress
                 << " -> " << t.destinationAddress << ")\n";
       std::cout << "  Lost packets: " << flow.second.lostPackets << "\n";
+      double meanDelay = 0;
       if (flow.second.rxPackets > 0)
         {
-          std::cout << "  Mean delay: "
-                    << flow.second.delaySum.GetSeconds () /
-                           flow.second.rxPackets
-                    << " s\n";
+          meanDelay = flow.second.delaySum.GetSeconds () /
+                      flow.second.rxPackets;
+          std::cout << "  Mean delay: " << meanDelay << " s\n";
+        }
+      sketches.Print (flow.first, std::cout);
+      const DelaySketchMonitor::FlowSketches &fs = sketches.Get (flow.first);
+
+      double duration = flow.second.timeLastRxPacket.GetSeconds () -
+                        flow.second.timeFirstTxPacket.GetSeconds ();
+      double throughput =
+          duration > 0 ? flow.second.rxBytes * 8.0 / duration / 1e6 : 0;
+
+      if (summary)
+        {
+          std::cout << "SUMMARY scope=flow flow=" << flow.first
+                    << " src=" << t.sourceAddress
+                    << " dst=" << t.destinationAddress
+                    << " dstPort=" << t.destinationPort
+                    << " txPackets=" << flow.second.txPackets
+                    << " rxPackets=" << flow.second.rxPackets
+                    << " lostPackets=" << flow.second.lostPackets
+                    << " meanDelay=" << meanDelay
+                    << " throughputMbps=" << throughput
+                    << " delayP50=" << fs.delay.Quantile (0.5) / 1e9
+                    << " delayP99=" << fs.delay.Quantile (0.99) / 1e9
+                    << " delayP999=" << fs.delay.Quantile (0.999) / 1e9
+                    << " jitterP99=" << fs.jitter.Quantile (0.99) / 1e9
+                    << " delaySketch=" << fs.delay.Serialize () << "\n";
+        }
+
+      if (t.destinationPort == port)
+        {
+          totalTx += flow.second.txPackets;
+          totalRx += flow.second.rxPackets;
+          totalLost += flow.second.lostPackets;
+          totalDelay += flow.second.delaySum.GetSeconds ();
+          totalThroughput += throughput;
+          totalSketch.Merge (fs.delay);
+        }
+    }
+
+  if (steadyState)
+    {
+      steady.Print (std::cout);
+    }
+  PacketPool::Print (std::cout);
+  if (summary)
+    {
+      std::cout << "SUMMARY scope=total"
+                << " txPackets=" << totalTx
+                << " rxPackets=" << totalRx
+                << " lostPackets=" << totalLost
+                << " lossRatio=" << (totalTx > 0 ? double (totalLost) / totalTx : 0)
+                << " meanDelay=" << (totalRx > 0 ? totalDelay / totalRx : 0)
+                << " throughputMbps=" << totalThroughput
+                << " utilization=" << utilization
+                << " delayP50=" << totalSketch.Quantile (0.5) / 1e9
+                << " delayP99=" << totalSketch.Quantile (0.99) / 1e9
+                << " delayP999=" << totalSketch.Quantile (0.999) / 1e9
+                << " delaySketch=" << totalSketch.Serialize () << "\n";
+      runStats.PrintSummary (std::cout);
+      PacketPool::PrintSummary (std::cout);
+      if (steadyState)
+        {
+          steady.PrintSummary (std::cout);
         }
     }
+  cache.Store ();
 
   Simulator::Destroy ();
   return 0;
@@ -0,0 +1,624 @@
+/*
+ * Indexed binary packet trace for point-to-point devices.
+ *
+ * Drop-in replacement for AsciiTraceHelper::EnableAsciiAll: the same events
+ * (+ enqueue, - dequeue, d drop, r receive) become fixed-size records with
+ * the IPv4 5-tuple pulled from the packet bytes. Records are grouped into
+ * blocks, optionally compressed with the bundled delta/varint codec, and a
+ * footer indexes every block by time range and by (node, device), so
+ * PacketTraceReader can jump straight to a window or a device.
+ *
+ * Usage:
+ *    PacketTraceWriter trace;
+ *    trace.Open("scratch/multihop.ptr");
+ *    trace.EnableAll();                 // every PointToPointNetDevice
+ *    Simulator::Run();
+ *    trace.Close();
+ *
+ * Query with: ./ns3 run "trace-query --input=scratch/multihop.ptr --start=2 --stop=3"
+ */
+
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+static const char PACKET_TRACE_MAGIC[8] = {'P', 'K', 'T', 'R', 'A', 'C', 'E', '1'};
+static const char PACKET_TRACE_INDEX_MAGIC[8] = {'P', 'K', 'T', 'I', 'D', 'X', '0', '1'};
+
+enum PacketTraceEvent : uint8_t
+{
+    TRACE_ENQUEUE = 0,
+    TRACE_DEQUEUE = 1,
+    TRACE_DROP = 2,
+    TRACE_RECEIVE = 3
+};
+
+enum PacketTraceCodec : uint8_t
+{
+    TRACE_CODEC_RAW = 0,
+    TRACE_CODEC_DELTA_VARINT = 1
+};
+
+// Same letters as the ASCII trace
+inline char
+PacketTraceEventChar(uint8_t event)
+{
+    static const char chars[] = {'+', '-', 'd', 'r'};
+    return event < sizeof(chars) ? chars[event] : '?';
+}
+
+struct PacketTraceRecord
+{
+    int64_t timeNs;
+    uint64_t uid;
+    uint32_t node;
+    uint32_t device;
+    uint32_t size;
+    uint32_t src; // IPv4 source, 0 for non-IPv4 frames
+    uint32_t dst;
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint8_t protocol;
+    uint8_t event;
+    uint8_t pad[6];
+};
+
+static_assert(sizeof(PacketTraceRecord) == 48, "PacketTraceRecord must stay 48 bytes");
+
+/* ---------- FILE LAYOUT ----------
+ * PacketTraceFileHeader
+ * blocks: PacketTraceBlockHeader + payload
+ * index:  uint32 nBlocks, PacketTraceBlockInfo[nBlocks],
+ *         uint32 nDevices, then per device: uint32 node, uint32 device,
+ *         uint32 nBlocks, uint32 blockIds[nBlocks]
+ * PacketTraceFooter
+ */
+struct PacketTraceFileHeader
+{
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t version;
+};
+
+struct PacketTraceBlockHeader
+{
+    uint32_t nRecords;
+    uint32_t bytes;
+    uint8_t codec;
+    uint8_t pad[7];
+};
+
+struct PacketTraceBlockInfo
+{
+    uint64_t offset; // of the block header
+    int64_t firstNs;
+    int64_t lastNs;
+    uint32_t nRecords;
+    uint32_t bytes;
+};
+
+struct PacketTraceFooter
+{
+    uint64_t indexOffset;
+    char magic[8];
+};
+
+/* ---------- CODEC ----------
+ * Column-wise: every field of the block is stored as a zigzag varint of its
+ * difference to the previous record, so blocks decode independently.
+ */
+class PacketTraceCodecDeltaVarint
+{
+  public:
+    static void Encode(const PacketTraceRecord* r, size_t n, std::vector<uint8_t>* out)
+    {
+        out->clear();
+        Column(r, n, out, [](const PacketTraceRecord& x) { return x.timeNs; });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.uid); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.node); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.device); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.size); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.src); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.dst); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.srcPort); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.dstPort); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.protocol); });
+        Column(r, n, out, [](const PacketTraceRecord& x) { return int64_t(x.event); });
+    }
+
+    static bool Decode(const uint8_t* in, size_t bytes, PacketTraceRecord* r, size_t n)
+    {
+        const uint8_t* end = in + bytes;
+        std::memset(r, 0, n * sizeof(PacketTraceRecord));
+        return Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.timeNs = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.uid = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.node = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.device = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.size = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.src = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.dst = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.srcPort = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.dstPort = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.protocol = v; }) &&
+               Column(&in, end, r, n, [](PacketTraceRecord& x, int64_t v) { x.event = v; });
+    }
+
+  private:
+    template <typename Get>
+    static void Column(const PacketTraceRecord* r, size_t n, std::vector<uint8_t>* out, Get get)
+    {
+        int64_t prev = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            int64_t v = get(r[i]);
+            uint64_t z = uint64_t(v - prev);
+            z = (z << 1) ^ uint64_t(int64_t(v - prev) >> 63);
+            while (z >= 0x80)
+            {
+                out->push_back(uint8_t(z) | 0x80);
+                z >>= 7;
+            }
+            out->push_back(uint8_t(z));
+            prev = v;
+        }
+    }
+
+    template <typename Set>
+    static bool Column(const uint8_t** in, const uint8_t* end, PacketTraceRecord* r, size_t n,
+                       Set set)
+    {
+        int64_t prev = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint64_t z = 0;
+            int shift = 0;
+            while (true)
+            {
+                if (*in == end || shift > 63)
+                {
+                    return false;
+                }
+                uint8_t b = *(*in)++;
+                z |= uint64_t(b & 0x7f) << shift;
+                shift += 7;
+                if (!(b & 0x80))
+                {
+                    break;
+                }
+            }
+            prev += int64_t(z >> 1) ^ -int64_t(z & 1);
+            set(r[i], prev);
+        }
+        return true;
+    }
+};
+
+/* ---------- WRITER ---------- */
+class PacketTraceWriter
+{
+  public:
+    PacketTraceWriter() = default;
+    PacketTraceWriter(const PacketTraceWriter&) = delete;
+    PacketTraceWriter& operator=(const PacketTraceWriter&) = delete;
+
+    ~PacketTraceWriter()
+    {
+        Close();
+    }
+
+    bool Open(const std::string& path,
+              PacketTraceCodec codec = TRACE_CODEC_DELTA_VARINT,
+              uint32_t blockRecords = 8192)
+    {
+        Close();
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file)
+        {
+            return false;
+        }
+        PacketTraceFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, PACKET_TRACE_MAGIC, sizeof(header.magic));
+        header.recordSize = sizeof(PacketTraceRecord);
+        header.version = 1;
+        std::fwrite(&header, sizeof(header), 1, m_file);
+        m_offset = sizeof(header);
+        m_codec = codec;
+        m_blockRecords = std::max<uint32_t>(blockRecords, 1);
+        m_block.reserve(m_blockRecords);
+        m_blocks.clear();
+        m_deviceBlocks.clear();
+        m_records = 0;
+        return true;
+    }
+
+    // Traces every PointToPointNetDevice in the simulation
+    void EnableAll()
+    {
+        for (uint32_t i = 0; i < NodeList::GetNNodes(); i++)
+        {
+            Ptr<Node> node = NodeList::GetNode(i);
+            for (uint32_t d = 0; d < node->GetNDevices(); d++)
+            {
+                Enable(node->GetDevice(d));
+            }
+        }
+    }
+
+    void Enable(NetDeviceContainer devices)
+    {
+        for (uint32_t i = 0; i < devices.GetN(); i++)
+        {
+            Enable(devices.Get(i));
+        }
+    }
+
+    // Does nothing unless Open() succeeded
+    void Enable(Ptr<NetDevice> device)
+    {
+        Ptr<PointToPointNetDevice> dev = DynamicCast<PointToPointNetDevice>(device);
+        if (!dev || !m_file)
+        {
+            return;
+        }
+        m_devices.push_back(Device{this, dev->GetNode()->GetId(), dev->GetIfIndex()});
+        Device* d = &m_devices.back();
+        Ptr<Queue<Packet>> queue = dev->GetQueue();
+        queue->TraceConnectWithoutContext("Enqueue", MakeCallback(&Device::Enqueue, d));
+        queue->TraceConnectWithoutContext("Dequeue", MakeCallback(&Device::Dequeue, d));
+        queue->TraceConnectWithoutContext("Drop", MakeCallback(&Device::Drop, d));
+        dev->TraceConnectWithoutContext("PhyRxDrop", MakeCallback(&Device::Drop, d));
+        dev->TraceConnectWithoutContext("MacRx", MakeCallback(&Device::Receive, d));
+    }
+
+    uint64_t GetRecordCount() const
+    {
+        return m_records;
+    }
+
+    // Flushes the last block and writes the index
+    void Close()
+    {
+        if (!m_file)
+        {
+            return;
+        }
+        FlushBlock();
+
+        PacketTraceFooter footer;
+        footer.indexOffset = m_offset;
+        std::memcpy(footer.magic, PACKET_TRACE_INDEX_MAGIC, sizeof(footer.magic));
+
+        uint32_t nBlocks = m_blocks.size();
+        std::fwrite(&nBlocks, sizeof(nBlocks), 1, m_file);
+        if (nBlocks)
+        {
+            std::fwrite(m_blocks.data(), sizeof(PacketTraceBlockInfo), nBlocks, m_file);
+        }
+        uint32_t nDevices = m_deviceBlocks.size();
+        std::fwrite(&nDevices, sizeof(nDevices), 1, m_file);
+        for (const auto& d : m_deviceBlocks)
+        {
+            uint32_t key[3] = {uint32_t(d.first >> 32), uint32_t(d.first), uint32_t(d.second.size())};
+            std::fwrite(key, sizeof(key), 1, m_file);
+            std::fwrite(d.second.data(), sizeof(uint32_t), d.second.size(), m_file);
+        }
+        std::fwrite(&footer, sizeof(footer), 1, m_file);
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+
+  private:
+    struct Device
+    {
+        PacketTraceWriter* writer;
+        uint32_t node;
+        uint32_t device;
+
+        void Enqueue(Ptr<const Packet> p)
+        {
+            writer->Append(*this, TRACE_ENQUEUE, p);
+        }
+
+        void Dequeue(Ptr<const Packet> p)
+        {
+            writer->Append(*this, TRACE_DEQUEUE, p);
+        }
+
+        void Drop(Ptr<const Packet> p)
+        {
+            writer->Append(*this, TRACE_DROP, p);
+        }
+
+        void Receive(Ptr<const Packet> p)
+        {
+            writer->Append(*this, TRACE_RECEIVE, p);
+        }
+    };
+
+    void Append(const Device& d, PacketTraceEvent event, Ptr<const Packet> p)
+    {
+        PacketTraceRecord r;
+        std::memset(&r, 0, sizeof(r));
+        r.timeNs = Simulator::Now().GetNanoSeconds();
+        r.uid = p->GetUid();
+        r.node = d.node;
+        r.device = d.device;
+        r.size = p->GetSize();
+        r.event = event;
+
+        // PPP header (0x0021 = IPv4), IPv4 header, then the transport ports
+        uint8_t b[26];
+        if (p->CopyData(b, sizeof(b)) >= 22 && b[0] == 0x00 && b[1] == 0x21)
+        {
+            const uint8_t* ip = b + 2;
+            uint32_t ihl = (ip[0] & 0x0f) * 4;
+            r.protocol = ip[9];
+            r.src = (uint32_t(ip[12]) << 24) | (uint32_t(ip[13]) << 16) | (uint32_t(ip[14]) << 8) | ip[15];
+            r.dst = (uint32_t(ip[16]) << 24) | (uint32_t(ip[17]) << 16) | (uint32_t(ip[18]) << 8) | ip[19];
+            if (ihl == 20 && (r.protocol == 6 || r.protocol == 17) && r.size >= sizeof(b))
+            {
+                r.srcPort = (uint16_t(ip[20]) << 8) | ip[21];
+                r.dstPort = (uint16_t(ip[22]) << 8) | ip[23];
+            }
+        }
+
+        m_block.push_back(r);
+        if (m_block.size() >= m_blockRecords)
+        {
+            FlushBlock();
+        }
+    }
+
+    void FlushBlock()
+    {
+        if (!m_file)
+        {
+            m_block.clear();
+            return;
+        }
+        if (m_block.empty())
+        {
+            return;
+        }
+        PacketTraceBlockHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.nRecords = m_block.size();
+        header.codec = m_codec;
+        const void* payload = m_block.data();
+        header.bytes = m_block.size() * sizeof(PacketTraceRecord);
+        if (m_codec == TRACE_CODEC_DELTA_VARINT)
+        {
+            PacketTraceCodecDeltaVarint::Encode(m_block.data(), m_block.size(), &m_encoded);
+            payload = m_encoded.data();
+            header.bytes = m_encoded.size();
+        }
+
+        PacketTraceBlockInfo info;
+        info.offset = m_offset;
+        info.firstNs = m_block.front().timeNs;
+        info.lastNs = m_block.back().timeNs;
+        info.nRecords = header.nRecords;
+        info.bytes = header.bytes;
+        uint32_t blockId = m_blocks.size();
+        m_blocks.push_back(info);
+
+        for (const PacketTraceRecord& r : m_block)
+        {
+            std::vector<uint32_t>& ids = m_deviceBlocks[(uint64_t(r.node) << 32) | r.device];
+            if (ids.empty() || ids.back() != blockId)
+            {
+                ids.push_back(blockId);
+            }
+        }
+
+        std::fwrite(&header, sizeof(header), 1, m_file);
+        std::fwrite(payload, 1, header.bytes, m_file);
+        m_offset += sizeof(header) + header.bytes;
+        m_records += m_block.size();
+        m_block.clear();
+    }
+
+    std::FILE* m_file = nullptr;
+    uint64_t m_offset = 0;
+    PacketTraceCodec m_codec = TRACE_CODEC_DELTA_VARINT;
+    uint32_t m_blockRecords = 8192;
+    std::vector<PacketTraceRecord> m_block;
+    std::vector<uint8_t> m_encoded;
+    std::vector<PacketTraceBlockInfo> m_blocks;
+    std::map<uint64_t, std::vector<uint32_t>> m_deviceBlocks; // (node << 32 | device) -> blocks
+    std::list<Device> m_devices; // stable addresses for the bound callbacks
+    uint64_t m_records = 0;
+};
+
+/* ---------- READER ---------- */
+class PacketTraceReader
+{
+  public:
+    typedef std::function<void(const PacketTraceRecord&)> Visitor;
+
+    ~PacketTraceReader()
+    {
+        if (m_file)
+        {
+            std::fclose(m_file);
+        }
+    }
+
+    // Loads the header and the index; no block is read yet
+    bool Open(const std::string& path)
+    {
+        m_file = std::fopen(path.c_str(), "rb");
+        if (!m_file)
+        {
+            return false;
+        }
+        PacketTraceFileHeader header;
+        PacketTraceFooter footer;
+        if (std::fread(&header, sizeof(header), 1, m_file) != 1 ||
+            std::memcmp(header.magic, PACKET_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.recordSize != sizeof(PacketTraceRecord) ||
+            std::fseek(m_file, -long(sizeof(footer)), SEEK_END) != 0 ||
+            std::fread(&footer, sizeof(footer), 1, m_file) != 1 ||
+            std::memcmp(footer.magic, PACKET_TRACE_INDEX_MAGIC, sizeof(footer.magic)) != 0 ||
+            std::fseek(m_file, footer.indexOffset, SEEK_SET) != 0)
+        {
+            return false;
+        }
+
+        uint32_t nBlocks;
+        if (std::fread(&nBlocks, sizeof(nBlocks), 1, m_file) != 1)
+        {
+            return false;
+        }
+        m_blocks.resize(nBlocks);
+        if (nBlocks &&
+            std::fread(m_blocks.data(), sizeof(PacketTraceBlockInfo), nBlocks, m_file) != nBlocks)
+        {
+            return false;
+        }
+        uint32_t nDevices;
+        if (std::fread(&nDevices, sizeof(nDevices), 1, m_file) != 1)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < nDevices; i++)
+        {
+            uint32_t key[3];
+            if (std::fread(key, sizeof(key), 1, m_file) != 1)
+            {
+                return false;
+            }
+            std::vector<uint32_t>& ids = m_deviceBlocks[(uint64_t(key[0]) << 32) | key[1]];
+            ids.resize(key[2]);
+            if (key[2] && std::fread(ids.data(), sizeof(uint32_t), key[2], m_file) != key[2])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const std::vector<PacketTraceBlockInfo>& GetBlocks() const
+    {
+        return m_blocks;
+    }
+
+    // (node, device) pairs present in the trace
+    std::vector<std::pair<uint32_t, uint32_t>> GetDevices() const
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> devices;
+        for (const auto& d : m_deviceBlocks)
+        {
+            devices.push_back({uint32_t(d.first >> 32), uint32_t(d.first)});
+        }
+        return devices;
+    }
+
+    uint64_t GetRecordCount() const
+    {
+        uint64_t n = 0;
+        for (const PacketTraceBlockInfo& b : m_blocks)
+        {
+            n += b.nRecords;
+        }
+        return n;
+    }
+
+    // Visits records with startNs <= time <= stopNs, optionally of one
+    // (node, device) only (-1 = any). Only blocks the index selects are read.
+    uint64_t Query(int64_t startNs, int64_t stopNs, int32_t node, int32_t device, Visitor visit)
+    {
+        std::vector<uint32_t> candidates;
+        auto first = std::lower_bound(m_blocks.begin(), m_blocks.end(), startNs,
+                                      [](const PacketTraceBlockInfo& b, int64_t t) {
+                                          return b.lastNs < t;
+                                      });
+        for (auto it = first; it != m_blocks.end() && it->firstNs <= stopNs; ++it)
+        {
+            candidates.push_back(it - m_blocks.begin());
+        }
+
+        if (node >= 0 && device >= 0)
+        {
+            auto d = m_deviceBlocks.find((uint64_t(node) << 32) | uint32_t(device));
+            if (d == m_deviceBlocks.end())
+            {
+                return 0;
+            }
+            std::vector<uint32_t> both;
+            std::set_intersection(candidates.begin(), candidates.end(), d->second.begin(),
+                                  d->second.end(), std::back_inserter(both));
+            candidates.swap(both);
+        }
+
+        uint64_t visited = 0;
+        for (uint32_t id : candidates)
+        {
+            if (!ReadBlock(id))
+            {
+                break;
+            }
+            for (const PacketTraceRecord& r : m_records)
+            {
+                if (r.timeNs < startNs || r.timeNs > stopNs ||
+                    (node >= 0 && r.node != uint32_t(node)) ||
+                    (device >= 0 && r.device != uint32_t(device)))
+                {
+                    continue;
+                }
+                visit(r);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+  private:
+    bool ReadBlock(uint32_t id)
+    {
+        const PacketTraceBlockInfo& info = m_blocks[id];
+        PacketTraceBlockHeader header;
+        if (std::fseek(m_file, info.offset, SEEK_SET) != 0 ||
+            std::fread(&header, sizeof(header), 1, m_file) != 1)
+        {
+            return false;
+        }
+        m_records.resize(header.nRecords);
+        if (header.codec == TRACE_CODEC_RAW)
+        {
+            return std::fread(m_records.data(), sizeof(PacketTraceRecord), header.nRecords,
+                              m_file) == header.nRecords;
+        }
+        m_payload.resize(header.bytes);
+        return std::fread(m_payload.data(), 1, header.bytes, m_file) == header.bytes &&
+               PacketTraceCodecDeltaVarint::Decode(m_payload.data(), header.bytes,
+                                                   m_records.data(), header.nRecords);
+    }
+
+    std::FILE* m_file = nullptr;
+    std::vector<PacketTraceBlockInfo> m_blocks;
+    std::map<uint64_t, std::vector<uint32_t>> m_deviceBlocks;
+    std::vector<PacketTraceRecord> m_records;
+    std::vector<uint8_t> m_payload;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_TRACE_H */
@@ -0,0 +1,407 @@
+/*
+ * Constant-memory per-flow delay and jitter percentiles.
+ *
+ * DelaySketch is a log-linear (HDR-style) histogram over nanoseconds: 64
+ * sub-buckets per power of two, so any quantile is within ~1.6% of the
+ * true value. Only the span of octaves actually observed is allocated,
+ * and never more than ~3700 counters. Sketches merge exactly, so results
+ * of parallel replications can be combined after the fact (Serialize()/
+ * Deserialize() carry them through SUMMARY lines).
+ *
+ * DelaySketchMonitor timestamps packets as they leave their source node and
+ * updates the flow's sketches on local delivery, keyed by the FlowMonitor
+ * classifier's FlowId so it plugs into the usual GetFlowStats() loop:
+ *
+ *    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+ *    DelaySketchMonitor sketches;
+ *    sketches.Install(NodeContainer::GetGlobal(),
+ *                     DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()));
+ *    ...
+ *    for (auto &flow : monitor->GetFlowStats())
+ *        sketches.Print(flow.first, cout);
+ *
+ * Without a classifier, Add() takes delays measured elsewhere, e.g. from
+ * LightFlowMonitor's delay callback.
+ */
+
+#ifndef DELAY_SKETCH_H
+#define DELAY_SKETCH_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/* ---------- SKETCH ---------- */
+class DelaySketch
+{
+  public:
+    static const int kSubBits = 6;
+    static const uint32_t kSubBuckets = 1u << kSubBits;
+
+    void Add(int64_t value)
+    {
+        if (value < 0)
+        {
+            value = 0;
+        }
+        AddToBucket(BucketOf(value), 1);
+        if (m_count == 0 || value < m_min)
+        {
+            m_min = value;
+        }
+        if (value > m_max)
+        {
+            m_max = value;
+        }
+        m_count++;
+        m_sum += value;
+    }
+
+    void Merge(const DelaySketch& other)
+    {
+        if (other.m_count == 0)
+        {
+            return;
+        }
+        for (size_t i = 0; i < other.m_counts.size(); i++)
+        {
+            if (other.m_counts[i])
+            {
+                AddToBucket(other.m_base + i, other.m_counts[i]);
+            }
+        }
+        m_min = m_count == 0 ? other.m_min : std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+    }
+
+    // Value at quantile q in [0, 1]; 0 for an empty sketch
+    int64_t Quantile(double q) const
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = uint64_t(q * m_count + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, m_count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < m_counts.size(); i++)
+        {
+            seen += m_counts[i];
+            if (seen >= rank)
+            {
+                int64_t lower;
+                int64_t width;
+                BucketRange(m_base + i, &lower, &width);
+                int64_t v = lower + width / 2;
+                return std::max(m_min, std::min(m_max, v));
+            }
+        }
+        return m_max;
+    }
+
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+    double GetMean() const
+    {
+        return m_count ? double(m_sum) / m_count : 0;
+    }
+
+    int64_t GetMin() const
+    {
+        return m_min;
+    }
+
+    int64_t GetMax() const
+    {
+        return m_max;
+    }
+
+    // Whitespace-free form: sum/min/max/bucket:count,bucket:count,...
+    std::string Serialize() const
+    {
+        std::ostringstream os;
+        os << m_sum << '/' << m_min << '/' << m_max << '/';
+        bool first = true;
+        for (size_t i = 0; i < m_counts.size(); i++)
+        {
+            if (m_counts[i])
+            {
+                os << (first ? "" : ",") << m_base + i << ':' << m_counts[i];
+                first = false;
+            }
+        }
+        return os.str();
+    }
+
+    static DelaySketch Deserialize(const std::string& text)
+    {
+        DelaySketch s;
+        std::istringstream in(text);
+        char sep;
+        int64_t sum;
+        int64_t min;
+        int64_t max;
+        if (!(in >> sum >> sep >> min >> sep >> max >> sep))
+        {
+            return s;
+        }
+        uint64_t bucket;
+        uint64_t count;
+        while (in >> bucket >> sep >> count)
+        {
+            s.AddToBucket(bucket, count);
+            s.m_count += count;
+            in >> sep;
+        }
+        s.m_sum = sum;
+        s.m_min = min;
+        s.m_max = max;
+        return s;
+    }
+
+  private:
+    static uint32_t BucketOf(int64_t v)
+    {
+        if (v < int64_t(kSubBuckets))
+        {
+            return uint32_t(v);
+        }
+        int msb = 63 - __builtin_clzll(uint64_t(v));
+        int shift = msb - kSubBits;
+        uint32_t sub = uint32_t(v >> shift) - kSubBuckets;
+        return uint32_t(shift + 1) * kSubBuckets + sub;
+    }
+
+    static void BucketRange(uint32_t bucket, int64_t* lower, int64_t* width)
+    {
+        uint32_t group = bucket >> kSubBits;
+        uint32_t sub = bucket & (kSubBuckets - 1);
+        if (group == 0)
+        {
+            *lower = sub;
+            *width = 1;
+            return;
+        }
+        *lower = int64_t(kSubBuckets + sub) << (group - 1);
+        *width = int64_t(1) << (group - 1);
+    }
+
+    // Grows the dense counter window to cover bucket
+    void AddToBucket(uint32_t bucket, uint64_t n)
+    {
+        if (m_counts.empty())
+        {
+            m_base = bucket;
+            m_counts.assign(1, 0);
+        }
+        else if (bucket < m_base)
+        {
+            m_counts.insert(m_counts.begin(), m_base - bucket, 0);
+            m_base = bucket;
+        }
+        else if (bucket >= m_base + m_counts.size())
+        {
+            m_counts.resize(bucket - m_base + 1, 0);
+        }
+        m_counts[bucket - m_base] += n;
+    }
+
+    uint32_t m_base = 0;
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count = 0;
+    int64_t m_sum = 0;
+    int64_t m_min = 0;
+    int64_t m_max = 0;
+};
+
+/* ---------- TIMESTAMP TAG ---------- */
+class DelaySketchTag : public Tag
+{
+  public:
+    DelaySketchTag() = default;
+
+    DelaySketchTag(uint32_t flowId, int64_t txNs)
+        : m_flowId(flowId),
+          m_txNs(txNs)
+    {
+    }
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::DelaySketchTag")
+                                .SetParent<Tag>()
+                                .SetGroupName("FlowMonitor")
+                                .AddConstructor<DelaySketchTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return 12;
+    }
+
+    void Serialize(TagBuffer buf) const override
+    {
+        buf.WriteU32(m_flowId);
+        buf.WriteU64(m_txNs);
+    }
+
+    void Deserialize(TagBuffer buf) override
+    {
+        m_flowId = buf.ReadU32();
+        m_txNs = buf.ReadU64();
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "flow=" << m_flowId << " tx=" << m_txNs;
+    }
+
+    uint32_t m_flowId = 0;
+    int64_t m_txNs = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DelaySketchTag);
+
+/* ---------- PER-FLOW MONITOR ---------- */
+class DelaySketchMonitor
+{
+  public:
+    struct FlowSketches
+    {
+        DelaySketch delay;
+        DelaySketch jitter;
+        int64_t lastDelay = -1;
+    };
+
+    void Install(NodeContainer nodes, Ptr<Ipv4FlowClassifier> classifier)
+    {
+        m_classifier = classifier;
+        for (uint32_t i = 0; i < nodes.GetN(); i++)
+        {
+            Ptr<Ipv4L3Protocol> ipv4 = nodes.Get(i)->GetObject<Ipv4L3Protocol>();
+            if (!ipv4)
+            {
+                continue;
+            }
+            ipv4->TraceConnectWithoutContext(
+                "SendOutgoing", MakeCallback(&DelaySketchMonitor::SendOutgoing, this));
+            ipv4->TraceConnectWithoutContext(
+                "LocalDeliver", MakeCallback(&DelaySketchMonitor::LocalDeliver, this));
+        }
+    }
+
+    // Records one delivered packet's one-way delay
+    void Add(FlowId flowId, int64_t delayNs)
+    {
+        FlowSketches& f = m_flows[flowId];
+        f.delay.Add(delayNs);
+        if (f.lastDelay >= 0)
+        {
+            f.jitter.Add(delayNs > f.lastDelay ? delayNs - f.lastDelay : f.lastDelay - delayNs);
+        }
+        f.lastDelay = delayNs;
+    }
+
+    // Sketches of one flow; empty sketches if it never delivered a packet
+    const FlowSketches& Get(FlowId flowId) const
+    {
+        static const FlowSketches empty;
+        auto it = m_flows.find(flowId);
+        return it != m_flows.end() ? it->second : empty;
+    }
+
+    // Whitespace-free "delay;jitter" form of one flow's sketches, e.g. to
+    // move them between processes; Merge() adds it to a flow
+    std::string Serialize(FlowId flowId) const
+    {
+        const FlowSketches& f = Get(flowId);
+        return f.delay.Serialize() + ";" + f.jitter.Serialize();
+    }
+
+    void Merge(FlowId flowId, const std::string& text)
+    {
+        size_t semi = text.find(';');
+        FlowSketches& f = m_flows[flowId];
+        f.delay.Merge(DelaySketch::Deserialize(text.substr(0, semi)));
+        if (semi != std::string::npos)
+        {
+            f.jitter.Merge(DelaySketch::Deserialize(text.substr(semi + 1)));
+        }
+    }
+
+    void Print(FlowId flowId, std::ostream& os) const
+    {
+        const FlowSketches& f = Get(flowId);
+        if (f.delay.GetCount() == 0)
+        {
+            return;
+        }
+        os << std::fixed << std::setprecision(3)
+           << "  Delay p50/p99/p99.9: "
+           << f.delay.Quantile(0.5) / 1e6 << " / "
+           << f.delay.Quantile(0.99) / 1e6 << " / "
+           << f.delay.Quantile(0.999) / 1e6 << " ms\n"
+           << "  Jitter p50/p99/p99.9: "
+           << f.jitter.Quantile(0.5) / 1e6 << " / "
+           << f.jitter.Quantile(0.99) / 1e6 << " / "
+           << f.jitter.Quantile(0.999) / 1e6 << " ms\n"
+           << std::defaultfloat;
+    }
+
+  private:
+    void SendOutgoing(const Ipv4Header& header, Ptr<const Packet> payload, uint32_t interface)
+    {
+        DelaySketchTag tag;
+        if (payload->PeekPacketTag(tag))
+        {
+            return;
+        }
+        uint32_t flowId;
+        uint32_t packetId;
+        if (!m_classifier->Classify(header, payload, &flowId, &packetId))
+        {
+            return;
+        }
+        payload->AddPacketTag(DelaySketchTag(flowId, Simulator::Now().GetNanoSeconds()));
+    }
+
+    void LocalDeliver(const Ipv4Header& header, Ptr<const Packet> payload, uint32_t interface)
+    {
+        DelaySketchTag tag;
+        if (!payload->PeekPacketTag(tag))
+        {
+            return;
+        }
+        Add(tag.m_flowId, Simulator::Now().GetNanoSeconds() - tag.m_txNs);
+    }
+
+    Ptr<Ipv4FlowClassifier> m_classifier;
+    std::unordered_map<FlowId, FlowSketches> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* DELAY_SKETCH_H */
@@ -0,0 +1,380 @@
+/*
+ * Fluid model of constant-rate background traffic at a FIFO bottleneck.
+ *
+ * FluidQueueDisc replaces the root queue disc of the bottleneck device. The
+ * background flows never become packets: each one is a rate that is on
+ * between its start and stop time. Only the foreground packets (TCP, probes)
+ * pass through the queue disc, and they share a single FIFO with the fluid.
+ *
+ * The queue is tracked as the unfinished work W in bytes, which drains at
+ * the link rate C and fills with the summed fluid rate:
+ *
+ *    dW/dt = lambda(t) - C   while 0 < W < limit   (fluid above the limit is lost)
+ *
+ * W is advanced lazily whenever a foreground packet arrives or a fluid flow
+ * starts or stops, so the fluid costs two events per flow in total. A
+ * foreground packet of s bytes arriving at t is dropped if W + s exceeds the
+ * buffer. Otherwise it is held and handed to the device at t + W / C, when
+ * all the work queued ahead of it, fluid included, has gone out. The device
+ * then transmits it at C. That is the departure time the packet would have
+ * in a FIFO packet queue fed with the same byte stream.
+ *
+ * Under overload (fluid rate above C, buffer full) a drop-tail queue has no
+ * room for anyone except right after a departure, so every flow loses the
+ * same fraction 1 - C / lambda. A foreground packet that finds the buffer
+ * full is therefore admitted with probability C / lambda and displaces fluid.
+ *
+ * The buffer is the queue disc's MaxSize plus the device queue (which stays
+ * empty, as packets are only released to an idle device) plus the packet in
+ * transmission. Packet counts are converted at PacketSize bytes each. Rates
+ * and sizes include the 2-byte PPP header.
+ *
+ * Usage:
+ *    Ptr<FluidQueueDisc> fluid = FluidQueueDisc::Install(topo.bottleneck.Get(0), QueueSize("5p"));
+ *    fluid->AddCbrFlow(DataRate("20Mbps"), 1472, Seconds(1), Seconds(10));   // OnOff UDP equivalent
+ *    ...
+ *    fluid->Print(std::cout);
+ *    fluid->PrintSummary(std::cout);   // SUMMARY scope=fluid ... / scope=fluidQueue ...
+ */
+
+#ifndef FLUID_BACKGROUND_H
+#define FLUID_BACKGROUND_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+class FluidQueueDisc : public QueueDisc
+{
+  public:
+    static constexpr const char* FLUID_OVERFLOW_DROP = "Fluid buffer overflow";
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::FluidQueueDisc")
+                .SetParent<QueueDisc>()
+                .SetGroupName("TrafficControl")
+                .AddConstructor<FluidQueueDisc>()
+                .AddAttribute("MaxSize",
+                              "Buffer of the queue disc, shared by fluid and packets",
+                              QueueSizeValue(QueueSize("0p")),
+                              MakeQueueSizeAccessor(&FluidQueueDisc::m_maxSize),
+                              MakeQueueSizeChecker())
+                .AddAttribute("DeviceSize",
+                              "Device queue behind the queue disc, counted into the buffer",
+                              QueueSizeValue(QueueSize("0p")),
+                              MakeQueueSizeAccessor(&FluidQueueDisc::m_deviceSize),
+                              MakeQueueSizeChecker())
+                .AddAttribute("DataRate",
+                              "Link rate C of the bottleneck device",
+                              DataRateValue(DataRate("5Mbps")),
+                              MakeDataRateAccessor(&FluidQueueDisc::m_rate),
+                              MakeDataRateChecker())
+                .AddAttribute("PacketSize",
+                              "Bytes per packet when a size is given in packets",
+                              UintegerValue(1500),
+                              MakeUintegerAccessor(&FluidQueueDisc::m_packetSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("LinkOverhead",
+                              "Link-layer header bytes added by the device",
+                              UintegerValue(2),
+                              MakeUintegerAccessor(&FluidQueueDisc::m_overhead),
+                              MakeUintegerChecker<uint32_t>());
+        return tid;
+    }
+
+    FluidQueueDisc()
+        : QueueDisc(QueueDiscSizePolicy::NO_LIMITS)
+    {
+        m_random = CreateObject<UniformRandomVariable>();
+    }
+
+    // Fixes the stream of the overload admission draws
+    int64_t AssignStreams(int64_t stream)
+    {
+        m_random->SetStream(stream);
+        return 1;
+    }
+
+    // Replaces the root queue disc of a point-to-point device; the device
+    // rate and queue size are read from the device
+    static Ptr<FluidQueueDisc> Install(Ptr<NetDevice> device, const QueueSize& maxSize)
+    {
+        Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device);
+        NS_ABORT_MSG_UNLESS(p2p, "FluidQueueDisc: the bottleneck must be a point-to-point device");
+        DataRateValue rate;
+        p2p->GetAttribute("DataRate", rate);
+
+        TrafficControlHelper tch;
+        Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+        if (tc && tc->GetRootQueueDiscOnDevice(device))
+        {
+            tch.Uninstall(device);
+        }
+        tch.SetRootQueueDisc("ns3::FluidQueueDisc",
+                             "MaxSize", QueueSizeValue(maxSize),
+                             "DeviceSize", QueueSizeValue(p2p->GetQueue()->GetMaxSize()),
+                             "DataRate", rate);
+        return DynamicCast<FluidQueueDisc>(tch.Install(device).Get(0));
+    }
+
+    // A constant-rate UDP flow of payloadSize-byte datagrams at rate (the
+    // OnOffApplication DataRate, i.e. payload bits), on in [start, stop).
+    // Added late, e.g. in a warm-start branch, it is on from now.
+    void AddCbrFlow(DataRate rate, uint32_t payloadSize, Time start, Time stop)
+    {
+        start = std::max(start, Simulator::Now());
+        stop = std::max(stop, start);
+        const uint32_t ipUdp = 28;
+        Flow f;
+        f.ipRate = rate.GetBitRate() * double(payloadSize + ipUdp) / payloadSize;
+        f.wireRate = f.ipRate * double(payloadSize + ipUdp + m_overhead) / (payloadSize + ipUdp);
+        f.start = start;
+        f.stop = stop;
+        m_flows.push_back(f);
+        size_t i = m_flows.size() - 1;
+        Simulator::Schedule(start - Simulator::Now(), &FluidQueueDisc::SetActive, this, i, true);
+        Simulator::Schedule(stop - Simulator::Now(), &FluidQueueDisc::SetActive, this, i, false);
+    }
+
+    // Unfinished work in bytes, fluid and packets
+    double GetBacklog()
+    {
+        Advance();
+        return m_work;
+    }
+
+    void Print(std::ostream& os)
+    {
+        Advance();
+        for (size_t i = 0; i < m_flows.size(); i++)
+        {
+            const Flow& f = m_flows[i];
+            os << "Fluid flow " << i << ": " << f.ipRate / 1e6 << " Mbps offered, "
+               << GetThroughput(f) / 1e6 << " Mbps delivered, loss "
+               << GetLossRatio(f) * 100 << "%\n";
+        }
+        os << "Fluid queue: mean backlog " << GetMeanBacklog() << " bytes ("
+           << GetMeanBacklog() * 8 / m_rate.GetBitRate() * 1e3 << " ms), "
+           << m_foregroundDrops << " foreground drops\n";
+    }
+
+    void PrintSummary(std::ostream& os)
+    {
+        Advance();
+        for (size_t i = 0; i < m_flows.size(); i++)
+        {
+            const Flow& f = m_flows[i];
+            os << "SUMMARY scope=fluid flow=" << i
+               << " offeredMbps=" << f.ipRate / 1e6
+               << " throughputMbps=" << GetThroughput(f) / 1e6
+               << " lossRatio=" << GetLossRatio(f) << "\n";
+        }
+        os << "SUMMARY scope=fluidQueue"
+           << " meanBacklog=" << GetMeanBacklog()
+           << " meanDelay=" << GetMeanBacklog() * 8 / m_rate.GetBitRate()
+           << " foregroundDrops=" << m_foregroundDrops << "\n";
+    }
+
+  private:
+    struct Flow
+    {
+        double ipRate = 0;   // bit/s at the IP layer, as FlowMonitor counts
+        double wireRate = 0; // bit/s including the link header
+        Time start;
+        Time stop;
+        bool active = false;
+        double offered = 0;  // wire bytes
+        double lost = 0;     // wire bytes
+    };
+
+    bool CheckConfig() override
+    {
+        if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0)
+        {
+            NS_LOG_UNCOND("FluidQueueDisc cannot have classes or packet filters");
+            return false;
+        }
+        if (GetNInternalQueues() == 0)
+        {
+            // The fluid model decides about drops; the internal queue only stores
+            AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+                "MaxSize",
+                QueueSizeValue(QueueSize(QueueSizeUnit::PACKETS,
+                                         std::numeric_limits<uint32_t>::max()))));
+        }
+        return true;
+    }
+
+    void InitializeParams() override
+    {
+        m_limit = Bytes(m_maxSize) + Bytes(m_deviceSize) + m_packetSize;
+        m_last = Simulator::Now();
+    }
+
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override
+    {
+        Advance();
+        double size = item->GetSize() + m_overhead;
+        double ahead = m_work;
+        if (m_work + size > m_limit)
+        {
+            // A full drop-tail buffer under overload admits arrivals in
+            // proportion to the service rate, whichever flow sends them. An
+            // admitted packet takes the tail of the buffer from the fluid,
+            // but never from a queued foreground packet.
+            double rate = m_rate.GetBitRate();
+            double tail = std::max(0.0, (m_lastEnd - Simulator::Now()).GetSeconds() * rate / 8);
+            bool overload = m_fluidRate > rate && tail + size <= m_limit;
+            if (!overload || m_random->GetValue() >= rate / m_fluidRate)
+            {
+                m_foregroundDrops++;
+                DropBeforeEnqueue(item, FLUID_OVERFLOW_DROP);
+                return false;
+            }
+            ahead = m_limit - size;
+            LoseFluid(m_work + size - m_limit);
+            m_work = m_limit - size;
+        }
+        double wait = ahead * 8e9 / m_rate.GetBitRate();
+        Time release = Simulator::Now() + NanoSeconds(int64_t(std::ceil(wait)));
+        m_release.push_back(release);
+        m_lastEnd = release + m_rate.CalculateBytesTxTime(uint32_t(size));
+        m_work += size;
+        return GetInternalQueue(0)->Enqueue(item);
+    }
+
+    Ptr<QueueDiscItem> DoDequeue() override
+    {
+        if (m_release.empty())
+        {
+            return nullptr;
+        }
+        Time wait = m_release.front() - Simulator::Now();
+        if (wait.IsStrictlyPositive())
+        {
+            // Fluid ahead of the packet is still being served
+            if (!m_wake.IsRunning())
+            {
+                m_wake = Simulator::Schedule(wait, &QueueDisc::Run, this);
+            }
+            return nullptr;
+        }
+        m_release.pop_front();
+        return GetInternalQueue(0)->Dequeue();
+    }
+
+    // Charges bytes of overflow to the active fluid flows by rate
+    void LoseFluid(double bytes)
+    {
+        for (Flow& f : m_flows)
+        {
+            if (f.active)
+            {
+                f.lost += bytes * f.wireRate / m_fluidRate;
+            }
+        }
+    }
+
+    void SetActive(size_t i, bool active)
+    {
+        Advance();
+        m_flows[i].active = active;
+        m_fluidRate = 0;
+        for (const Flow& f : m_flows)
+        {
+            m_fluidRate += f.active ? f.wireRate : 0;
+        }
+    }
+
+    // Brings W up to now; rates are constant since the last call
+    void Advance()
+    {
+        Time now = Simulator::Now();
+        double dt = (now - m_last).GetSeconds();
+        if (dt <= 0)
+        {
+            return;
+        }
+        m_last = now;
+        double in = m_fluidRate * dt / 8;
+        double out = m_rate.GetBitRate() * dt / 8;
+        double before = m_work;
+        double after = std::max(0.0, m_work + in - out);
+        for (Flow& f : m_flows)
+        {
+            if (f.active)
+            {
+                f.offered += in * f.wireRate / m_fluidRate;
+            }
+        }
+        if (after > m_limit)
+        {
+            LoseFluid(after - m_limit);
+            after = m_limit;
+        }
+        m_work = after;
+        m_backlogIntegral += 0.5 * (before + after) * dt;
+        m_elapsed += dt;
+    }
+
+    double Bytes(const QueueSize& size) const
+    {
+        return size.GetUnit() == QueueSizeUnit::PACKETS ? double(size.GetValue()) * m_packetSize
+                                                        : size.GetValue();
+    }
+
+    double GetLossRatio(const Flow& f) const
+    {
+        return f.offered > 0 ? f.lost / f.offered : 0;
+    }
+
+    // Delivered rate at the IP layer while the flow is on
+    double GetThroughput(const Flow& f) const
+    {
+        return f.offered > 0 ? f.ipRate * (1 - GetLossRatio(f)) : 0;
+    }
+
+    double GetMeanBacklog() const
+    {
+        return m_elapsed > 0 ? m_backlogIntegral / m_elapsed : 0;
+    }
+
+    QueueSize m_maxSize;
+    QueueSize m_deviceSize;
+    DataRate m_rate;
+    uint32_t m_packetSize;
+    uint32_t m_overhead;
+
+    double m_limit = 0;     // bytes
+    double m_work = 0;      // bytes
+    double m_fluidRate = 0; // bit/s on the wire
+    Time m_last;
+    std::vector<Flow> m_flows;
+    std::deque<Time> m_release; // hand-off times of the queued packets
+    EventId m_wake;
+    Time m_lastEnd; // end of transmission of the last queued packet
+    Ptr<UniformRandomVariable> m_random;
+
+    uint64_t m_foregroundDrops = 0;
+    double m_backlogIntegral = 0;
+    double m_elapsed = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(FluidQueueDisc);
+
+} // namespace ns3
+
+#endif /* FLUID_BACKGROUND_H */
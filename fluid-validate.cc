@@ -0,0 +1,229 @@
+/*
+ * Validation of the fluid background model against packet-level runs.
+ *
+ * The scenario runs twice per RngRun, once with --background=packet and
+ * once with --background=fluid. The foreground flows (the destination ports
+ * given by --ports) are compared on the SUMMARY scope=flow lines of both
+ * runs, averaged over all runs:
+ *
+ *    mean delay, p99 delay   relative error within --delayTolerance
+ *    throughput              relative error within --throughputTolerance
+ *    loss ratio              absolute difference within --lossTolerance
+ *
+ * The event counts and wall times of the two modes are reported next to
+ * each other. The exit status is 1 if any metric is out of tolerance or a
+ * run fails.
+ *
+ * Usage:
+ *    ./ns3 build tcpvsudp queuedelay fluid-validate
+ *    ./ns3 run "fluid-validate --binary=build/scratch/ns3-dev-tcpvsudp-default
+ *               --ports=9000 --args='--fifo=1 --nUdp=1 --bottleneckRate=30Mbps'"
+ *    ./ns3 run "fluid-validate --binary=build/scratch/ns3-dev-queuedelay-default
+ *               --ports=6000 --args='--probeInterval=5 --traceFile='"
+ */
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+using namespace ns3;
+using namespace std;
+
+struct ModeResult
+{
+    double txPackets = 0;
+    double rxPackets = 0;
+    double lostPackets = 0;
+    double delaySum = 0;    // meanDelay * rxPackets, summed over flows
+    double p99Sum = 0;      // per-run p99 of the worst foreground flow
+    double throughput = 0;  // Mbps, summed over flows
+    double events = 0;
+    double wallSeconds = 0;
+    int runs = 0;
+    int failures = 0;
+
+    double MeanDelay() const
+    {
+        return rxPackets > 0 ? delaySum / rxPackets : 0;
+    }
+
+    double P99() const
+    {
+        return runs > 0 ? p99Sum / runs : 0;
+    }
+
+    double LossRatio() const
+    {
+        return txPackets > 0 ? lostPackets / txPackets : 0;
+    }
+
+    double Throughput() const
+    {
+        return runs > 0 ? throughput / runs : 0;
+    }
+};
+
+static double
+RelativeError(double fluid, double packet)
+{
+    return packet != 0 ? fabs(fluid - packet) / fabs(packet) : fabs(fluid);
+}
+
+int main(int argc, char *argv[])
+{
+    string binary = "";
+    string args = "--animMode=none";
+    string ports = "9000";
+    string runList = "1,2,3";
+    unsigned jobs = 0;
+    double delayTolerance = 0.10;
+    double throughputTolerance = 0.10;
+    double lossTolerance = 0.02;
+    string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binary", "Path to the built scenario (tcpvsudp or queuedelay)", binary);
+    cmd.AddValue("args", "Space-separated extra arguments for both modes", args);
+    cmd.AddValue("ports", "Comma-separated destination ports of the foreground flows", ports);
+    cmd.AddValue("runs", "Comma-separated RngRun values", runList);
+    cmd.AddValue("jobs", "Parallel runs (0 = one per core)", jobs);
+    cmd.AddValue("delayTolerance", "Allowed relative error of mean and p99 delay", delayTolerance);
+    cmd.AddValue("throughputTolerance", "Allowed relative error of throughput", throughputTolerance);
+    cmd.AddValue("lossTolerance", "Allowed absolute difference of the loss ratio", lossTolerance);
+    cmd.AddValue("output", "CSV file for the comparison", output);
+    cmd.Parse(argc, argv);
+
+    if (binary.empty())
+    {
+        cerr << "--binary=<path to the scenario> is required" << endl;
+        return 1;
+    }
+
+    vector<string> foreground = SplitList(ports);
+    vector<string> extra = SplitList(args, ' ');
+    const vector<string> modes = {"packet", "fluid"};
+    map<string, ModeResult> results;
+
+    /* ---------- RUN ---------- */
+    ProcessPool pool(jobs);
+    vector<string> jobMode;
+    for (const string &run : SplitList(runList))
+    {
+        for (const string &mode : modes)
+        {
+            vector<string> argv = {binary, "--background=" + mode, "--summary=1", "--RngRun=" + run};
+            argv.insert(argv.end(), extra.begin(), extra.end());
+            pool.Submit(argv);
+            jobMode.push_back(mode);
+        }
+    }
+
+    size_t done = 0;
+    pool.Wait([&](size_t index, const ProcessResult &result) {
+        ModeResult &m = results[jobMode[index]];
+        vector<SummaryLine> lines = ParseSummary(result.output);
+        SummaryLine run = FindSummary(lines, "scope", "run");
+        if (result.status != 0 || run.empty() || run.count("cached"))
+        {
+            m.failures++;
+        }
+        else
+        {
+            double p99 = 0;
+            for (SummaryLine &l : lines)
+            {
+                if (l["scope"] != "flow" ||
+                    find(foreground.begin(), foreground.end(), l["dstPort"]) == foreground.end())
+                {
+                    continue;
+                }
+                double rx = stod(l["rxPackets"]);
+                m.txPackets += stod(l["txPackets"]);
+                m.rxPackets += rx;
+                m.lostPackets += stod(l["lostPackets"]);
+                m.delaySum += stod(l["meanDelay"]) * rx;
+                m.throughput += stod(l["throughputMbps"]);
+                p99 = max(p99, stod(l["delayP99"]));
+            }
+            m.p99Sum += p99;
+            m.events += stod(run["events"]);
+            m.wallSeconds += stod(run["wallSeconds"]);
+            m.runs++;
+        }
+        cerr << "\r" << ++done << "/" << jobMode.size() << " runs done" << flush;
+    });
+    cerr << "\n";
+
+    /* ---------- COMPARE ---------- */
+    const ModeResult &packet = results["packet"];
+    const ModeResult &fluid = results["fluid"];
+    if (packet.runs == 0 || fluid.runs == 0)
+    {
+        cerr << "No successful runs (" << packet.failures << " packet, " << fluid.failures
+             << " fluid failures)" << endl;
+        return 1;
+    }
+
+    struct Row
+    {
+        string metric;
+        double packet;
+        double fluid;
+        double error;
+        double tolerance;
+    };
+    vector<Row> rows = {
+        {"meanDelay(s)", packet.MeanDelay(), fluid.MeanDelay(),
+         RelativeError(fluid.MeanDelay(), packet.MeanDelay()), delayTolerance},
+        {"delayP99(s)", packet.P99(), fluid.P99(),
+         RelativeError(fluid.P99(), packet.P99()), delayTolerance},
+        {"throughput(Mbps)", packet.Throughput(), fluid.Throughput(),
+         RelativeError(fluid.Throughput(), packet.Throughput()), throughputTolerance},
+        {"lossRatio", packet.LossRatio(), fluid.LossRatio(),
+         fabs(fluid.LossRatio() - packet.LossRatio()), lossTolerance},
+    };
+
+    ofstream csv;
+    if (!output.empty())
+    {
+        csv.open(output);
+        csv << "metric,packet,fluid,error,tolerance,pass\n";
+    }
+
+    cout << left << setw(18) << "metric" << setw(14) << "packet" << setw(14) << "fluid"
+         << setw(10) << "error" << "result\n";
+    uint32_t failed = packet.failures + fluid.failures;
+    for (const Row &r : rows)
+    {
+        bool pass = r.error <= r.tolerance;
+        failed += pass ? 0 : 1;
+        cout << left << setw(18) << r.metric << setw(14) << r.packet << setw(14) << r.fluid
+             << setw(10) << r.error << (pass ? "ok" : "OUT OF TOLERANCE") << "\n";
+        if (csv.is_open())
+        {
+            csv << r.metric << ',' << r.packet << ',' << r.fluid << ',' << r.error << ','
+                << r.tolerance << ',' << pass << '\n';
+        }
+    }
+
+    double packetEvents = packet.events / packet.runs;
+    double fluidEvents = fluid.events / fluid.runs;
+    cout << "\nEvents per run: " << uint64_t(packetEvents) << " packet, " << uint64_t(fluidEvents)
+         << " fluid (" << (fluidEvents > 0 ? packetEvents / fluidEvents : 0) << "x fewer)\n"
+         << "Wall time per run: " << packet.wallSeconds / packet.runs << " s packet, "
+         << fluid.wallSeconds / fluid.runs << " s fluid\n";
+
+    if (failed > 0)
+    {
+        cout << failed << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
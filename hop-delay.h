@@ -0,0 +1,316 @@
+/*
+ * In-simulation per-hop delay decomposition.
+ *
+ * For every IPv4 packet the monitor timestamps, at each hop, the arrival at
+ * the IP layer (SendOutgoing at the source, UnicastForward at routers), the
+ * start and the end of transmission on the point-to-point device. When the
+ * packet is delivered the end-to-end delay is split per hop into
+ *
+ *    queuing       = start of transmission - arrival   (qdisc + device queue)
+ *    transmission  = end of transmission - start of transmission
+ *    propagation   = arrival at the next hop - end of transmission
+ *
+ * and added to per-flow (5-tuple) totals kept in memory. Nothing is written
+ * during the run.
+ *
+ * Usage:
+ *    HopDelayMonitor hops;
+ *    hops.Install(nodes);
+ *    Simulator::Run();
+ *    hops.Print(std::cout);
+ */
+
+#ifndef HOP_DELAY_H
+#define HOP_DELAY_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+class HopDelayMonitor
+{
+  public:
+    struct FlowKey
+    {
+        uint32_t src;
+        uint32_t dst;
+        uint16_t srcPort;
+        uint16_t dstPort;
+        uint8_t protocol;
+
+        bool operator<(const FlowKey& o) const
+        {
+            return std::tie(src, dst, srcPort, dstPort, protocol) <
+                   std::tie(o.src, o.dst, o.srcPort, o.dstPort, o.protocol);
+        }
+    };
+
+    // Sums in nanoseconds over the packets that crossed this hop
+    struct HopStats
+    {
+        uint32_t node = 0;
+        uint64_t packets = 0;
+        int64_t queuing = 0;
+        int64_t transmission = 0;
+        int64_t propagation = 0;
+        int64_t maxQueuing = 0;
+    };
+
+    struct FlowStats
+    {
+        uint64_t packets = 0;
+        int64_t endToEnd = 0;
+        std::vector<HopStats> hops;
+    };
+
+    // Pending packets older than this are treated as lost and forgotten
+    void SetMaxAge(Time age)
+    {
+        m_maxAge = age;
+    }
+
+    void Install(NodeContainer nodes)
+    {
+        for (uint32_t i = 0; i < nodes.GetN(); i++)
+        {
+            Ptr<Node> node = nodes.Get(i);
+            Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+            if (!ipv4)
+            {
+                continue;
+            }
+            m_nodes.push_back(NodeHooks{this, node->GetId()});
+            NodeHooks* hooks = &m_nodes.back();
+            ipv4->TraceConnectWithoutContext("SendOutgoing",
+                                             MakeCallback(&NodeHooks::SendOutgoing, hooks));
+            ipv4->TraceConnectWithoutContext("UnicastForward",
+                                             MakeCallback(&NodeHooks::Forward, hooks));
+            ipv4->TraceConnectWithoutContext("LocalDeliver",
+                                             MakeCallback(&NodeHooks::LocalDeliver, hooks));
+
+            for (uint32_t d = 0; d < node->GetNDevices(); d++)
+            {
+                Ptr<PointToPointNetDevice> dev =
+                    DynamicCast<PointToPointNetDevice>(node->GetDevice(d));
+                if (dev)
+                {
+                    dev->TraceConnectWithoutContext("PhyTxBegin",
+                                                    MakeCallback(&NodeHooks::TxBegin, hooks));
+                    dev->TraceConnectWithoutContext("PhyTxEnd",
+                                                    MakeCallback(&NodeHooks::TxEnd, hooks));
+                }
+            }
+        }
+    }
+
+    const std::map<FlowKey, FlowStats>& GetFlows() const
+    {
+        return m_flows;
+    }
+
+    void Print(std::ostream& os) const
+    {
+        for (const auto& flow : m_flows)
+        {
+            const FlowKey& k = flow.first;
+            const FlowStats& f = flow.second;
+            if (f.packets == 0)
+            {
+                continue;
+            }
+            os << "Flow " << Ipv4Address(k.src) << ":" << k.srcPort << " -> "
+               << Ipv4Address(k.dst) << ":" << k.dstPort << " (proto " << unsigned(k.protocol)
+               << "), " << f.packets << " packets, mean end-to-end "
+               << std::fixed << std::setprecision(3) << f.endToEnd / 1e6 / f.packets << " ms\n";
+            for (size_t h = 0; h < f.hops.size(); h++)
+            {
+                const HopStats& s = f.hops[h];
+                if (s.packets == 0)
+                {
+                    continue;
+                }
+                os << "  Hop " << h << " (node " << s.node << "): queuing "
+                   << s.queuing / 1e6 / s.packets << " ms (max " << s.maxQueuing / 1e6
+                   << "), transmission " << s.transmission / 1e6 / s.packets
+                   << " ms, propagation " << s.propagation / 1e6 / s.packets << " ms\n";
+            }
+            os << std::defaultfloat;
+        }
+    }
+
+  private:
+    struct Hop
+    {
+        uint32_t node;
+        int64_t arrival;
+        int64_t txBegin = -1;
+        int64_t txEnd = -1;
+    };
+
+    struct Pending
+    {
+        FlowKey key;
+        std::vector<Hop> hops;
+    };
+
+    struct NodeHooks
+    {
+        HopDelayMonitor* monitor;
+        uint32_t node;
+
+        void SendOutgoing(const Ipv4Header& header, Ptr<const Packet> payload, uint32_t)
+        {
+            monitor->SendOutgoing(node, header, payload);
+        }
+
+        void Forward(const Ipv4Header&, Ptr<const Packet> packet, uint32_t)
+        {
+            monitor->Forward(node, packet);
+        }
+
+        void LocalDeliver(const Ipv4Header&, Ptr<const Packet> packet, uint32_t)
+        {
+            monitor->LocalDeliver(packet);
+        }
+
+        void TxBegin(Ptr<const Packet> p)
+        {
+            if (Hop* hop = monitor->Current(p->GetUid(), node))
+            {
+                hop->txBegin = Simulator::Now().GetNanoSeconds();
+            }
+        }
+
+        void TxEnd(Ptr<const Packet> p)
+        {
+            if (Hop* hop = monitor->Current(p->GetUid(), node))
+            {
+                hop->txEnd = Simulator::Now().GetNanoSeconds();
+            }
+        }
+    };
+
+    // The hop the packet is currently on, if it is at node
+    Hop* Current(uint64_t uid, uint32_t node)
+    {
+        auto it = m_pending.find(uid);
+        if (it == m_pending.end() || it->second.hops.back().node != node)
+        {
+            return nullptr;
+        }
+        return &it->second.hops.back();
+    }
+
+    void SendOutgoing(uint32_t node, const Ipv4Header& header, Ptr<const Packet> payload)
+    {
+        Pending& p = m_pending[payload->GetUid()];
+        p.key.src = header.GetSource().Get();
+        p.key.dst = header.GetDestination().Get();
+        p.key.protocol = header.GetProtocol();
+        p.key.srcPort = 0;
+        p.key.dstPort = 0;
+        uint8_t ports[4];
+        if ((p.key.protocol == 6 || p.key.protocol == 17) &&
+            payload->CopyData(ports, sizeof(ports)) == sizeof(ports))
+        {
+            p.key.srcPort = (uint16_t(ports[0]) << 8) | ports[1];
+            p.key.dstPort = (uint16_t(ports[2]) << 8) | ports[3];
+        }
+        p.hops.clear();
+        p.hops.push_back(Hop{node, Simulator::Now().GetNanoSeconds()});
+        if (!m_sweep.IsRunning())
+        {
+            m_sweep = Simulator::Schedule(m_maxAge, &HopDelayMonitor::Sweep, this);
+        }
+    }
+
+    void Forward(uint32_t node, Ptr<const Packet> packet)
+    {
+        auto it = m_pending.find(packet->GetUid());
+        if (it != m_pending.end())
+        {
+            it->second.hops.push_back(Hop{node, Simulator::Now().GetNanoSeconds()});
+        }
+    }
+
+    void LocalDeliver(Ptr<const Packet> packet)
+    {
+        auto it = m_pending.find(packet->GetUid());
+        if (it == m_pending.end())
+        {
+            return;
+        }
+        const Pending& p = it->second;
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        FlowStats& f = m_flows[p.key];
+        if (f.hops.size() < p.hops.size())
+        {
+            f.hops.resize(p.hops.size());
+        }
+        bool complete = true;
+        for (size_t h = 0; h < p.hops.size(); h++)
+        {
+            complete = complete && p.hops[h].txBegin >= 0 && p.hops[h].txEnd >= 0;
+        }
+        if (complete)
+        {
+            for (size_t h = 0; h < p.hops.size(); h++)
+            {
+                const Hop& hop = p.hops[h];
+                int64_t next = h + 1 < p.hops.size() ? p.hops[h + 1].arrival : now;
+                HopStats& s = f.hops[h];
+                s.node = hop.node;
+                s.packets++;
+                s.queuing += hop.txBegin - hop.arrival;
+                s.transmission += hop.txEnd - hop.txBegin;
+                s.propagation += next - hop.txEnd;
+                s.maxQueuing = std::max(s.maxQueuing, hop.txBegin - hop.arrival);
+            }
+            f.packets++;
+            f.endToEnd += now - p.hops.front().arrival;
+        }
+        m_pending.erase(it);
+    }
+
+    void Sweep()
+    {
+        int64_t oldest = (Simulator::Now() - m_maxAge).GetNanoSeconds();
+        for (auto it = m_pending.begin(); it != m_pending.end();)
+        {
+            if (it->second.hops.front().arrival < oldest)
+            {
+                it = m_pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        if (!m_pending.empty())
+        {
+            m_sweep = Simulator::Schedule(m_maxAge, &HopDelayMonitor::Sweep, this);
+        }
+    }
+
+    Time m_maxAge = Seconds(10);
+    EventId m_sweep;
+    std::list<NodeHooks> m_nodes; // stable addresses for the bound callbacks
+    std::unordered_map<uint64_t, Pending> m_pending; // by packet uid
+    std::map<FlowKey, FlowStats> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* HOP_DELAY_H */
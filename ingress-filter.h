@@ -0,0 +1,379 @@
+/*
+ * Enforcing ingress (uRPF-style) source filter for IPv4 routers.
+ *
+ * The filter takes the place of the traffic control layer's IPv4 protocol
+ * handler on each router device, so the node's dispatch, promiscuous
+ * handlers (sniffers) and the other protocols are left alone. It reads the
+ * source address straight out of the packet bytes (no packet copy, no
+ * header object), looks it up in a compiled per-interface prefix table and
+ * drops violators before they reach IPv4; accepted packets go on to the
+ * traffic control layer with their original packet type. Per-interface
+ * counters and a "Drop" trace source are exported.
+ *
+ * Usage:
+ *    Ptr<IngressFilter> filter = CreateObject<IngressFilter>();
+ *    filter->AllowConnectedSubnets(router, 1);
+ *    filter->AllowPrefix(1, Ipv4Address("192.168.0.0"), Ipv4Mask("/16"));
+ *    filter->Install(router);
+ *
+ * Interfaces without any allowed prefix are not filtered.
+ */
+
+#ifndef INGRESS_FILTER_H
+#define INGRESS_FILTER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+/* ---------- PREFIX TABLE ---------- */
+
+// Binary trie of allowed prefixes; Compile() flattens the top 16 bits into
+// a direct-indexed table so a lookup is one array read plus at most 16 steps.
+class PrefixTrie
+{
+  public:
+    PrefixTrie()
+    {
+        m_nodes.push_back(Node());
+    }
+
+    void Insert(uint32_t prefix, uint8_t length)
+    {
+        uint32_t n = 0;
+        for (uint8_t depth = 0; depth < length; depth++)
+        {
+            uint32_t bit = (prefix >> (31 - depth)) & 1;
+            if (m_nodes[n].child[bit] == 0)
+            {
+                m_nodes[n].child[bit] = m_nodes.size();
+                m_nodes.push_back(Node());
+            }
+            n = m_nodes[n].child[bit];
+        }
+        if (!m_nodes[n].terminal)
+        {
+            m_nodes[n].terminal = true;
+            m_prefixes++;
+        }
+        m_compiled = false;
+    }
+
+    void Compile()
+    {
+        m_top.assign(1 << kTopBits, NO_MATCH);
+        Fill(0, 0, 0);
+        m_compiled = true;
+    }
+
+    // True if some allowed prefix covers addr
+    bool Contains(uint32_t addr) const
+    {
+        int32_t e = m_top[addr >> (32 - kTopBits)];
+        if (e == ALLOW || e == NO_MATCH)
+        {
+            return e == ALLOW;
+        }
+        uint32_t n = e;
+        for (int bit = 31 - kTopBits; bit >= 0; bit--)
+        {
+            n = m_nodes[n].child[(addr >> bit) & 1];
+            if (n == 0)
+            {
+                return false;
+            }
+            if (m_nodes[n].terminal)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsCompiled() const
+    {
+        return m_compiled;
+    }
+
+    bool IsEmpty() const
+    {
+        return m_prefixes == 0;
+    }
+
+    size_t GetNPrefixes() const
+    {
+        return m_prefixes;
+    }
+
+  private:
+    static const int kTopBits = 16;
+    static const int32_t ALLOW = -1;
+    static const int32_t NO_MATCH = 0;
+
+    struct Node
+    {
+        uint32_t child[2] = {0, 0};
+        bool terminal = false;
+    };
+
+    void Fill(uint32_t n, int depth, uint32_t bits)
+    {
+        if (m_nodes[n].terminal)
+        {
+            uint32_t first = bits << (kTopBits - depth);
+            uint32_t count = 1u << (kTopBits - depth);
+            std::fill(m_top.begin() + first, m_top.begin() + first + count, ALLOW);
+            return;
+        }
+        if (depth == kTopBits)
+        {
+            m_top[bits] = n;
+            return;
+        }
+        for (uint32_t bit = 0; bit < 2; bit++)
+        {
+            if (m_nodes[n].child[bit])
+            {
+                Fill(m_nodes[n].child[bit], depth + 1, (bits << 1) | bit);
+            }
+        }
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<int32_t> m_top;
+    size_t m_prefixes = 0;
+    bool m_compiled = false;
+};
+
+/* ---------- FILTER ---------- */
+class IngressFilter : public Object
+{
+  public:
+    struct Counters
+    {
+        uint64_t received = 0;
+        uint64_t accepted = 0;
+        uint64_t dropped = 0;
+    };
+
+    typedef void (*DropTracedCallback)(Ptr<const Packet> packet, uint32_t interface);
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::IngressFilter")
+                .SetParent<Object>()
+                .SetGroupName("Internet")
+                .AddConstructor<IngressFilter>()
+                .AddTraceSource("Drop",
+                                "A packet failed the source prefix check",
+                                MakeTraceSourceAccessor(&IngressFilter::m_dropTrace),
+                                "ns3::IngressFilter::DropTracedCallback");
+        return tid;
+    }
+
+    // Allows the subnets configured on one router interface (classic ingress filtering)
+    void AllowConnectedSubnets(Ptr<Node> router, uint32_t interface)
+    {
+        Ptr<Ipv4> ipv4 = router->GetObject<Ipv4>();
+        for (uint32_t i = 0; i < ipv4->GetNAddresses(interface); i++)
+        {
+            Ipv4InterfaceAddress a = ipv4->GetAddress(interface, i);
+            AllowPrefix(interface, a.GetLocal().CombineMask(a.GetMask()), a.GetMask());
+        }
+    }
+
+    // Tables are compiled by Install(), so every prefix must come before it
+    void AllowPrefix(uint32_t interface, Ipv4Address prefix, Ipv4Mask mask)
+    {
+        NS_ABORT_MSG_IF(m_ipv4, "IngressFilter: prefixes must be added before Install()");
+        m_tables[interface].Insert(prefix.Get(), mask.GetPrefixLength());
+    }
+
+    // Loads "a.b.c.d/len" lines, skipping blank and '#' lines; malformed
+    // lines are reported on stderr and skipped. Returns the prefixes read.
+    uint32_t LoadPrefixes(uint32_t interface, const std::string& filename)
+    {
+        NS_ABORT_MSG_IF(m_ipv4, "IngressFilter: prefixes must be added before Install()");
+        std::ifstream in(filename);
+        if (!in)
+        {
+            std::cerr << filename << ": cannot open prefix file" << std::endl;
+            return 0;
+        }
+        std::string line;
+        uint32_t n = 0;
+        for (uint32_t lineNo = 1; std::getline(in, line); lineNo++)
+        {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            uint32_t prefix = 0;
+            uint8_t length = 0;
+            if (!ParsePrefix(line, &prefix, &length))
+            {
+                std::cerr << filename << ":" << lineNo << ": not a.b.c.d/len with len <= 32: "
+                          << line << std::endl;
+                continue;
+            }
+            m_tables[interface].Insert(prefix, length);
+            n++;
+        }
+        return n;
+    }
+
+    // Interposes the filter on every device of the router. Call after the
+    // internet stack is installed and all prefixes are configured.
+    void Install(Ptr<Node> router)
+    {
+        m_ipv4 = router->GetObject<Ipv4>();
+        m_tc = router->GetObject<TrafficControlLayer>();
+        NS_ASSERT_MSG(m_ipv4 && m_tc, "IngressFilter needs an installed internet stack");
+
+        // The stack registers the traffic control layer for IPv4, ARP and
+        // IPv6 on every device; unregistering drops all of them, so ARP and
+        // IPv6 are registered again and IPv4 now goes through the filter
+        Ptr<Ipv6> ipv6 = router->GetObject<Ipv6>();
+        router->UnregisterProtocolHandler(MakeCallback(&TrafficControlLayer::Receive, m_tc));
+
+        for (auto& t : m_tables)
+        {
+            t.second.Compile();
+        }
+
+        m_counters.assign(m_ipv4->GetNInterfaces(), Counters());
+        m_deviceTable.assign(router->GetNDevices(), nullptr);
+        m_deviceIface.assign(router->GetNDevices(), 0);
+        for (uint32_t d = 0; d < router->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> dev = router->GetDevice(d);
+            // Loopback delivers straight to IPv4/IPv6, not through traffic control
+            if (DynamicCast<LoopbackNetDevice>(dev))
+            {
+                continue;
+            }
+            if (ipv6 && ipv6->GetInterfaceForDevice(dev) >= 0)
+            {
+                router->RegisterProtocolHandler(MakeCallback(&TrafficControlLayer::Receive, m_tc),
+                                                Ipv6L3Protocol::PROT_NUMBER, dev);
+            }
+            int32_t iface = m_ipv4->GetInterfaceForDevice(dev);
+            if (iface < 0)
+            {
+                continue;
+            }
+            m_deviceIface[d] = iface;
+            auto t = m_tables.find(iface);
+            if (t != m_tables.end() && !t->second.IsEmpty())
+            {
+                m_deviceTable[d] = &t->second;
+            }
+            router->RegisterProtocolHandler(MakeCallback(&IngressFilter::Receive, this),
+                                            Ipv4L3Protocol::PROT_NUMBER, dev);
+            router->RegisterProtocolHandler(MakeCallback(&TrafficControlLayer::Receive, m_tc),
+                                            ArpL3Protocol::PROT_NUMBER, dev);
+        }
+    }
+
+    const Counters& GetCounters(uint32_t interface) const
+    {
+        return m_counters.at(interface);
+    }
+
+    void PrintCounters(std::ostream& os) const
+    {
+        // Interface 0 is loopback
+        for (uint32_t i = 1; i < m_counters.size(); i++)
+        {
+            const Counters& c = m_counters[i];
+            os << "Interface " << i
+               << ": received=" << c.received
+               << " accepted=" << c.accepted
+               << " dropped=" << c.dropped;
+            auto t = m_tables.find(i);
+            if (t != m_tables.end())
+            {
+                os << " prefixes=" << t->second.GetNPrefixes();
+            }
+            os << "\n";
+        }
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_ipv4 = nullptr;
+        m_tc = nullptr;
+        Object::DoDispose();
+    }
+
+  private:
+    // "a.b.c.d/len" with octets <= 255, len <= 32 and nothing after it
+    static bool ParsePrefix(const std::string& text, uint32_t* prefix, uint8_t* length)
+    {
+        unsigned a, b, c, d, len;
+        char end;
+        if (std::sscanf(text.c_str(), "%u.%u.%u.%u/%u%c", &a, &b, &c, &d, &len, &end) != 5 ||
+            a > 255 || b > 255 || c > 255 || d > 255 || len > 32)
+        {
+            return false;
+        }
+        *prefix = (a << 24) | (b << 16) | (c << 8) | d;
+        *length = len;
+        return true;
+    }
+
+    // IPv4 protocol handler of one device
+    void Receive(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                 const Address& from, const Address& to, NetDevice::PacketType packetType)
+    {
+        uint32_t d = device->GetIfIndex();
+        Counters& c = m_counters[m_deviceIface[d]];
+        c.received++;
+
+        // Source address is bytes 12..15 of the IPv4 header
+        const PrefixTrie* table = m_deviceTable[d];
+        uint8_t hdr[16];
+        if (table && packet->CopyData(hdr, sizeof(hdr)) == sizeof(hdr))
+        {
+            uint32_t src = (uint32_t(hdr[12]) << 24) | (uint32_t(hdr[13]) << 16) |
+                           (uint32_t(hdr[14]) << 8) | hdr[15];
+            if (!table->Contains(src))
+            {
+                c.dropped++;
+                m_dropTrace(packet, m_deviceIface[d]);
+                return;
+            }
+        }
+        c.accepted++;
+        m_tc->Receive(device, packet, protocol, from, to, packetType);
+    }
+
+    Ptr<Ipv4> m_ipv4;
+    Ptr<TrafficControlLayer> m_tc;
+    std::map<uint32_t, PrefixTrie> m_tables;
+    std::vector<Counters> m_counters; // indexed by interface
+    std::vector<const PrefixTrie*> m_deviceTable;
+    std::vector<uint32_t> m_deviceIface;
+    TracedCallback<Ptr<const Packet>, uint32_t> m_dropTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(IngressFilter);
+
+} // namespace ns3
+
+#endif /* INGRESS_FILTER_H */
@@ -0,0 +1,337 @@
+/*
+ * Ladder queue event scheduler (Tang, Goh and Thng, 2005).
+ *
+ * Events go to one of three tiers by timestamp:
+ *
+ *    top     unsorted list of far-future events
+ *    rungs   up to kMaxRungs levels of buckets; each rung splits one bucket
+ *            of the rung above into finer buckets
+ *    bottom  a short sorted run of the earliest events, popped from the back
+ *
+ * Insert is a division and a list push. RemoveNext pops the bottom and, when
+ * it runs dry, moves the next non-empty bucket into it. A bucket holding
+ * more than kThreshold events is spread over a new rung instead of being
+ * sorted. Sorting is therefore bounded by kThreshold and the cost per event
+ * is O(1) amortized. That suits evenly spaced near-future traffic such as
+ * OnOff CBR sources, where MapScheduler pays O(log n) plus a tree-node
+ * allocation per event.
+ *
+ * Event nodes come from one slab with a free list, and rung bucket arrays
+ * keep their capacity, so a run that has reached its steady-state event
+ * population stops allocating.
+ *
+ * Usage:
+ *    #include "ladder-scheduler.h"   (registers ns3::LadderScheduler)
+ *    ./ns3 run "queuedelay --SchedulerType=ns3::LadderScheduler"
+ *  or in code:
+ *    ObjectFactory f("ns3::LadderScheduler");
+ *    Simulator::SetScheduler(f);
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ns3
+{
+
+class LadderScheduler : public Scheduler
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LadderScheduler")
+                                .SetParent<Scheduler>()
+                                .SetGroupName("Core")
+                                .AddConstructor<LadderScheduler>();
+        return tid;
+    }
+
+    void Insert(const Event& ev) override
+    {
+        m_count++;
+        uint64_t ts = ev.key.m_ts;
+        if (ts >= m_topStart)
+        {
+            Push(m_top, ev);
+            m_topMin = std::min(m_topMin, ts);
+            m_topMax = std::max(m_topMax, ts);
+            return;
+        }
+        for (uint32_t r = 0; r < m_nRungs; r++)
+        {
+            Rung& rung = m_rungs[r];
+            if (ts >= rung.CurrentStart())
+            {
+                Push(rung.buckets[(ts - rung.start) / rung.width], ev);
+                rung.count++;
+                return;
+            }
+        }
+        InsertBottom(ev);
+        if (m_bottom.size() > kBottomLimit && m_nRungs < kMaxRungs)
+        {
+            SpawnFromBottom();
+        }
+    }
+
+    bool IsEmpty() const override
+    {
+        return m_count == 0;
+    }
+
+    Event PeekNext() const override
+    {
+        const_cast<LadderScheduler*>(this)->Refill();
+        return m_bottom.back();
+    }
+
+    Event RemoveNext() override
+    {
+        Refill();
+        Event ev = m_bottom.back();
+        m_bottom.pop_back();
+        m_count--;
+        return ev;
+    }
+
+    void Remove(const Event& ev) override
+    {
+        m_count--;
+        auto b = std::lower_bound(m_bottom.begin(), m_bottom.end(), ev, Later);
+        if (b != m_bottom.end() && b->key.m_uid == ev.key.m_uid && b->key.m_ts == ev.key.m_ts)
+        {
+            m_bottom.erase(b);
+            return;
+        }
+        uint64_t ts = ev.key.m_ts;
+        if (ts >= m_topStart)
+        {
+            bool found = Unlink(m_top, ev);
+            NS_ASSERT_MSG(found, "LadderScheduler: event not found in top");
+            return;
+        }
+        for (uint32_t r = 0; r < m_nRungs; r++)
+        {
+            Rung& rung = m_rungs[r];
+            if (ts >= rung.CurrentStart())
+            {
+                bool found = Unlink(rung.buckets[(ts - rung.start) / rung.width], ev);
+                NS_ASSERT_MSG(found, "LadderScheduler: event not found in rung " << r);
+                rung.count--;
+                return;
+            }
+        }
+        NS_ASSERT_MSG(false, "LadderScheduler: event not found");
+    }
+
+  private:
+    static constexpr uint32_t NIL = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t kMaxRungs = 8;
+    static constexpr uint32_t kThreshold = 50;       // largest bucket sorted into the bottom
+    static constexpr size_t kBottomLimit = 4 * kThreshold; // bottom size that spawns a rung
+
+    struct Node
+    {
+        Event ev;
+        uint32_t next;
+    };
+
+    // Unordered singly linked list of slab nodes
+    struct List
+    {
+        uint32_t head = NIL;
+        uint32_t count = 0;
+    };
+
+    struct Rung
+    {
+        uint64_t start = 0;
+        uint64_t width = 1;
+        uint32_t cur = 0; // first bucket not yet handed down
+        uint64_t count = 0;
+        std::vector<List> buckets;
+
+        uint64_t CurrentStart() const
+        {
+            return start + cur * width;
+        }
+    };
+
+    // Bottom is sorted latest first, so the next event is at the back
+    static bool Later(const Event& a, const Event& b)
+    {
+        return b.key < a.key;
+    }
+
+    void Push(List& list, const Event& ev)
+    {
+        uint32_t n;
+        if (m_free != NIL)
+        {
+            n = m_free;
+            m_free = m_slab[n].next;
+        }
+        else
+        {
+            n = m_slab.size();
+            m_slab.push_back(Node());
+        }
+        m_slab[n].ev = ev;
+        m_slab[n].next = list.head;
+        list.head = n;
+        list.count++;
+    }
+
+    bool Unlink(List& list, const Event& ev)
+    {
+        for (uint32_t* link = &list.head; *link != NIL; link = &m_slab[*link].next)
+        {
+            uint32_t n = *link;
+            if (m_slab[n].ev.key.m_uid == ev.key.m_uid)
+            {
+                *link = m_slab[n].next;
+                m_slab[n].next = m_free;
+                m_free = n;
+                list.count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void InsertBottom(const Event& ev)
+    {
+        m_bottom.insert(std::upper_bound(m_bottom.begin(), m_bottom.end(), ev, Later), ev);
+    }
+
+    // Spreads events over a new rung of buckets of the given width covering [start, end)
+    void SpawnRung(uint64_t start, uint64_t end, uint64_t width)
+    {
+        Rung& rung = m_rungs[m_nRungs++];
+        rung.start = start;
+        rung.width = std::max<uint64_t>(width, 1);
+        rung.cur = 0;
+        rung.count = 0;
+        rung.buckets.assign((end - start + rung.width - 1) / rung.width, List());
+    }
+
+    // Moves every node of list into the lowest rung and empties list
+    void Spread(List& list)
+    {
+        Rung& rung = m_rungs[m_nRungs - 1];
+        for (uint32_t n = list.head; n != NIL;)
+        {
+            uint32_t next = m_slab[n].next;
+            List& bucket = rung.buckets[(m_slab[n].ev.key.m_ts - rung.start) / rung.width];
+            m_slab[n].next = bucket.head;
+            bucket.head = n;
+            bucket.count++;
+            rung.count++;
+            n = next;
+        }
+        list = List();
+    }
+
+    // Bottom grew past its limit (a burst of near-future inserts): give it a rung
+    void SpawnFromBottom()
+    {
+        uint64_t start = m_bottom.back().key.m_ts;
+        uint64_t end = m_nRungs > 0 ? m_rungs[m_nRungs - 1].CurrentStart() : m_topStart;
+        if (m_bottom.front().key.m_ts == start)
+        {
+            return; // all at one timestamp, nothing to split
+        }
+        SpawnRung(start, end, (end - start) / m_bottom.size() + 1);
+        Rung& rung = m_rungs[m_nRungs - 1];
+        for (const Event& ev : m_bottom)
+        {
+            Push(rung.buckets[(ev.key.m_ts - rung.start) / rung.width], ev);
+            rung.count++;
+        }
+        m_bottom.clear();
+    }
+
+    // Makes sure the bottom holds the earliest events
+    void Refill()
+    {
+        NS_ASSERT_MSG(m_count > 0, "LadderScheduler: no events");
+        while (m_bottom.empty())
+        {
+            if (m_nRungs == 0)
+            {
+                // Top becomes rung 0, one bucket per event on average
+                NS_ASSERT(m_top.count > 0);
+                uint64_t end = m_topMax + 1;
+                SpawnRung(m_topMin, end, (end - m_topMin) / m_top.count + 1);
+                m_topStart = m_topMin + m_rungs[0].buckets.size() * m_rungs[0].width;
+                Spread(m_top);
+                m_topMin = std::numeric_limits<uint64_t>::max();
+                m_topMax = 0;
+                continue;
+            }
+
+            Rung& rung = m_rungs[m_nRungs - 1];
+            while (rung.cur < rung.buckets.size() && rung.buckets[rung.cur].count == 0)
+            {
+                rung.cur++;
+            }
+            if (rung.cur == rung.buckets.size())
+            {
+                m_nRungs--;
+                continue;
+            }
+
+            List& bucket = rung.buckets[rung.cur];
+            uint64_t bucketStart = rung.CurrentStart();
+            rung.cur++;
+            rung.count -= bucket.count;
+            if (bucket.count > kThreshold && rung.width > 1 && m_nRungs < kMaxRungs)
+            {
+                List events = bucket;
+                bucket = List();
+                SpawnRung(bucketStart, bucketStart + m_rungs[m_nRungs - 1].width,
+                          m_rungs[m_nRungs - 1].width / events.count);
+                Spread(events);
+                continue;
+            }
+
+            for (uint32_t n = bucket.head; n != NIL;)
+            {
+                uint32_t next = m_slab[n].next;
+                m_bottom.push_back(m_slab[n].ev);
+                m_slab[n].next = m_free;
+                m_free = n;
+                n = next;
+            }
+            bucket = List();
+            std::sort(m_bottom.begin(), m_bottom.end(), Later);
+        }
+    }
+
+    uint64_t m_count = 0;
+    std::vector<Node> m_slab;
+    uint32_t m_free = NIL;
+
+    List m_top;
+    uint64_t m_topStart = 0; // events at or after this go to top
+    uint64_t m_topMin = std::numeric_limits<uint64_t>::max();
+    uint64_t m_topMax = 0;
+
+    Rung m_rungs[kMaxRungs];
+    uint32_t m_nRungs = 0;
+
+    std::vector<Event> m_bottom;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LadderScheduler);
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -0,0 +1,654 @@
+/*
+ * On-demand global routing with incremental updates.
+ *
+ * Ipv4GlobalRoutingHelper::PopulateRoutingTables runs a full SPF from every
+ * node before the simulation starts, and RecomputeRoutingTables redoes all
+ * of it after any change. LazyGlobalRouting instead asks one shared
+ * LazyRouteOracle for the next hop. The oracle builds the link graph on
+ * the first lookup and computes one shortest-path tree per destination
+ * node the first time any node routes towards it; every node then reads
+ * its next hop from the same tree. Destinations nobody sends to cost
+ * nothing.
+ *
+ * When an interface goes down or up, only the cached trees that change are
+ * touched. A failed tree edge re-runs Dijkstra over the subtree that hung
+ * below it, seeded from its intact neighbours. A restored edge propagates
+ * only the distances it improves.
+ *
+ * Usage:
+ *    LazyGlobalRoutingHelper lazy;
+ *    InternetStackHelper stack;
+ *    stack.SetRoutingHelper(lazy.GetListRouting()); // or builder.SetRoutingHelper
+ *    stack.Install(nodes);
+ *    // no PopulateRoutingTables; link changes are picked up through
+ *    // Ipv4::SetDown / SetUp on either end of the link
+ *
+ * Routing is per destination node, which covers every prefix that node
+ * owns. Equal-cost paths are not split. Metrics are the Ipv4 interface
+ * metrics, as for global routing.
+ */
+
+#ifndef LAZY_ROUTING_H
+#define LAZY_ROUTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/* ---------- ORACLE ---------- */
+class LazyRouteOracle : public SimpleRefCount<LazyRouteOracle>
+{
+  public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    static constexpr uint64_t INF = std::numeric_limits<uint64_t>::max();
+
+    struct Edge
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromIf;
+        uint32_t toIf;
+        uint32_t metric;
+        uint32_t reverse;
+        Ipv4Address gateway; // address of `to` on this link
+        bool up;
+    };
+
+    struct Stats
+    {
+        uint64_t graphBuilds = 0;
+        uint64_t treesBuilt = 0;
+        uint64_t incrementalUpdates = 0;
+        uint64_t nodesRelaxed = 0;
+    };
+
+    // Edge index out of node towards dst, or NONE (unreachable / unknown / dst itself)
+    uint32_t Lookup(uint32_t node, Ipv4Address dst)
+    {
+        if (!m_built)
+        {
+            Build();
+        }
+        auto owner = m_owner.find(dst.Get());
+        if (owner == m_owner.end() || owner->second == node)
+        {
+            return NONE;
+        }
+        return GetTree(owner->second).via[node];
+    }
+
+    const Edge& GetEdge(uint32_t e) const
+    {
+        return m_edges[e];
+    }
+
+    // Distance from node to the owner of dst, INF if unreachable
+    uint64_t GetDistance(uint32_t node, Ipv4Address dst)
+    {
+        if (!m_built)
+        {
+            Build();
+        }
+        auto owner = m_owner.find(dst.Get());
+        if (owner == m_owner.end())
+        {
+            return INF;
+        }
+        return GetTree(owner->second).dist[node];
+    }
+
+    // Called by LazyGlobalRouting on Ipv4 interface state changes
+    void SetInterfaceState(uint32_t node, uint32_t iface, bool up)
+    {
+        if (!m_built)
+        {
+            return; // the graph is read from the current state when first needed
+        }
+        m_ifUp[Key(node, iface)] = up;
+        auto it = m_ifEdges.find(Key(node, iface));
+        if (it == m_ifEdges.end())
+        {
+            return;
+        }
+        for (uint32_t e : it->second)
+        {
+            Edge& edge = m_edges[e];
+            bool now = up && m_ifUp[Key(edge.to, edge.toIf)];
+            if (now == edge.up)
+            {
+                continue;
+            }
+            edge.up = now;
+            m_edges[edge.reverse].up = now;
+            m_stats.incrementalUpdates++;
+            for (auto& t : m_trees)
+            {
+                if (now)
+                {
+                    EdgeUp(t.second, e);
+                    EdgeUp(t.second, edge.reverse);
+                }
+                else
+                {
+                    EdgeDown(t.second, e);
+                    EdgeDown(t.second, edge.reverse);
+                }
+            }
+        }
+    }
+
+    // Addresses or devices changed: forget everything and rebuild on demand
+    void Invalidate()
+    {
+        m_built = false;
+        m_edges.clear();
+        m_out.clear();
+        m_owner.clear();
+        m_ifEdges.clear();
+        m_ifUp.clear();
+        m_trees.clear();
+    }
+
+    bool IsBuilt() const
+    {
+        return m_built;
+    }
+
+    size_t GetNTrees() const
+    {
+        return m_trees.size();
+    }
+
+    const Stats& GetStats() const
+    {
+        return m_stats;
+    }
+
+    // Destination nodes with a cached tree
+    std::vector<uint32_t> GetDestinations() const
+    {
+        std::vector<uint32_t> d;
+        d.reserve(m_trees.size());
+        for (const auto& t : m_trees)
+        {
+            d.push_back(t.first);
+        }
+        return d;
+    }
+
+    Ipv4Address GetNodeAddress(uint32_t node) const
+    {
+        return node < m_address.size() ? m_address[node] : Ipv4Address();
+    }
+
+  private:
+    struct Tree
+    {
+        std::vector<uint64_t> dist;
+        std::vector<uint32_t> via; // edge out of each node towards the destination
+    };
+
+    typedef std::pair<uint64_t, uint32_t> HeapEntry;
+    typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> Heap;
+
+    static uint64_t Key(uint32_t node, uint32_t iface)
+    {
+        return (uint64_t(node) << 32) | iface;
+    }
+
+    // One pass over every node's interfaces; each channel peer becomes an edge
+    void Build()
+    {
+        uint32_t n = NodeList::GetNNodes();
+        m_out.assign(n, std::vector<uint32_t>());
+        m_address.assign(n, Ipv4Address());
+        for (uint32_t i = 0; i < n; i++)
+        {
+            Ptr<Ipv4> ipv4 = NodeList::GetNode(i)->GetObject<Ipv4>();
+            if (!ipv4)
+            {
+                continue;
+            }
+            for (uint32_t iface = 1; iface < ipv4->GetNInterfaces(); iface++)
+            {
+                m_ifUp[Key(i, iface)] = ipv4->IsUp(iface);
+                for (uint32_t a = 0; a < ipv4->GetNAddresses(iface); a++)
+                {
+                    m_owner[ipv4->GetAddress(iface, a).GetLocal().Get()] = i;
+                }
+                if (m_address[i] == Ipv4Address() && ipv4->GetNAddresses(iface) > 0)
+                {
+                    m_address[i] = ipv4->GetAddress(iface, 0).GetLocal();
+                }
+            }
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            Ptr<Ipv4> ipv4 = NodeList::GetNode(i)->GetObject<Ipv4>();
+            if (!ipv4)
+            {
+                continue;
+            }
+            for (uint32_t iface = 1; iface < ipv4->GetNInterfaces(); iface++)
+            {
+                Ptr<NetDevice> dev = ipv4->GetNetDevice(iface);
+                Ptr<Channel> channel = dev->GetChannel();
+                if (!channel)
+                {
+                    continue;
+                }
+                for (std::size_t d = 0; d < channel->GetNDevices(); d++)
+                {
+                    Ptr<NetDevice> peer = channel->GetDevice(d);
+                    uint32_t j = peer->GetNode()->GetId();
+                    // Each pair once, from the lower node id (or lower device on the same node)
+                    if (j < i || (j == i && peer->GetIfIndex() <= dev->GetIfIndex()))
+                    {
+                        continue;
+                    }
+                    Ptr<Ipv4> peerIpv4 = peer->GetNode()->GetObject<Ipv4>();
+                    int32_t peerIf = peerIpv4 ? peerIpv4->GetInterfaceForDevice(peer) : -1;
+                    if (peerIf < 0 || ipv4->GetNAddresses(iface) == 0 ||
+                        peerIpv4->GetNAddresses(peerIf) == 0)
+                    {
+                        continue;
+                    }
+                    AddLink(i, iface, ipv4, j, peerIf, peerIpv4);
+                }
+            }
+        }
+        m_built = true;
+        m_stats.graphBuilds++;
+    }
+
+    void AddLink(uint32_t a, uint32_t aIf, Ptr<Ipv4> aIpv4, uint32_t b, uint32_t bIf, Ptr<Ipv4> bIpv4)
+    {
+        bool up = m_ifUp[Key(a, aIf)] && m_ifUp[Key(b, bIf)];
+        uint32_t ab = m_edges.size();
+        uint32_t ba = ab + 1;
+        m_edges.push_back(Edge{a, b, aIf, bIf, uint32_t(aIpv4->GetMetric(aIf)), ba,
+                               bIpv4->GetAddress(bIf, 0).GetLocal(), up});
+        m_edges.push_back(Edge{b, a, bIf, aIf, uint32_t(bIpv4->GetMetric(bIf)), ab,
+                               aIpv4->GetAddress(aIf, 0).GetLocal(), up});
+        m_out[a].push_back(ab);
+        m_out[b].push_back(ba);
+        m_ifEdges[Key(a, aIf)].push_back(ab);
+        m_ifEdges[Key(b, bIf)].push_back(ba);
+    }
+
+    Tree& GetTree(uint32_t dst)
+    {
+        auto it = m_trees.find(dst);
+        if (it != m_trees.end())
+        {
+            return it->second;
+        }
+        Tree& t = m_trees[dst];
+        t.dist.assign(m_out.size(), INF);
+        t.via.assign(m_out.size(), NONE);
+        t.dist[dst] = 0;
+        Heap heap;
+        heap.push(HeapEntry(0, dst));
+        Relax(t, heap, nullptr);
+        m_stats.treesBuilt++;
+        return t;
+    }
+
+    // Dijkstra towards the destination: a settled node x improves every
+    // neighbour y whose edge y -> x is up. With `within`, only nodes marked
+    // in it are updated.
+    void Relax(Tree& t, Heap& heap, const std::vector<char>* within)
+    {
+        while (!heap.empty())
+        {
+            HeapEntry top = heap.top();
+            heap.pop();
+            uint32_t x = top.second;
+            if (top.first != t.dist[x])
+            {
+                continue;
+            }
+            m_stats.nodesRelaxed++;
+            for (uint32_t e : m_out[x])
+            {
+                const Edge& in = m_edges[m_edges[e].reverse]; // y -> x
+                uint32_t y = in.from;
+                if (!in.up || (within && !(*within)[y]))
+                {
+                    continue;
+                }
+                uint64_t d = t.dist[x] + in.metric;
+                if (d < t.dist[y])
+                {
+                    t.dist[y] = d;
+                    t.via[y] = m_edges[e].reverse;
+                    heap.push(HeapEntry(d, y));
+                }
+            }
+        }
+    }
+
+    // Edge e (u -> w) went down. If u routed over it, every node whose path
+    // runs through u loses its route; recompute only those.
+    void EdgeDown(Tree& t, uint32_t e)
+    {
+        uint32_t u = m_edges[e].from;
+        if (t.via[u] != e)
+        {
+            return;
+        }
+
+        // 0 = unknown, 1 = below u, 2 = not below u
+        uint32_t n = m_out.size();
+        std::vector<char> state(n, 0);
+        std::vector<uint32_t> path;
+        std::vector<uint32_t> subtree;
+        state[u] = 1;
+        subtree.push_back(u);
+        for (uint32_t v = 0; v < n; v++)
+        {
+            uint32_t x = v;
+            while (state[x] == 0 && t.via[x] != NONE)
+            {
+                path.push_back(x);
+                x = m_edges[t.via[x]].to;
+            }
+            char s = state[x] == 1 ? 1 : 2;
+            for (uint32_t p : path)
+            {
+                state[p] = s;
+                if (s == 1)
+                {
+                    subtree.push_back(p);
+                }
+            }
+            path.clear();
+            if (state[x] == 0)
+            {
+                state[x] = 2;
+            }
+        }
+
+        std::vector<char> within(n, 0);
+        for (uint32_t x : subtree)
+        {
+            within[x] = 1;
+            t.dist[x] = INF;
+            t.via[x] = NONE;
+        }
+        Heap heap;
+        for (uint32_t x : subtree)
+        {
+            for (uint32_t out : m_out[x])
+            {
+                const Edge& edge = m_edges[out];
+                if (edge.up && !within[edge.to] && t.dist[edge.to] != INF &&
+                    t.dist[edge.to] + edge.metric < t.dist[x])
+                {
+                    t.dist[x] = t.dist[edge.to] + edge.metric;
+                    t.via[x] = out;
+                }
+            }
+            if (t.dist[x] != INF)
+            {
+                heap.push(HeapEntry(t.dist[x], x));
+            }
+        }
+        Relax(t, heap, &within);
+    }
+
+    // Edge e (u -> w) came up: u and everything behind it may get shorter
+    void EdgeUp(Tree& t, uint32_t e)
+    {
+        const Edge& edge = m_edges[e];
+        if (t.dist[edge.to] == INF || t.dist[edge.to] + edge.metric >= t.dist[edge.from])
+        {
+            return;
+        }
+        t.dist[edge.from] = t.dist[edge.to] + edge.metric;
+        t.via[edge.from] = e;
+        Heap heap;
+        heap.push(HeapEntry(t.dist[edge.from], edge.from));
+        Relax(t, heap, nullptr);
+    }
+
+    bool m_built = false;
+    std::vector<Edge> m_edges; // both directions of a link are adjacent
+    std::vector<std::vector<uint32_t>> m_out; // edges out of each node
+    std::vector<Ipv4Address> m_address; // first address of each node
+    std::unordered_map<uint32_t, uint32_t> m_owner; // address -> node
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_ifEdges; // (node, iface) -> edges
+    std::unordered_map<uint64_t, bool> m_ifUp;
+    std::unordered_map<uint32_t, Tree> m_trees; // by destination node
+    Stats m_stats;
+};
+
+/* ---------- ROUTING PROTOCOL ---------- */
+class LazyGlobalRouting : public Ipv4RoutingProtocol
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LazyGlobalRouting")
+                                .SetParent<Ipv4RoutingProtocol>()
+                                .SetGroupName("Internet")
+                                .AddConstructor<LazyGlobalRouting>();
+        return tid;
+    }
+
+    void SetOracle(Ptr<LazyRouteOracle> oracle)
+    {
+        m_oracle = oracle;
+    }
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override
+    {
+        Ptr<Ipv4Route> route = Lookup(header.GetDestination(), oif);
+        sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+        return route;
+    }
+
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override
+    {
+        uint32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+        if (m_ipv4->IsDestinationAddress(header.GetDestination(), iif))
+        {
+            if (!lcb.IsNull())
+            {
+                lcb(p, header, iif);
+                return true;
+            }
+            return false;
+        }
+        if (header.GetDestination().IsMulticast() || header.GetDestination().IsBroadcast())
+        {
+            return false;
+        }
+        if (!m_ipv4->IsForwarding(iif))
+        {
+            ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+            return true;
+        }
+        Ptr<Ipv4Route> route = Lookup(header.GetDestination(), nullptr);
+        if (!route)
+        {
+            return false;
+        }
+        ucb(route, p, header);
+        return true;
+    }
+
+    void NotifyInterfaceUp(uint32_t interface) override
+    {
+        if (m_oracle)
+        {
+            m_oracle->SetInterfaceState(m_node, interface, true);
+        }
+    }
+
+    void NotifyInterfaceDown(uint32_t interface) override
+    {
+        if (m_oracle)
+        {
+            m_oracle->SetInterfaceState(m_node, interface, false);
+        }
+    }
+
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override
+    {
+        if (m_oracle && m_oracle->IsBuilt())
+        {
+            m_oracle->Invalidate();
+        }
+    }
+
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override
+    {
+        if (m_oracle && m_oracle->IsBuilt())
+        {
+            m_oracle->Invalidate();
+        }
+    }
+
+    void SetIpv4(Ptr<Ipv4> ipv4) override
+    {
+        m_ipv4 = ipv4;
+        m_node = ipv4->GetObject<Node>()->GetId();
+    }
+
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override
+    {
+        std::ostream* os = stream->GetStream();
+        *os << "Node: " << m_node << ", Time: " << Now().As(unit)
+            << ", LazyGlobalRouting table (cached destinations only)\n"
+            << "Destination     Gateway         Iface  Distance\n";
+        if (!m_oracle || !m_oracle->IsBuilt())
+        {
+            return;
+        }
+        for (uint32_t dst : m_oracle->GetDestinations())
+        {
+            Ipv4Address addr = m_oracle->GetNodeAddress(dst);
+            uint32_t e = m_oracle->Lookup(m_node, addr);
+            if (e == LazyRouteOracle::NONE)
+            {
+                continue;
+            }
+            const LazyRouteOracle::Edge& edge = m_oracle->GetEdge(e);
+            std::ostringstream d;
+            std::ostringstream g;
+            d << addr;
+            g << edge.gateway;
+            *os << std::left << std::setw(16) << d.str() << std::setw(16) << g.str()
+                << std::setw(7) << edge.fromIf << m_oracle->GetDistance(m_node, addr) << "\n";
+        }
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_ipv4 = nullptr;
+        m_oracle = nullptr;
+        Ipv4RoutingProtocol::DoDispose();
+    }
+
+  private:
+    Ptr<Ipv4Route> Lookup(Ipv4Address dst, Ptr<NetDevice> oif)
+    {
+        if (!m_oracle || dst.IsMulticast() || dst.IsBroadcast())
+        {
+            return nullptr;
+        }
+        uint32_t e = m_oracle->Lookup(m_node, dst);
+        if (e == LazyRouteOracle::NONE)
+        {
+            return nullptr;
+        }
+        const LazyRouteOracle::Edge& edge = m_oracle->GetEdge(e);
+        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(edge.fromIf);
+        if (oif && oif != dev)
+        {
+            return nullptr;
+        }
+        Ptr<Ipv4Route> route = ns3::Create<Ipv4Route>();
+        route->SetDestination(dst);
+        route->SetGateway(edge.gateway);
+        route->SetSource(m_ipv4->GetAddress(edge.fromIf, 0).GetLocal());
+        route->SetOutputDevice(dev);
+        return route;
+    }
+
+    Ptr<Ipv4> m_ipv4;
+    Ptr<LazyRouteOracle> m_oracle;
+    uint32_t m_node = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LazyGlobalRouting);
+
+/* ---------- HELPER ---------- */
+class LazyGlobalRoutingHelper : public Ipv4RoutingHelper
+{
+  public:
+    // Copies share the oracle, so every node installed from this helper
+    // (directly or through an Ipv4ListRoutingHelper) reads the same trees
+    LazyGlobalRoutingHelper()
+        : m_oracle(ns3::Create<LazyRouteOracle>())
+    {
+    }
+
+    LazyGlobalRoutingHelper* Copy() const override
+    {
+        return new LazyGlobalRoutingHelper(*this);
+    }
+
+    Ptr<Ipv4RoutingProtocol> Create(Ptr<Node> node) const override
+    {
+        Ptr<LazyGlobalRouting> routing = CreateObject<LazyGlobalRouting>();
+        routing->SetOracle(m_oracle);
+        return routing;
+    }
+
+    // Static routing at priority 0 and lazy routing at -10, the same
+    // stacking InternetStackHelper uses for global routing
+    Ipv4ListRoutingHelper GetListRouting() const
+    {
+        Ipv4StaticRoutingHelper staticRouting;
+        Ipv4ListRoutingHelper list;
+        list.Add(staticRouting, 0);
+        list.Add(*this, -10);
+        return list;
+    }
+
+    Ptr<LazyRouteOracle> GetOracle() const
+    {
+        return m_oracle;
+    }
+
+  private:
+    Ptr<LazyRouteOracle> m_oracle;
+};
+
+} // namespace ns3
+
+#endif /* LAZY_ROUTING_H */
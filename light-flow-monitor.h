@@ -0,0 +1,648 @@
+/*
+ * Lightweight per-flow statistics for runs with many flows.
+ *
+ * FlowMonitor keeps a FlowStats object per flow (delay, jitter and size
+ * histograms, per-probe maps) and classifies and timestamps every packet at
+ * every node it passes. LightFlowMonitor instead:
+ *
+ *  - probes only the edges: SendOutgoing where a packet enters the network
+ *    and LocalDeliver where it leaves, never the forwarding hops;
+ *  - keeps flows in a flat open-addressing hash table over the IPv4
+ *    5-tuple, with every counter in its own column (struct of arrays);
+ *  - counts every packet, but times only 1 in N packets of each flow. The
+ *    timed packets are tracked by uid until they arrive or are declared
+ *    lost after MaxDelay, so no tag is added to any packet.
+ *
+ * Delay and loss are measured on the sampled packets and scaled to the
+ * flow's packet counts; with N = 1 they are exact. FlowIds are assigned in
+ * order of first packet from 1, like Ipv4FlowClassifier's.
+ *
+ * With SetTimestampTags(true) the timed packets carry their send time in a
+ * LightFlowTag instead, so sender and receiver may live in different
+ * processes (parallel-simulator.h); loss is then sent minus received, in
+ * flight included. Merge() adds another monitor's GetRecords() by 5-tuple.
+ *
+ * GetFlowStats() and FindFlow() return the FlowMonitor types, so the usual
+ * result loop reads the same fields (txPackets, rxPackets, rxBytes,
+ * lostPackets, delaySum, timeFirstTxPacket, timeLastRxPacket, ...); the
+ * histograms, jitter and per-probe fields stay empty.
+ *
+ * Usage:
+ *    LightFlowMonitor monitor;
+ *    monitor.SetSampling(10);                        // time 1 in 10 packets
+ *    monitor.Install(NodeContainer::GetGlobal());
+ *    Simulator::Run();
+ *    monitor.CheckForLostPackets();
+ *    for (auto &flow : monitor.GetFlowStats())
+ *        auto t = monitor.FindFlow(flow.first); ...
+ *    monitor.SerializeToBinaryFile("scratch/flows.lfm");
+ *    monitor.Merge(ParallelSimulator::Gather(monitor.GetRecords()));
+ */
+
+#ifndef LIGHT_FLOW_MONITOR_H
+#define LIGHT_FLOW_MONITOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+static const char LIGHT_FLOW_MAGIC[8] = {'L', 'T', 'F', 'L', 'O', 'W', '0', '1'};
+
+/* ---------- FILE LAYOUT ----------
+ * LightFlowFileHeader, then nFlows LightFlowRecords in FlowId order
+ */
+struct LightFlowFileHeader
+{
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t nFlows;
+    uint32_t sampling;
+    uint32_t pad;
+    int64_t timeNs; // simulation time of the snapshot
+};
+
+struct LightFlowRecord
+{
+    uint32_t flowId;
+    uint32_t src;
+    uint32_t dst;
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint8_t protocol;
+    uint8_t pad[7];
+    uint64_t txPackets;
+    uint64_t txBytes;
+    uint64_t rxPackets;
+    uint64_t rxBytes;
+    uint64_t lostPackets;
+    int64_t delaySumNs;
+    int64_t firstTxNs;
+    int64_t lastTxNs;
+    int64_t firstRxNs;
+    int64_t lastRxNs;
+};
+
+static_assert(sizeof(LightFlowRecord) == 104, "LightFlowRecord must stay 104 bytes");
+
+/* ---------- TIMESTAMP TAG ---------- */
+class LightFlowTag : public Tag
+{
+  public:
+    LightFlowTag() = default;
+
+    explicit LightFlowTag(int64_t txNs)
+        : m_txNs(txNs)
+    {
+    }
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LightFlowTag")
+                                .SetParent<Tag>()
+                                .SetGroupName("FlowMonitor")
+                                .AddConstructor<LightFlowTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return 8;
+    }
+
+    void Serialize(TagBuffer buf) const override
+    {
+        buf.WriteU64(m_txNs);
+    }
+
+    void Deserialize(TagBuffer buf) override
+    {
+        m_txNs = buf.ReadU64();
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "tx=" << m_txNs;
+    }
+
+    int64_t m_txNs = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LightFlowTag);
+
+class LightFlowMonitor
+{
+  public:
+    // Called for every timed packet on delivery
+    typedef std::function<void(FlowId, Time)> DelayCallback;
+
+    // Time 1 in n packets of each flow, starting with the first
+    void SetSampling(uint32_t n)
+    {
+        m_sampling = n > 0 ? n : 1;
+    }
+
+    // A timed packet not delivered after this long counts as lost
+    void SetMaxDelay(Time maxDelay)
+    {
+        m_maxDelay = maxDelay;
+    }
+
+    // Sizes the flow table up front
+    void SetExpectedFlows(uint32_t n)
+    {
+        Reserve(n);
+    }
+
+    void SetDelayCallback(const DelayCallback& callback)
+    {
+        m_delayCallback = callback;
+    }
+
+    // Carry the send time of timed packets in a tag rather than tracking
+    // them by uid; needed when senders and receivers run in different
+    // processes. Set before Install().
+    void SetTimestampTags(bool tags)
+    {
+        m_tags = tags;
+    }
+
+    void Install(NodeContainer nodes)
+    {
+        for (uint32_t i = 0; i < nodes.GetN(); i++)
+        {
+            Ptr<Ipv4L3Protocol> ipv4 = nodes.Get(i)->GetObject<Ipv4L3Protocol>();
+            if (!ipv4)
+            {
+                continue;
+            }
+            ipv4->TraceConnectWithoutContext(
+                "SendOutgoing", MakeCallback(&LightFlowMonitor::SendOutgoing, this));
+            ipv4->TraceConnectWithoutContext(
+                "LocalDeliver", MakeCallback(&LightFlowMonitor::LocalDeliver, this));
+        }
+        if (!m_check.IsRunning())
+        {
+            m_check = Simulator::Schedule(Seconds(1), &LightFlowMonitor::PeriodicCheck, this);
+        }
+    }
+
+    // Declares timed packets older than maxDelay lost
+    void CheckForLostPackets(Time maxDelay)
+    {
+        int64_t cutoff = (Simulator::Now() - maxDelay).GetNanoSeconds();
+        for (auto it = m_inFlight.begin(); it != m_inFlight.end();)
+        {
+            if (it->second.txNs < cutoff)
+            {
+                m_sampledLost[it->second.flow]++;
+                it = m_inFlight.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void CheckForLostPackets()
+    {
+        CheckForLostPackets(m_maxDelay);
+    }
+
+    uint32_t GetNFlows() const
+    {
+        return m_src.size();
+    }
+
+    // Snapshot in FlowMonitor form; rebuilt on every call
+    const FlowMonitor::FlowStatsContainer& GetFlowStats()
+    {
+        m_stats.clear();
+        for (uint32_t i = 0; i < GetNFlows(); i++)
+        {
+            FlowMonitor::FlowStats& st = m_stats[i + 1];
+            st.txPackets = m_txPackets[i];
+            st.txBytes = m_txBytes[i];
+            st.rxPackets = m_rxPackets[i];
+            st.rxBytes = m_rxBytes[i];
+            st.lostPackets = GetLostPackets(i);
+            st.delaySum = NanoSeconds(GetDelaySumNs(i));
+            st.timeFirstTxPacket = NanoSeconds(m_firstTxNs[i]);
+            st.timeLastTxPacket = NanoSeconds(m_lastTxNs[i]);
+            st.timeFirstRxPacket = NanoSeconds(m_firstRxNs[i]);
+            st.timeLastRxPacket = NanoSeconds(m_lastRxNs[i]);
+        }
+        return m_stats;
+    }
+
+    Ipv4FlowClassifier::FiveTuple FindFlow(FlowId flowId) const
+    {
+        NS_ABORT_MSG_IF(flowId == 0 || flowId > GetNFlows(), "Unknown flow " << flowId);
+        uint32_t i = flowId - 1;
+        Ipv4FlowClassifier::FiveTuple t;
+        t.sourceAddress = Ipv4Address(m_src[i]);
+        t.destinationAddress = Ipv4Address(m_dst[i]);
+        t.protocol = m_protocol[i];
+        t.sourcePort = m_srcPort[i];
+        t.destinationPort = m_dstPort[i];
+        return t;
+    }
+
+    // Every flow as a file record, in FlowId order
+    std::vector<LightFlowRecord> GetRecords() const
+    {
+        std::vector<LightFlowRecord> records(GetNFlows());
+        for (uint32_t i = 0; i < GetNFlows(); i++)
+        {
+            LightFlowRecord& r = records[i];
+            std::memset(&r, 0, sizeof(r));
+            r.flowId = i + 1;
+            r.src = m_src[i];
+            r.dst = m_dst[i];
+            r.srcPort = m_srcPort[i];
+            r.dstPort = m_dstPort[i];
+            r.protocol = m_protocol[i];
+            r.txPackets = m_txPackets[i];
+            r.txBytes = m_txBytes[i];
+            r.rxPackets = m_rxPackets[i];
+            r.rxBytes = m_rxBytes[i];
+            r.lostPackets = GetLostPackets(i);
+            r.delaySumNs = GetDelaySumNs(i);
+            r.firstTxNs = m_firstTxNs[i];
+            r.lastTxNs = m_lastTxNs[i];
+            r.firstRxNs = m_firstRxNs[i];
+            r.lastRxNs = m_lastRxNs[i];
+        }
+        return records;
+    }
+
+    // Adds records of another monitor (e.g. another partition) flow by
+    // flow; unknown 5-tuples become new flows. Merged delay and loss are
+    // exact with sampling 1.
+    void Merge(const std::vector<LightFlowRecord>& records)
+    {
+        for (const LightFlowRecord& r : records)
+        {
+            uint32_t i = Lookup(r.src, r.dst, r.srcPort, r.dstPort, r.protocol, true);
+            if (r.txPackets > 0)
+            {
+                m_firstTxNs[i] =
+                    m_txPackets[i] > 0 ? std::min(m_firstTxNs[i], r.firstTxNs) : r.firstTxNs;
+                m_lastTxNs[i] = std::max(m_lastTxNs[i], r.lastTxNs);
+            }
+            if (r.rxPackets > 0)
+            {
+                m_firstRxNs[i] =
+                    m_rxPackets[i] > 0 ? std::min(m_firstRxNs[i], r.firstRxNs) : r.firstRxNs;
+                m_lastRxNs[i] = std::max(m_lastRxNs[i], r.lastRxNs);
+            }
+            m_txPackets[i] += r.txPackets;
+            m_txBytes[i] += r.txBytes;
+            m_rxPackets[i] += r.rxPackets;
+            m_rxBytes[i] += r.rxBytes;
+            // Records hold scaled values; taken as if every packet was timed
+            m_sampledTx[i] += r.txPackets;
+            m_sampledLost[i] += r.lostPackets;
+            m_sampledRx[i] += r.rxPackets;
+            m_sampledDelayNs[i] += r.delaySumNs;
+        }
+    }
+
+    // Fixed-size records, read back with ReadBinaryFile()
+    bool SerializeToBinaryFile(const std::string& path) const
+    {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            return false;
+        }
+        LightFlowFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, LIGHT_FLOW_MAGIC, sizeof(header.magic));
+        header.recordSize = sizeof(LightFlowRecord);
+        header.nFlows = GetNFlows();
+        header.sampling = m_sampling;
+        header.timeNs = Simulator::Now().GetNanoSeconds();
+        std::vector<LightFlowRecord> records = GetRecords();
+        bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+                  std::fwrite(records.data(), sizeof(LightFlowRecord), records.size(), f) ==
+                      records.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+    static bool ReadBinaryFile(const std::string& path, LightFlowFileHeader* header,
+                               std::vector<LightFlowRecord>* records)
+    {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f)
+        {
+            return false;
+        }
+        bool ok = std::fread(header, sizeof(*header), 1, f) == 1 &&
+                  std::memcmp(header->magic, LIGHT_FLOW_MAGIC, sizeof(header->magic)) == 0 &&
+                  header->recordSize == sizeof(LightFlowRecord);
+        if (ok)
+        {
+            records->resize(header->nFlows);
+            ok = std::fread(records->data(), sizeof(LightFlowRecord), header->nFlows, f) ==
+                 header->nFlows;
+        }
+        std::fclose(f);
+        return ok;
+    }
+
+  private:
+    struct InFlight
+    {
+        uint32_t flow;
+        int64_t txNs;
+    };
+
+    static const uint32_t kEmpty = 0xffffffff;
+
+    // 5-tuple of an unfragmented packet; false for anything else
+    static bool Key(const Ipv4Header& header, Ptr<const Packet> payload, uint16_t* srcPort,
+                    uint16_t* dstPort)
+    {
+        if (header.GetFragmentOffset() > 0 || !header.IsLastFragment())
+        {
+            return false;
+        }
+        *srcPort = 0;
+        *dstPort = 0;
+        uint8_t protocol = header.GetProtocol();
+        if ((protocol == 6 || protocol == 17) && payload->GetSize() >= 4)
+        {
+            // TCP and UDP both start with source and destination port
+            uint8_t data[4];
+            payload->CopyData(data, 4);
+            *srcPort = (uint16_t(data[0]) << 8) | data[1];
+            *dstPort = (uint16_t(data[2]) << 8) | data[3];
+        }
+        return true;
+    }
+
+    static uint64_t Hash(uint32_t src, uint32_t dst, uint16_t srcPort, uint16_t dstPort,
+                         uint8_t protocol)
+    {
+        uint64_t h = ((uint64_t(src) << 32) | dst) * 0x9e3779b97f4a7c15ull;
+        h ^= ((uint64_t(srcPort) << 24) | (uint64_t(dstPort) << 8) | protocol) *
+             0xc2b2ae3d27d4eb4full;
+        return h ^ (h >> 29);
+    }
+
+    // Flow index of the packet's 5-tuple, added if create is set; kEmpty otherwise
+    uint32_t Lookup(const Ipv4Header& header, Ptr<const Packet> payload, bool create)
+    {
+        uint16_t srcPort;
+        uint16_t dstPort;
+        if (!Key(header, payload, &srcPort, &dstPort))
+        {
+            return kEmpty;
+        }
+        return Lookup(header.GetSource().Get(), header.GetDestination().Get(), srcPort, dstPort,
+                      header.GetProtocol(), create);
+    }
+
+    uint32_t Lookup(uint32_t src, uint32_t dst, uint16_t srcPort, uint16_t dstPort,
+                    uint8_t protocol, bool create)
+    {
+        if (m_slots.empty())
+        {
+            Reserve(64);
+        }
+        size_t mask = m_slots.size() - 1;
+        for (size_t s = Hash(src, dst, srcPort, dstPort, protocol) & mask;; s = (s + 1) & mask)
+        {
+            uint32_t i = m_slots[s];
+            if (i == kEmpty)
+            {
+                if (!create)
+                {
+                    return kEmpty;
+                }
+                i = Append(src, dst, srcPort, dstPort, protocol);
+                m_slots[s] = i;
+                if (2 * GetNFlows() > m_slots.size())
+                {
+                    Reserve(GetNFlows());
+                }
+                return i;
+            }
+            if (m_src[i] == src && m_dst[i] == dst && m_srcPort[i] == srcPort &&
+                m_dstPort[i] == dstPort && m_protocol[i] == protocol)
+            {
+                return i;
+            }
+        }
+    }
+
+    uint32_t Append(uint32_t src, uint32_t dst, uint16_t srcPort, uint16_t dstPort,
+                    uint8_t protocol)
+    {
+        m_src.push_back(src);
+        m_dst.push_back(dst);
+        m_srcPort.push_back(srcPort);
+        m_dstPort.push_back(dstPort);
+        m_protocol.push_back(protocol);
+        m_txPackets.push_back(0);
+        m_txBytes.push_back(0);
+        m_rxPackets.push_back(0);
+        m_rxBytes.push_back(0);
+        m_firstTxNs.push_back(0);
+        m_lastTxNs.push_back(0);
+        m_firstRxNs.push_back(0);
+        m_lastRxNs.push_back(0);
+        m_countdown.push_back(1);
+        m_sampledTx.push_back(0);
+        m_sampledRx.push_back(0);
+        m_sampledLost.push_back(0);
+        m_sampledDelayNs.push_back(0);
+        return GetNFlows() - 1;
+    }
+
+    // Rehashes into a table with room for n flows at half load
+    void Reserve(uint32_t n)
+    {
+        size_t size = 64;
+        while (size < 2 * size_t(n) + 2)
+        {
+            size *= 2;
+        }
+        if (size <= m_slots.size())
+        {
+            return;
+        }
+        m_slots.assign(size, kEmpty);
+        for (uint32_t i = 0; i < GetNFlows(); i++)
+        {
+            size_t s = Hash(m_src[i], m_dst[i], m_srcPort[i], m_dstPort[i], m_protocol[i]) &
+                       (size - 1);
+            while (m_slots[s] != kEmpty)
+            {
+                s = (s + 1) & (size - 1);
+            }
+            m_slots[s] = i;
+        }
+    }
+
+    void SendOutgoing(const Ipv4Header& header, Ptr<const Packet> payload, uint32_t interface)
+    {
+        uint32_t i = Lookup(header, payload, true);
+        if (i == kEmpty)
+        {
+            return;
+        }
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        if (m_txPackets[i] == 0)
+        {
+            m_firstTxNs[i] = now;
+        }
+        m_lastTxNs[i] = now;
+        m_txPackets[i]++;
+        m_txBytes[i] += payload->GetSize() + header.GetSerializedSize();
+        if (--m_countdown[i] == 0)
+        {
+            m_countdown[i] = m_sampling;
+            m_sampledTx[i]++;
+            if (m_tags)
+            {
+                payload->AddPacketTag(LightFlowTag(now));
+            }
+            else
+            {
+                m_inFlight[payload->GetUid()] = InFlight{i, now};
+            }
+        }
+    }
+
+    void LocalDeliver(const Ipv4Header& header, Ptr<const Packet> payload, uint32_t interface)
+    {
+        // With tags the sender may be in another process, unknown here
+        uint32_t i = Lookup(header, payload, m_tags);
+        if (i == kEmpty)
+        {
+            return;
+        }
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        if (m_rxPackets[i] == 0)
+        {
+            m_firstRxNs[i] = now;
+        }
+        m_lastRxNs[i] = now;
+        m_rxPackets[i]++;
+        m_rxBytes[i] += payload->GetSize() + header.GetSerializedSize();
+        int64_t delay;
+        LightFlowTag tag;
+        if (m_tags)
+        {
+            if (!payload->PeekPacketTag(tag))
+            {
+                return;
+            }
+            delay = now - tag.m_txNs;
+        }
+        else
+        {
+            auto it = m_inFlight.find(payload->GetUid());
+            if (it == m_inFlight.end())
+            {
+                return;
+            }
+            delay = now - it->second.txNs;
+            m_inFlight.erase(it);
+        }
+        m_sampledRx[i]++;
+        m_sampledDelayNs[i] += delay;
+        if (m_delayCallback)
+        {
+            m_delayCallback(i + 1, NanoSeconds(delay));
+        }
+    }
+
+    void PeriodicCheck()
+    {
+        CheckForLostPackets();
+        m_check = Simulator::Schedule(Seconds(1), &LightFlowMonitor::PeriodicCheck, this);
+    }
+
+    // Sampled losses scaled to all packets sent
+    uint64_t GetLostPackets(uint32_t i) const
+    {
+        if (m_tags)
+        {
+            return m_txPackets[i] > m_rxPackets[i] ? m_txPackets[i] - m_rxPackets[i] : 0;
+        }
+        if (m_sampledTx[i] == 0)
+        {
+            return 0;
+        }
+        return uint64_t(std::llround(double(m_sampledLost[i]) * m_txPackets[i] / m_sampledTx[i]));
+    }
+
+    // Sampled delay scaled to all packets received
+    int64_t GetDelaySumNs(uint32_t i) const
+    {
+        if (m_sampledRx[i] == 0)
+        {
+            return 0;
+        }
+        return int64_t(double(m_sampledDelayNs[i]) * m_rxPackets[i] / m_sampledRx[i]);
+    }
+
+    uint32_t m_sampling = 1;
+    bool m_tags = false;
+    Time m_maxDelay = Seconds(10);
+    DelayCallback m_delayCallback;
+    EventId m_check;
+
+    // Open addressing, linear probing; flow index per slot
+    std::vector<uint32_t> m_slots;
+
+    // Flow table, one column per field, indexed by FlowId - 1
+    std::vector<uint32_t> m_src;
+    std::vector<uint32_t> m_dst;
+    std::vector<uint16_t> m_srcPort;
+    std::vector<uint16_t> m_dstPort;
+    std::vector<uint8_t> m_protocol;
+    std::vector<uint64_t> m_txPackets;
+    std::vector<uint64_t> m_txBytes;
+    std::vector<uint64_t> m_rxPackets;
+    std::vector<uint64_t> m_rxBytes;
+    std::vector<int64_t> m_firstTxNs;
+    std::vector<int64_t> m_lastTxNs;
+    std::vector<int64_t> m_firstRxNs;
+    std::vector<int64_t> m_lastRxNs;
+    std::vector<uint32_t> m_countdown;
+    std::vector<uint64_t> m_sampledTx;
+    std::vector<uint64_t> m_sampledRx;
+    std::vector<uint64_t> m_sampledLost;
+    std::vector<int64_t> m_sampledDelayNs;
+
+    // Timed packets on their way, by packet uid
+    std::unordered_map<uint64_t, InFlight> m_inFlight;
+
+    FlowMonitor::FlowStatsContainer m_stats;
+};
+
+} // namespace ns3
+
+#endif /* LIGHT_FLOW_MONITOR_H */
@@ -0,0 +1,305 @@
+/*
+ * Scheduled link failures and reconvergence measurement.
+ *
+ * LinkFailureInjector takes point-to-point links down and back up. A
+ * failure drops everything arriving on either end at once (a disabled
+ * RateErrorModel with rate 1 is switched on). After the detection delay
+ * the Ipv4 interfaces on both ends are set down, which is what routing
+ * reacts to. Recovery is the same in reverse. With LazyGlobalRouting only
+ * the affected shortest-path subtrees are recomputed per event. With
+ * Ipv4GlobalRouting, set RespondToInterfaceEvents, and every event
+ * rebuilds all tables.
+ *
+ * ReconvergenceMeter watches one UdpClient -> UdpServer flow. For each
+ * outage it reports how long after the failure the first packet sent got
+ * through again, and how many packets sent in between were lost;
+ * CountLost() gives the total over overlapping outages.
+ *
+ * Usage:
+ *    LinkFailureInjector failures;
+ *    failures.SetDetectionDelay(MilliSeconds(20));
+ *    for (size_t i : topo.core) failures.Add(topo.links[i]);
+ *    failures.ScheduleRandom(120, Seconds(2), Seconds(5), Seconds(55)); // 120 per minute
+ *    ReconvergenceMeter meter;
+ *    meter.Install(clientApp.Get(0), serverApp.Get(0));
+ *    Simulator::Run();
+ *    auto results = meter.Evaluate(failures.GetOutages());
+ */
+
+#ifndef LINK_FAILURE_H
+#define LINK_FAILURE_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ns3
+{
+
+/* ---------- INJECTOR ---------- */
+class LinkFailureInjector
+{
+  public:
+    struct Outage
+    {
+        uint32_t link;
+        Time down;
+        Time up;
+    };
+
+    // Time from the physical failure (or repair) to the interfaces going down (up)
+    void SetDetectionDelay(Time delay)
+    {
+        m_detection = delay;
+    }
+
+    // Registers a link and returns its index for Schedule
+    uint32_t Add(const NetDeviceContainer& link)
+    {
+        Link l;
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            l.devices[j] = link.Get(j);
+            Ptr<RateErrorModel> em = CreateObject<RateErrorModel>();
+            em->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+            em->SetRate(1.0);
+            em->Disable();
+            l.errors[j] = em;
+            l.devices[j]->SetAttribute("ReceiveErrorModel", PointerValue(em));
+        }
+        m_links.push_back(l);
+        return m_links.size() - 1;
+    }
+
+    uint32_t GetNLinks() const
+    {
+        return m_links.size();
+    }
+
+    // Fails link at `down` for `duration`. Outages of one link must not overlap.
+    void Schedule(uint32_t link, Time down, Time duration)
+    {
+        NS_ABORT_MSG_IF(link >= m_links.size(), "LinkFailureInjector: unknown link " << link);
+        Link& l = m_links[link];
+        NS_ABORT_MSG_IF(down < l.busyUntil, "LinkFailureInjector: overlapping outages on link " << link);
+        l.busyUntil = down + duration;
+        m_outages.push_back(Outage{link, down, down + duration});
+        Simulator::Schedule(down - Simulator::Now(), &LinkFailureInjector::SetLink, this, link, false);
+        Simulator::Schedule(down + duration - Simulator::Now(),
+                            &LinkFailureInjector::SetLink, this, link, true);
+    }
+
+    // Poisson failures at perMinute over [start, stop) on random links that
+    // are up at the time, with exponential outage durations
+    void ScheduleRandom(double perMinute, Time meanOutage, Time start, Time stop)
+    {
+        NS_ABORT_MSG_IF(m_links.empty(), "LinkFailureInjector: no links added");
+        Ptr<ExponentialRandomVariable> gap = CreateObject<ExponentialRandomVariable>();
+        gap->SetAttribute("Mean", DoubleValue(60.0 / perMinute));
+        Ptr<ExponentialRandomVariable> length = CreateObject<ExponentialRandomVariable>();
+        length->SetAttribute("Mean", DoubleValue(meanOutage.GetSeconds()));
+        Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable>();
+        if (m_stream >= 0)
+        {
+            gap->SetStream(m_stream);
+            length->SetStream(m_stream + 1);
+            pick->SetStream(m_stream + 2);
+        }
+
+        std::vector<uint32_t> idle;
+        for (Time t = start + Seconds(gap->GetValue()); t < stop; t += Seconds(gap->GetValue()))
+        {
+            idle.clear();
+            for (uint32_t i = 0; i < m_links.size(); i++)
+            {
+                if (m_links[i].busyUntil <= t)
+                {
+                    idle.push_back(i);
+                }
+            }
+            if (idle.empty())
+            {
+                continue;
+            }
+            uint32_t link = idle[pick->GetInteger(0, idle.size() - 1)];
+            Schedule(link, t, Seconds(length->GetValue()));
+        }
+    }
+
+    // Fixed random streams for ScheduleRandom; returns the number used
+    int64_t AssignStreams(int64_t stream)
+    {
+        m_stream = stream;
+        return 3;
+    }
+
+    const std::vector<Outage>& GetOutages() const
+    {
+        return m_outages;
+    }
+
+  private:
+    struct Link
+    {
+        Ptr<NetDevice> devices[2];
+        Ptr<RateErrorModel> errors[2];
+        Time busyUntil;
+    };
+
+    // Physical state changes now, routing learns about it after the detection delay
+    void SetLink(uint32_t link, bool up)
+    {
+        Link& l = m_links[link];
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            if (up)
+            {
+                l.errors[j]->Disable();
+            }
+            else
+            {
+                l.errors[j]->Enable();
+            }
+        }
+        Simulator::Schedule(m_detection, &LinkFailureInjector::Detect, this, link, up);
+    }
+
+    void Detect(uint32_t link, bool up)
+    {
+        Link& l = m_links[link];
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            Ptr<Ipv4> ipv4 = l.devices[j]->GetNode()->GetObject<Ipv4>();
+            int32_t iface = ipv4->GetInterfaceForDevice(l.devices[j]);
+            if (iface < 0)
+            {
+                continue;
+            }
+            if (up)
+            {
+                ipv4->SetUp(iface);
+            }
+            else
+            {
+                ipv4->SetDown(iface);
+            }
+        }
+    }
+
+    Time m_detection = MilliSeconds(20);
+    int64_t m_stream = -1;
+    std::vector<Link> m_links;
+    std::vector<Outage> m_outages;
+};
+
+/* ---------- RECONVERGENCE ---------- */
+class ReconvergenceMeter
+{
+  public:
+    struct Result
+    {
+        LinkFailureInjector::Outage outage;
+        Time reconvergence; // first packet sent after the failure that arrived, minus failure time
+        uint64_t lost;      // packets sent in between that never arrived
+        bool recovered;     // false if nothing sent after the failure arrived
+        uint64_t firstLost; // index of the first of them in the sent sequence
+    };
+
+    // client must be a UdpClient and server a UdpServer
+    void Install(Ptr<Application> client, Ptr<Application> server)
+    {
+        client->TraceConnectWithoutContext("Tx", MakeCallback(&ReconvergenceMeter::Sent, this));
+        server->TraceConnectWithoutContext("Rx", MakeCallback(&ReconvergenceMeter::Received, this));
+    }
+
+    uint64_t GetSent() const
+    {
+        return m_sent.size();
+    }
+
+    uint64_t GetReceived() const
+    {
+        return m_nReceived;
+    }
+
+    std::vector<Result> Evaluate(const std::vector<LinkFailureInjector::Outage>& outages) const
+    {
+        std::vector<Result> results;
+        results.reserve(outages.size());
+        for (const auto& o : outages)
+        {
+            int64_t down = o.down.GetNanoSeconds();
+            size_t s = std::lower_bound(m_sent.begin(), m_sent.end(), down) - m_sent.begin();
+            Result r{o, Time(0), 0, false, s};
+            for (; s < m_sent.size(); s++)
+            {
+                if (m_received[s])
+                {
+                    r.recovered = true;
+                    r.reconvergence = NanoSeconds(m_sent[s] - down);
+                    break;
+                }
+                r.lost++;
+            }
+            results.push_back(r);
+        }
+        return results;
+    }
+
+    // Packets lost during any of the outages; where outages overlap their
+    // losses overlap too, and each packet is counted once
+    static uint64_t CountLost(std::vector<Result> results)
+    {
+        std::sort(results.begin(), results.end(), [](const Result& a, const Result& b) {
+            return a.firstLost < b.firstLost;
+        });
+        uint64_t lost = 0;
+        uint64_t end = 0; // past the last packet counted
+        for (const Result& r : results)
+        {
+            uint64_t last = r.firstLost + r.lost;
+            if (last > end)
+            {
+                lost += last - std::max(end, r.firstLost);
+                end = last;
+            }
+        }
+        return lost;
+    }
+
+  private:
+    void Sent(Ptr<const Packet> p)
+    {
+        SeqTsHeader h;
+        p->PeekHeader(h);
+        if (h.GetSeq() >= m_sent.size())
+        {
+            m_sent.resize(h.GetSeq() + 1, Simulator::Now().GetNanoSeconds());
+            m_received.resize(h.GetSeq() + 1, 0);
+        }
+    }
+
+    void Received(Ptr<const Packet> p)
+    {
+        SeqTsHeader h;
+        p->PeekHeader(h);
+        if (h.GetSeq() < m_received.size() && !m_received[h.GetSeq()])
+        {
+            m_received[h.GetSeq()] = 1;
+            m_nReceived++;
+        }
+    }
+
+    std::vector<int64_t> m_sent; // send time by sequence number
+    std::vector<char> m_received;
+    uint64_t m_nReceived = 0;
+};
+
+} // namespace ns3
+
+#endif /* LINK_FAILURE_H */
@@ -1,11 +1,26 @@
 /*
  * ns-3 Exercise 2: Mesh Topology and Routing Analysis
  *
- * Topology:
- *    Node 0 (Client A) --> Node 1 (Router R) --> Node 2 (Server B)
+ * Topology (rows x cols router grid, redundant paths between every pair):
  *
- * Link A-R: 10Mbps / 5ms
- * Link R-B: 5Mbps  / 10ms  (Slower link)
+ *    Client A -- R(0,0) -- R(0,1) -- ... -- R(0,cols-1)
+ *                  |         |                 |
+ *                R(1,0) -- R(1,1) -- ... -- R(1,cols-1)
+ *                  |         |                 |
+ *                 ...       ...               ...
+ *                  |         |                 |
+ *                R(rows-1,0) -- ...  -- R(rows-1,cols-1) -- Server B
+ *
+ * Core links: 10Mbps / 5ms, access links: 100Mbps / 1ms.
+ *
+ * A constant-rate UDP flow runs from A to B while random core links fail
+ * and recover. Routing learns about a failure after the detection delay.
+ * For each outage the script reports the reconvergence time and the
+ * packets lost before the flow got through again.
+ *
+ * Usage:
+ *    ./ns3 run "mesh-routing-analysis --rows=4 --cols=4 --failuresPerMinute=300"
+ *    ./ns3 run "mesh-routing-analysis --routing=global"  (full rebuild per event)
  */
 
 #include "ns3/core-module.h"
@@ -15,6 +30,16 @@
 #include "ns3/applications-module.h"
 #include "ns3/netanim-module.h"
 
+#include "anim-recorder.h"
+#include "binary-trace.h"
+#include "lazy-routing.h"
+#include "link-failure.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "topology-builder.h"
+
+#include <algorithm>
+
 using namespace ns3;
 NS_LOG_COMPONENT_DEFINE("MeshRoutingAnalysis");
 
@@ -23,114 +48,261 @@ int main(int argc, char *argv[])
     // -------------------------------------------------------------
     // 1. CONFIGURATION
     // -------------------------------------------------------------
-    std::string dataRateAR = "10Mbps";
-    std::string delayAR    = "5ms";
+    uint32_t rows = 3;
+    uint32_t cols = 4;
+    bool diagonals = false;
+
+    std::string coreRate  = "10Mbps";
+    std::string coreDelay = "5ms";
 
-    std::string dataRateRB = "5Mbps"; // slower link
-    std::string delayRB    = "10ms";
+    std::string accessRate  = "100Mbps";
+    std::string accessDelay = "1ms";
 
     uint32_t packetSize = 1024;
-    double simTime = 5.0;
+    double packetInterval = 1.0; // ms
+    double simTime = 60.0;
+
+    double failuresPerMinute = 120;
+    double meanOutage = 2.0;  // s
+    double detection = 20.0;  // ms
+    std::string routing = "lazy";
+    uint32_t seed = 1;
+
+    bool summary = false;
+    std::string traceFormat = "none";
+    std::string animMode = "none";
+    uint32_t animSample = 1;
+    std::string resultCache = "";
 
     CommandLine cmd;
+    cmd.AddValue("rows", "Router grid rows", rows);
+    cmd.AddValue("cols", "Router grid columns", cols);
+    cmd.AddValue("diagonals", "Add a diagonal link in every grid cell", diagonals);
+    cmd.AddValue("coreRate", "Router-to-router data rate", coreRate);
+    cmd.AddValue("coreDelay", "Router-to-router delay", coreDelay);
+    cmd.AddValue("packetSize", "UDP payload size", packetSize);
+    cmd.AddValue("packetInterval", "UDP send interval (ms)", packetInterval);
     cmd.AddValue("simTime", "Simulation duration", simTime);
+    cmd.AddValue("failuresPerMinute", "Core link failures per simulated minute (0 = none)", failuresPerMinute);
+    cmd.AddValue("meanOutage", "Mean outage duration (s)", meanOutage);
+    cmd.AddValue("detection", "Failure/repair detection delay (ms)", detection);
+    cmd.AddValue("routing", "Routing: lazy (incremental) or global (rebuild per event)", routing);
+    cmd.AddValue("seed", "Run number for the failure schedule", seed);
+    cmd.AddValue("summary", "Print machine-readable SUMMARY lines", summary);
+    cmd.AddValue("traceFormat", "Packet trace: ascii, binary or none", traceFormat);
+    cmd.AddValue("animMode", "Animation output: xml, binary or none", animMode);
+    cmd.AddValue("animSample", "Record 1 in n packets in binary animation mode", animSample);
+    cmd.AddValue("resultCache", "Directory of cached results; a known configuration is not re-run (empty = off)", resultCache);
     cmd.Parse(argc, argv);
 
-    // -------------------------------------------------------------
-    // 2. CREATE NODES
-    // -------------------------------------------------------------
-    NodeContainer nodes;
-    nodes.Create(3);   // 0=A, 1=R, 2=B
-
-    // -------------------------------------------------------------
-    // 3. CREATE LINKS
-    // -------------------------------------------------------------
+    NS_ABORT_MSG_IF(packetInterval <= 0, "--packetInterval must be positive");
+    NS_ABORT_MSG_IF(detection < 0, "--detection must not be negative");
+    NS_ABORT_MSG_IF(routing != "lazy" && routing != "global", "Unknown routing " << routing);
 
-    // Link A → R
-    PointToPointHelper p2pAR;
-    p2pAR.SetDeviceAttribute("DataRate", StringValue(dataRateAR));
-    p2pAR.SetChannelAttribute("Delay", StringValue(delayAR));
-    NetDeviceContainer dAR = p2pAR.Install(nodes.Get(0), nodes.Get(1));
+    ResultCache cache(resultCache);
+    cache.SetFileOutput(traceFormat != "none" || animMode != "none");
+    if (cache.Replay(argc, argv))
+    {
+        return 0;
+    }
 
-    // Link R → B
-    PointToPointHelper p2pRB;
-    p2pRB.SetDeviceAttribute("DataRate", StringValue(dataRateRB));
-    p2pRB.SetChannelAttribute("Delay", StringValue(delayRB));
-    NetDeviceContainer dRB = p2pRB.Install(nodes.Get(1), nodes.Get(2));
+    RngSeedManager::SetRun(seed);
 
     // -------------------------------------------------------------
-    // 4. INTERNET + ROUTING
+    // 2. TOPOLOGY + ROUTING
     // -------------------------------------------------------------
-    InternetStackHelper stack;
-    stack.Install(nodes);
-
-    Ipv4AddressHelper addressA;
-    addressA.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer iAR = addressA.Assign(dAR);
+    TopologyBuilder builder;
+    LazyGlobalRoutingHelper lazyRouting;
+    if (routing == "lazy")
+    {
+        builder.SetRoutingHelper(lazyRouting.GetListRouting());
+    }
+    else
+    {
+        // Global routing only reacts to interface changes with this set
+        Config::SetDefault("ns3::Ipv4GlobalRouting::RespondToInterfaceEvents", BooleanValue(true));
+    }
 
-    Ipv4AddressHelper addressB;
-    addressB.SetBase("10.1.2.0", "255.255.255.0");
-    Ipv4InterfaceContainer iRB = addressB.Assign(dRB);
+    Topology topo = builder.Mesh(rows, cols,
+                                 LinkSpec(coreRate, coreDelay),
+                                 LinkSpec(accessRate, accessDelay),
+                                 diagonals);
+    Ptr<Node> clientNode = topo.senders.Get(0);
+    Ptr<Node> serverNode = topo.receivers.Get(0);
 
-    // Populate routing tables
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    if (routing == "global")
+    {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
     // -------------------------------------------------------------
-    // 5. APPLICATIONS
+    // 3. APPLICATIONS
     // -------------------------------------------------------------
     uint16_t port = 7;
-    Ipv4Address serverAddress = iRB.GetAddress(1); // Node 2
+    Ipv4Address serverAddress = topo.GetReceiverAddress(0);
 
-    // Server on Node 2
-    UdpEchoServerHelper echoServer(port);
-    ApplicationContainer serverApp = echoServer.Install(nodes.Get(2));
+    UdpServerHelper server(port);
+    ApplicationContainer serverApp = server.Install(serverNode);
     serverApp.Start(Seconds(0.0));
     serverApp.Stop(Seconds(simTime));
 
-    // Client on Node 0 → sends to Node 2
-    UdpEchoClientHelper echoClient(serverAddress, port);
-    echoClient.SetAttribute("MaxPackets", UintegerValue(1));
-    echoClient.SetAttribute("Interval", TimeValue(Seconds(0.01)));
-    echoClient.SetAttribute("PacketSize", UintegerValue(packetSize));
+    UdpClientHelper client(serverAddress, port);
+    client.SetAttribute("MaxPackets", UintegerValue(0));
+    client.SetAttribute("Interval", TimeValue(Time::FromDouble(packetInterval, Time::MS)));
+    client.SetAttribute("PacketSize", UintegerValue(packetSize));
 
-    ApplicationContainer clientApp = echoClient.Install(nodes.Get(0));
+    ApplicationContainer clientApp = client.Install(clientNode);
     clientApp.Start(Seconds(1.0));
-    clientApp.Stop(Seconds(simTime));
+    clientApp.Stop(Seconds(simTime - 1.0));
+
+    // -------------------------------------------------------------
+    // 4. LINK FAILURES + RECONVERGENCE
+    // -------------------------------------------------------------
+    LinkFailureInjector failures;
+    failures.SetDetectionDelay(Time::FromDouble(detection, Time::MS));
+    for (size_t i : topo.core)
+    {
+        failures.Add(topo.links[i]);
+    }
+    if (failuresPerMinute > 0)
+    {
+        failures.AssignStreams(0);
+        failures.ScheduleRandom(failuresPerMinute, Seconds(meanOutage),
+                                Seconds(2.0), Seconds(simTime - 2.0));
+    }
+
+    ReconvergenceMeter meter;
+    meter.Install(clientApp.Get(0), serverApp.Get(0));
 
     // -------------------------------------------------------------
-    // 6. TRACING (ASCII + NetAnim)
+    // 5. TRACING (packet trace + NetAnim)
     // -------------------------------------------------------------
 
-    // FIXED: Single trace stream for both links
-    AsciiTraceHelper ascii;
-    Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream("scratch/mesh-routing-analysis.tr");
+    // One trace for all links: indexed binary, or ASCII on request
+    PacketTraceWriter trace;
+    if (traceFormat == "ascii")
+    {
+        AsciiTraceHelper ascii;
+        Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream("scratch/mesh-routing-analysis.tr");
 
-    p2pAR.EnableAsciiAll(stream);
-    p2pRB.EnableAsciiAll(stream);
+        PointToPointHelper p2p;
+        p2p.EnableAsciiAll(stream);
+    }
+    else if (traceFormat == "binary")
+    {
+        NS_ABORT_MSG_UNLESS(trace.Open("scratch/mesh-routing-analysis.ptr"), "Cannot open scratch/mesh-routing-analysis.ptr");
+        trace.EnableAll();
+    }
 
-    // NetAnim XML output
-    AnimationInterface anim("scratch/mesh-routing-analysis.xml");
+    // NetAnim output (off by default; binary files convert with anim-convert)
+    AnimRecorder anim("scratch/mesh-routing-analysis", animMode);
+    anim.SetSampling(animSample);
 
-    // Node positions
-    anim.SetConstantPosition(nodes.Get(0), 5.0, 10.0);   // A
-    anim.SetConstantPosition(nodes.Get(1), 20.0, 10.0);  // R
-    anim.SetConstantPosition(nodes.Get(2), 35.0, 10.0);  // B
+    // Node positions: grid of routers, client left of R(0,0), server right of the last router
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        for (uint32_t c = 0; c < cols; c++)
+        {
+            anim.SetConstantPosition(topo.routers.Get(r * cols + c), 20.0 + 15.0 * c, 10.0 + 15.0 * r);
+        }
+    }
+    anim.SetConstantPosition(clientNode, 5.0, 10.0);
+    anim.SetConstantPosition(serverNode, 35.0 + 15.0 * (cols - 1), 10.0 + 15.0 * (rows - 1));
 
     // Node labels
-    anim.UpdateNodeDescription(nodes.Get(0), "Client A");
-    anim.UpdateNodeDescription(nodes.Get(1), "Router R");
-    anim.UpdateNodeDescription(nodes.Get(2), "Server B");
+    anim.UpdateNodeDescription(clientNode, "Client A");
+    anim.UpdateNodeDescription(serverNode, "Server B");
 
     // Node colors
-    anim.UpdateNodeColor(nodes.Get(0), 0, 255, 0);   // Green
-    anim.UpdateNodeColor(nodes.Get(1), 255, 255, 0); // Yellow
-    anim.UpdateNodeColor(nodes.Get(2), 0, 0, 255);   // Blue
+    anim.UpdateNodeColor(clientNode, 0, 255, 0);   // Green
+    for (uint32_t i = 0; i < topo.routers.GetN(); i++)
+    {
+        anim.UpdateNodeColor(topo.routers.Get(i), 255, 255, 0); // Yellow
+    }
+    anim.UpdateNodeColor(serverNode, 0, 0, 255);   // Blue
 
     // -------------------------------------------------------------
-    // 7. RUN SIMULATION
+    // 6. RUN SIMULATION
     // -------------------------------------------------------------
     Simulator::Stop(Seconds(simTime));
+    RunStats runStats;
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+    trace.Close();
+
+    // -------------------------------------------------------------
+    // 7. RESULTS
+    // -------------------------------------------------------------
+    std::vector<ReconvergenceMeter::Result> results = meter.Evaluate(failures.GetOutages());
+    uint64_t affected = 0;
+    uint64_t recovered = 0;
+    uint64_t outageLost = ReconvergenceMeter::CountLost(results);
+    double sumReconv = 0;
+    double maxReconv = 0;
+    for (const auto &r : results)
+    {
+        // Outages off the flow's path are delivered through after one interval
+        bool hit = r.lost > 0 || !r.recovered;
+        if (hit)
+        {
+            affected++;
+            if (r.recovered)
+            {
+                recovered++;
+                sumReconv += r.reconvergence.GetSeconds();
+                maxReconv = std::max(maxReconv, r.reconvergence.GetSeconds());
+            }
+            std::cout << "Outage of core link " << r.outage.link << " at "
+                      << r.outage.down.GetSeconds() << " s ("
+                      << (r.outage.up - r.outage.down).GetMilliSeconds() << " ms): ";
+            if (r.recovered)
+            {
+                std::cout << "reconverged after " << r.reconvergence.GetMilliSeconds() << " ms, ";
+            }
+            else
+            {
+                std::cout << "never reconverged, ";
+            }
+            std::cout << r.lost << " packets lost\n";
+        }
+    }
+
+    uint64_t lost = meter.GetSent() - meter.GetReceived();
+    double meanReconv = recovered > 0 ? sumReconv / recovered : 0;
+    std::cout << "Routers: " << topo.routers.GetN() << ", core links: " << topo.core.size()
+              << ", routing: " << routing << "\n"
+              << "Outages: " << results.size() << " (" << affected << " on the flow's path)\n"
+              << "Mean reconvergence: " << meanReconv * 1e3 << " ms, max " << maxReconv * 1e3
+              << " ms (" << affected - recovered << " never reconverged)\n"
+              << "Packets sent: " << meter.GetSent() << ", received: " << meter.GetReceived()
+              << ", lost: " << lost << " (" << outageLost << " during outages)\n"
+              << "Wall time: " << runStats.GetWallSeconds() << " s\n";
+    if (routing == "lazy")
+    {
+        const LazyRouteOracle::Stats &s = lazyRouting.GetOracle()->GetStats();
+        std::cout << "Route trees built: " << s.treesBuilt
+                  << ", incremental updates: " << s.incrementalUpdates
+                  << ", nodes relaxed: " << s.nodesRelaxed << "\n";
+    }
+
+    if (summary)
+    {
+        std::cout << "SUMMARY scope=total"
+                  << " routers=" << topo.routers.GetN()
+                  << " outages=" << results.size()
+                  << " affected=" << affected
+                  << " meanReconvergence=" << meanReconv
+                  << " maxReconvergence=" << maxReconv
+                  << " txPackets=" << meter.GetSent()
+                  << " rxPackets=" << meter.GetReceived()
+                  << " lostPackets=" << lost
+                  << " outageLost=" << outageLost
+                  << " wallSeconds=" << runStats.GetWallSeconds() << "\n";
+        runStats.PrintSummary(std::cout);
+    }
+    cache.Store();
+
     Simulator::Destroy();
 
     return 0;
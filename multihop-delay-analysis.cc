@@ -5,6 +5,14 @@
 #include "ns3/applications-module.h"
 #include "ns3/netanim-module.h"
 
+#include "anim-recorder.h"
+#include "binary-trace.h"
+#include "hop-delay.h"
+#include "lazy-routing.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "topology-builder.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("MultiHopDelayAnalysis");
@@ -21,56 +29,57 @@ int main(int argc, char *argv[])
     std::string delay23 = "15ms";
 
     uint32_t packetSize = 1024;
+    uint32_t numPackets = 1;
+    double interval = 1.0;
     double simTime = 8.0;
 
+    std::string traceFormat = "binary";
+    std::string routing = "global";
+    bool summary = false;
+    std::string animMode = "binary";
+    uint32_t animSample = 1;
+    std::string resultCache = "";
+
     CommandLine cmd;
     cmd.AddValue("packetSize", "Size of UDP packet", packetSize);
+    cmd.AddValue("numPackets", "Number of echo requests", numPackets);
+    cmd.AddValue("interval", "Echo request interval (s)", interval);
+    cmd.AddValue("simTime", "Simulation duration (s)", simTime);
+    cmd.AddValue("traceFormat", "Packet trace: ascii, binary or none", traceFormat);
+    cmd.AddValue("routing", "Routing: global (full SPF at start) or lazy (on demand)", routing);
+    cmd.AddValue("summary", "Print a machine-readable SUMMARY line with event throughput", summary);
+    cmd.AddValue("animMode", "Animation output: xml, binary or none", animMode);
+    cmd.AddValue("animSample", "Record 1 in n packets in binary animation mode", animSample);
+    cmd.AddValue("resultCache", "Directory of cached results; a known configuration is not re-run (empty = off)", resultCache);
     cmd.Parse(argc, argv);
 
-    // CREATE 4 NODES
-    NodeContainer nodes;
-    nodes.Create(4); 
-
-    // INSTALL LINKS
-
-    // Link: 0 → 1
-    PointToPointHelper p2p01;
-    p2p01.SetDeviceAttribute("DataRate", StringValue(rate01));
-    p2p01.SetChannelAttribute("Delay", StringValue(delay01));
-    NetDeviceContainer d01 = p2p01.Install(nodes.Get(0), nodes.Get(1));
-
-    // Link: 1 → 2
-    PointToPointHelper p2p12;
-    p2p12.SetDeviceAttribute("DataRate", StringValue(rate12));
-    p2p12.SetChannelAttribute("Delay", StringValue(delay12));
-    NetDeviceContainer d12 = p2p12.Install(nodes.Get(1), nodes.Get(2));
-
-    // Link: 2 → 3
-    PointToPointHelper p2p23;
-    p2p23.SetDeviceAttribute("DataRate", StringValue(rate23));
-    p2p23.SetChannelAttribute("Delay", StringValue(delay23));
-    NetDeviceContainer d23 = p2p23.Install(nodes.Get(2), nodes.Get(3));
-
-    // STACK + ROUTING
-    InternetStackHelper stack;
-    stack.Install(nodes);
-
-    Ipv4AddressHelper addr;
-
-    // 0–1 subnet
-    addr.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer i01 = addr.Assign(d01);
-
-    // 1–2 subnet
-    addr.SetBase("10.1.2.0", "255.255.255.0");
-    Ipv4InterfaceContainer i12 = addr.Assign(d12);
-
-    // 2–3 subnet
-    addr.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer i23 = addr.Assign(d23);
+    ResultCache cache(resultCache);
+    cache.SetFileOutput(traceFormat != "none" || animMode != "none");
+    if (cache.Replay(argc, argv))
+    {
+        return 0;
+    }
+
+    // 4 NODES, 3 LINKS: node 0 (sender) -- 1 -- 2 -- 3 (receiver)
+    // Subnets 10.1.1.0/24, 10.1.2.0/24, 10.1.3.0/24 in link order
+    TopologyBuilder builder;
+    LazyGlobalRoutingHelper lazyRouting;
+    if (routing == "lazy")
+    {
+        builder.SetRoutingHelper(lazyRouting.GetListRouting());
+    }
+    Topology topo = builder.Chain({LinkSpec(rate01, delay01),
+                                   LinkSpec(rate12, delay12),
+                                   LinkSpec(rate23, delay23)});
+
+    NodeContainer nodes(topo.senders, topo.routers, topo.receivers);
+    Ipv4InterfaceContainer i23 = topo.interfaces[2];
 
     // Enable routing
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    if (routing == "global")
+    {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
     // APPLICATIONS
     uint16_t port = 9;
@@ -83,23 +92,36 @@ int main(int argc, char *argv[])
 
     // Client on Node 0 sending to Node 3
     UdpEchoClientHelper client(i23.GetAddress(1), port);
-    client.SetAttribute("MaxPackets", UintegerValue(1));
-    client.SetAttribute("Interval", TimeValue(Seconds(1.0)));
+    client.SetAttribute("MaxPackets", UintegerValue(numPackets));
+    client.SetAttribute("Interval", TimeValue(Seconds(interval)));
     client.SetAttribute("PacketSize", UintegerValue(packetSize));
 
     ApplicationContainer clientApp = client.Install(nodes.Get(0));
     clientApp.Start(Seconds(1.0));
     clientApp.Stop(Seconds(simTime));
 
-    // TRACING (.tr file)
-    AsciiTraceHelper ascii;
-    Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream("scratch/multihop.tr");
-    p2p01.EnableAsciiAll(stream);
-    p2p12.EnableAsciiAll(stream);
-    p2p23.EnableAsciiAll(stream);
-
-    // NETANIM (.xml file)
-    AnimationInterface anim("scratch/multihop.xml");
+    // PER-HOP DELAY (queuing / transmission / propagation, kept in memory)
+    HopDelayMonitor hops;
+    hops.Install(nodes);
+
+    // TRACING (.tr text file or indexed .ptr binary file)
+    PacketTraceWriter trace;
+    if (traceFormat == "ascii")
+    {
+        AsciiTraceHelper ascii;
+        Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream("scratch/multihop.tr");
+        PointToPointHelper p2p;
+        p2p.EnableAsciiAll(stream);
+    }
+    else if (traceFormat == "binary")
+    {
+        NS_ABORT_MSG_UNLESS(trace.Open("scratch/multihop.ptr"), "Cannot open scratch/multihop.ptr");
+        trace.EnableAll();
+    }
+
+    // NETANIM
+    AnimRecorder anim("scratch/multihop", animMode);
+    anim.SetSampling(animSample);
 
     anim.SetConstantPosition(nodes.Get(0), 5, 10);   // Sender
     anim.SetConstantPosition(nodes.Get(1), 20, 10);  // Hop 1
@@ -118,7 +140,19 @@ int main(int argc, char *argv[])
 
     //SIMULATION RUN
     Simulator::Stop(Seconds(simTime));
+    RunStats runStats;
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+    trace.Close();
+
+    hops.Print(std::cout);
+    if (summary)
+    {
+        runStats.PrintSummary(std::cout);
+    }
+    cache.Store();
+
     Simulator::Destroy();
 
     return 0;
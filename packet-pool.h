@@ -0,0 +1,296 @@
+/*
+ * Opt-in free-list allocator for the per-packet heap traffic of a scenario.
+ *
+ * Every send creates a Packet, its Buffer data, PacketMetadata and
+ * ByteTagList chunks, and the sink frees them again. All of these go through
+ * operator new, so this header replaces the program's operator new/delete
+ * with a small-object allocator:
+ *
+ *    - sizes up to kMaxSize bytes map to 60 size classes (16-byte steps up
+ *      to 512, 128-byte steps up to 4096)
+ *    - each thread keeps one free list per class; a freed block goes back
+ *      on the list of the thread that frees it
+ *    - new blocks are carved from 64 KiB slabs of one reserved address
+ *      range, so delete recognises pool blocks by address alone and the
+ *      size class comes from a per-slab byte
+ *
+ * Once the in-flight packet population has been reached, allocations are
+ * served from the free lists and the heap is not touched. Anything larger
+ * than kMaxSize, and everything before Enable(), uses malloc. Until Enable()
+ * is called the only cost is one address comparison per delete.
+ *
+ * The replacement functions are real definitions, so include this header
+ * from the scenario's main file only.
+ *
+ * Usage:
+ *    #include "packet-pool.h"
+ *    if (packetPool) PacketPool::Enable();   // right after cmd.Parse
+ *    ...
+ *    Simulator::Run();
+ *    PacketPool::Print(std::cout);
+ *    PacketPool::PrintSummary(std::cout);  // SUMMARY scope=pool ...
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "ns3/core-module.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+
+#include <sys/mman.h>
+
+namespace ns3
+{
+
+class PacketPool
+{
+  public:
+    // Counters of the calling thread (the simulation thread in a scenario)
+    struct Stats
+    {
+        uint64_t pooled;  // allocations served by the pool
+        uint64_t reused;  // ... of which from a free list
+        uint64_t carved;  // ... of which from fresh slab space
+        uint64_t freed;   // blocks returned to a free list
+        uint64_t heap;    // allocations passed to malloc (too large or out of slabs)
+        uint64_t slabs;   // slabs taken by this thread
+    };
+
+    static void Enable()
+    {
+        if (s_region == nullptr)
+        {
+            // Address space only; pages are committed as slabs are touched
+            void* region = mmap(nullptr, kRegionSize, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            NS_ABORT_MSG_IF(region == MAP_FAILED, "PacketPool: cannot reserve the slab region");
+            s_region = static_cast<char*>(region);
+        }
+        s_enabled = true;
+    }
+
+    static bool IsEnabled()
+    {
+        return s_enabled;
+    }
+
+    static const Stats& GetStats()
+    {
+        return t_cache.stats;
+    }
+
+    static double GetReuseRate()
+    {
+        const Stats& s = t_cache.stats;
+        return s.pooled > 0 ? double(s.reused) / s.pooled : 0;
+    }
+
+    static void Print(std::ostream& os)
+    {
+        if (!s_enabled)
+        {
+            return;
+        }
+        const Stats& s = t_cache.stats;
+        os << "Packet pool: " << s.pooled << " allocations, " << GetReuseRate() * 100
+           << "% from free lists, " << s.carved << " carved from " << s.slabs << " slabs ("
+           << s.slabs * kSlabSize / 1024 << " KiB), " << s.heap << " from the heap\n";
+    }
+
+    static void PrintSummary(std::ostream& os)
+    {
+        if (!s_enabled)
+        {
+            return;
+        }
+        const Stats& s = t_cache.stats;
+        os << "SUMMARY scope=pool"
+           << " allocations=" << s.pooled
+           << " reused=" << s.reused
+           << " carved=" << s.carved
+           << " freed=" << s.freed
+           << " heap=" << s.heap
+           << " slabs=" << s.slabs
+           << " reuseRate=" << GetReuseRate() << "\n";
+    }
+
+    /* ---------- used by operator new / delete ---------- */
+
+    static void* Allocate(std::size_t size)
+    {
+        if (!s_enabled)
+        {
+            return std::malloc(size ? size : 1);
+        }
+        ThreadCache& cache = t_cache;
+        if (size > kMaxSize)
+        {
+            cache.stats.heap++;
+            return std::malloc(size);
+        }
+
+        uint32_t c = ClassOf(size);
+        FreeNode* node = cache.free[c];
+        if (node != nullptr)
+        {
+            cache.free[c] = node->next;
+            cache.stats.pooled++;
+            cache.stats.reused++;
+            return node;
+        }
+
+        std::size_t blockSize = ClassSize(c);
+        if (cache.cursor[c] == cache.end[c])
+        {
+            std::size_t slab = s_nextSlab.fetch_add(1, std::memory_order_relaxed);
+            if (slab >= kSlabs)
+            {
+                cache.stats.heap++;
+                return std::malloc(size);
+            }
+            s_slabClass[slab] = c;
+            cache.cursor[c] = s_region + slab * kSlabSize;
+            cache.end[c] = cache.cursor[c] + kSlabSize / blockSize * blockSize;
+            cache.stats.slabs++;
+        }
+        void* block = cache.cursor[c];
+        cache.cursor[c] += blockSize;
+        cache.stats.pooled++;
+        cache.stats.carved++;
+        return block;
+    }
+
+    static void Release(void* p)
+    {
+        std::uintptr_t offset = std::uintptr_t(p) - std::uintptr_t(s_region);
+        if (s_region == nullptr || offset >= kRegionSize)
+        {
+            std::free(p);
+            return;
+        }
+        ThreadCache& cache = t_cache;
+        uint32_t c = s_slabClass[offset / kSlabSize];
+        FreeNode* node = static_cast<FreeNode*>(p);
+        node->next = cache.free[c];
+        cache.free[c] = node;
+        cache.stats.freed++;
+    }
+
+  private:
+    static constexpr std::size_t kMaxSize = 4096;
+    static constexpr uint32_t kClasses = 60;
+    static constexpr std::size_t kSlabSize = 64 * 1024;
+    static constexpr std::size_t kRegionSize = std::size_t(1) << 30;
+    static constexpr std::size_t kSlabs = kRegionSize / kSlabSize;
+
+    struct FreeNode
+    {
+        FreeNode* next;
+    };
+
+    // Plain zero-initialised data: operator new may run before any
+    // dynamic initialisation of this thread
+    struct ThreadCache
+    {
+        FreeNode* free[kClasses];
+        char* cursor[kClasses];
+        char* end[kClasses];
+        Stats stats;
+    };
+
+    static uint32_t ClassOf(std::size_t size)
+    {
+        if (size <= 512)
+        {
+            return size == 0 ? 0 : (size + 15) / 16 - 1;
+        }
+        return 32 + (size - 512 + 127) / 128 - 1;
+    }
+
+    static std::size_t ClassSize(uint32_t c)
+    {
+        return c < 32 ? (c + 1) * 16 : 512 + (c - 31) * 128;
+    }
+
+    static inline bool s_enabled = false;
+    static inline char* s_region = nullptr;
+    static inline std::atomic<std::size_t> s_nextSlab{0};
+    static inline uint8_t s_slabClass[kSlabs];
+    static inline thread_local ThreadCache t_cache;
+};
+
+} // namespace ns3
+
+/* ---------- global operator new / delete ---------- */
+
+void*
+operator new(std::size_t size)
+{
+    void* p = ns3::PacketPool::Allocate(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void*
+operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void*
+operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return ns3::PacketPool::Allocate(size);
+}
+
+void*
+operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return ns3::PacketPool::Allocate(size);
+}
+
+void
+operator delete(void* p) noexcept
+{
+    ns3::PacketPool::Release(p);
+}
+
+void
+operator delete[](void* p) noexcept
+{
+    ns3::PacketPool::Release(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    ns3::PacketPool::Release(p);
+}
+
+void
+operator delete[](void* p, std::size_t) noexcept
+{
+    ns3::PacketPool::Release(p);
+}
+
+void
+operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    ns3::PacketPool::Release(p);
+}
+
+void
+operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    ns3::PacketPool::Release(p);
+}
+
+#endif /* PACKET_POOL_H */
@@ -0,0 +1,934 @@
+/*
+ * Conservative parallel execution of one scenario on several cores.
+ *
+ * Nodes are assigned to partitions. Run() forks one process per partition
+ * beyond the first, from the fully built scenario, and every process then
+ * executes only the events of its own nodes (plus context-free events such
+ * as Simulator::Stop, which run everywhere). Point-to-point links between
+ * partitions are swapped for PartitionChannels that serialize a packet
+ * into the sending process's outbox instead of scheduling its reception.
+ *
+ * Synchronization is window-based (YAWNS): at every barrier the processes
+ * report their next event time and exchange their outboxes through the
+ * main partition over socketpairs; with start the earliest pending time
+ * anywhere, each process then runs the events before start + lookahead,
+ * where lookahead is the smallest delay of a cross-partition link. No
+ * packet sent in a window can arrive inside it, so no event is ever run out
+ * of order and the windows need no rollback. No MPI or network is used.
+ *
+ * Processes rather than threads, because ns-3 packets are not thread-safe:
+ * Buffer and PacketMetadata keep global free lists, the packet uid counter
+ * is a plain static and reference counts are not atomic.
+ *
+ * Packets on cross-partition links are always scheduled at a barrier, in
+ * (arrival time, sending node, per-sender sequence) order, so a same-time
+ * tie between an arrival and a local event is decided by the window
+ * boundaries alone. Enable(n, true) runs the same layout, windows and
+ * barriers in one process without forking; it is the sequential reference,
+ * and every node sees the same events in the same order in both. Packet
+ * uids and the order in which FlowIds are handed out still differ, so
+ * compare flows by their 5-tuple (partition-check does). The plain
+ * simulator, which schedules an arrival when the packet is sent, may order
+ * such ties differently.
+ *
+ * FlowMonitor cannot follow packets across processes; use LightFlowMonitor
+ * with timestamp tags and merge the partitions' records with Gather().
+ * Files opened before Run() are shared by all partitions, so keep file
+ * output (NetAnim, traces) off.
+ *
+ * The main partition runs what it owns and the barrier, so a scaled-up
+ * dumbbell puts router and receivers there and spreads the senders over
+ * the other partitions; the speed-up is bounded by the main partition's
+ * share of the events.
+ *
+ * Usage:
+ *    ParallelSimulator::Enable(partitions);          // before any Simulator call
+ *    ... build the topology ...
+ *    ParallelSimulator::Assign(NodeContainer(router, server), 0);
+ *    ParallelSimulator::Spread(clients, 1, partitions);
+ *    ParallelSimulator::Install();                   // returns the lookahead
+ *    Simulator::Run();
+ *    std::vector<T> others = ParallelSimulator::Gather(mine);
+ *    if (!ParallelSimulator::IsMain()) { Simulator::Destroy(); return 0; }
+ *    ... merge others, print ...
+ *    ParallelSimulator::Print(std::cout);
+ *    ParallelSimulator::PrintSummary(std::cout);   // SUMMARY scope=parallel ...
+ */
+
+#ifndef PARALLEL_SIMULATOR_H
+#define PARALLEL_SIMULATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/* ---------- SIMULATOR ---------- */
+class PartitionedSimulatorImpl : public SimulatorImpl
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::PartitionedSimulatorImpl")
+                                .SetParent<SimulatorImpl>()
+                                .SetGroupName("Core")
+                                .AddConstructor<PartitionedSimulatorImpl>();
+        return tid;
+    }
+
+    // Set before Run(); nodes not assigned stay in partition 0
+    void SetPartitions(uint32_t n)
+    {
+        m_nPartitions = std::max(n, 1u);
+        m_partitionEvents.assign(m_nPartitions, 0);
+    }
+
+    // Runs every partition in this process, with the same windows and
+    // barriers as the forked run
+    void SetSequential(bool sequential)
+    {
+        m_sequential = sequential;
+    }
+
+    bool IsSequential() const
+    {
+        return m_sequential;
+    }
+
+    void SetOwner(uint32_t node, uint32_t partition)
+    {
+        NS_ABORT_MSG_IF(partition >= m_nPartitions, "Partition " << partition << " out of range");
+        if (node >= m_owner.size())
+        {
+            m_owner.resize(node + 1, 0);
+        }
+        m_owner[node] = partition;
+    }
+
+    uint32_t GetOwner(uint32_t node) const
+    {
+        return node < m_owner.size() ? m_owner[node] : 0;
+    }
+
+    void SetLookahead(Time lookahead)
+    {
+        m_lookahead = lookahead.GetTimeStep();
+    }
+
+    Time GetLookahead() const
+    {
+        return TimeStep(m_lookahead);
+    }
+
+    uint32_t GetNPartitions() const
+    {
+        return m_nPartitions;
+    }
+
+    uint32_t GetRank() const
+    {
+        return m_rank;
+    }
+
+    uint64_t GetNWindows() const
+    {
+        return m_windows;
+    }
+
+    // Events run by each partition, as of the last barrier (main partition only)
+    const std::vector<uint64_t>& GetPartitionEvents() const
+    {
+        return m_partitionEvents;
+    }
+
+    // Events of context-free code run in every partition
+    bool IsLocal(uint32_t context) const
+    {
+        return context == Simulator::NO_CONTEXT || m_sequential || GetOwner(context) == m_rank;
+    }
+
+    // Queues p from src for reception by dst at rxTime in dst's partition
+    void SendRemote(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src,
+                    Ptr<PointToPointNetDevice> dst, Time rxTime)
+    {
+        RemotePacket h;
+        h.node = dst->GetNode()->GetId();
+        h.partition = GetOwner(h.node);
+        h.device = dst->GetIfIndex();
+        h.size = p->GetSerializedSize();
+        h.src = src->GetNode()->GetId();
+        if (h.src >= m_sent.size())
+        {
+            m_sent.resize(h.src + 1, 0);
+        }
+        h.seq = m_sent[h.src]++;
+        h.ts = rxTime.GetTimeStep();
+        size_t at = m_outbox.size();
+        m_outbox.resize(at + sizeof(h) + h.size);
+        std::memcpy(&m_outbox[at], &h, sizeof(h));
+        p->Serialize(&m_outbox[at + sizeof(h)], h.size);
+    }
+
+    // Collective: every partition calls it once after Run(). The main
+    // partition gets each partition's data indexed by rank and reaps the
+    // other processes; they get an empty vector.
+    std::vector<std::string> Gather(const std::string& data)
+    {
+        if (!m_forked)
+        {
+            return {data};
+        }
+        if (m_rank != 0)
+        {
+            uint64_t size = data.size();
+            WriteAll(m_up, &size, sizeof(size));
+            WriteAll(m_up, data.data(), size);
+            return {};
+        }
+        std::vector<std::string> all(m_nPartitions);
+        all[0] = data;
+        for (uint32_t r = 1; r < m_nPartitions; r++)
+        {
+            uint64_t size = 0;
+            ReadAll(m_peers[r], &size, sizeof(size));
+            all[r].resize(size);
+            ReadAll(m_peers[r], &all[r][0], size);
+        }
+        Reap();
+        return all;
+    }
+
+    /* ---------- SimulatorImpl ---------- */
+    void Destroy() override
+    {
+        while (!m_destroyEvents.empty())
+        {
+            Ptr<EventImpl> ev = m_destroyEvents.front().PeekEventImpl();
+            m_destroyEvents.pop_front();
+            if (!ev->IsCancelled())
+            {
+                ev->Invoke();
+            }
+        }
+    }
+
+    bool IsFinished() const override
+    {
+        return m_events->IsEmpty() || m_stop;
+    }
+
+    void Stop() override
+    {
+        m_stop = true;
+    }
+
+    EventId Stop(const Time& delay) override
+    {
+        return Simulator::Schedule(delay, &Simulator::Stop);
+    }
+
+    EventId Schedule(const Time& delay, EventImpl* event) override
+    {
+        Time tAbsolute = delay + TimeStep(m_currentTs);
+        NS_ASSERT_MSG(tAbsolute >= TimeStep(m_currentTs), "Event scheduled in the past");
+        return Insert(tAbsolute.GetTimeStep(), m_currentContext, event);
+    }
+
+    void ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event) override
+    {
+        if (m_forked && !IsLocal(context))
+        {
+            // The owning partition runs the same code and schedules it itself
+            event->Unref();
+            return;
+        }
+        Insert((delay + TimeStep(m_currentTs)).GetTimeStep(), context, event);
+    }
+
+    EventId ScheduleNow(EventImpl* event) override
+    {
+        return Insert(m_currentTs, m_currentContext, event);
+    }
+
+    EventId ScheduleDestroy(EventImpl* event) override
+    {
+        EventId id(Ptr<EventImpl>(event, false), m_currentTs, 0xffffffff, kDestroyUid);
+        m_destroyEvents.push_back(id);
+        m_uid++;
+        return id;
+    }
+
+    void Remove(const EventId& id) override
+    {
+        if (id.GetUid() == kDestroyUid)
+        {
+            for (auto i = m_destroyEvents.begin(); i != m_destroyEvents.end(); i++)
+            {
+                if (*i == id)
+                {
+                    m_destroyEvents.erase(i);
+                    break;
+                }
+            }
+            return;
+        }
+        if (IsExpired(id))
+        {
+            return;
+        }
+        Scheduler::Event event;
+        event.impl = id.PeekEventImpl();
+        event.key.m_ts = id.GetTs();
+        event.key.m_context = id.GetContext();
+        event.key.m_uid = id.GetUid();
+        m_events->Remove(event);
+        event.impl->Cancel();
+        event.impl->Unref();
+        m_unscheduledEvents--;
+    }
+
+    void Cancel(const EventId& id) override
+    {
+        if (!IsExpired(id))
+        {
+            id.PeekEventImpl()->Cancel();
+        }
+    }
+
+    bool IsExpired(const EventId& id) const override
+    {
+        if (id.GetUid() == kDestroyUid)
+        {
+            if (id.PeekEventImpl() == nullptr || id.PeekEventImpl()->IsCancelled())
+            {
+                return true;
+            }
+            for (const EventId& d : m_destroyEvents)
+            {
+                if (d == id)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return id.PeekEventImpl() == nullptr || id.GetTs() < m_currentTs ||
+               (id.GetTs() == m_currentTs && id.GetUid() <= m_currentUid) ||
+               id.PeekEventImpl()->IsCancelled();
+    }
+
+    void Run() override
+    {
+        m_stop = false;
+        if (m_nPartitions > 1 && !m_forked && !m_sequential)
+        {
+            Fork();
+        }
+        if (m_nPartitions == 1)
+        {
+            while (!m_events->IsEmpty() && !m_stop)
+            {
+                ProcessOneEvent();
+            }
+            return;
+        }
+        NS_ABORT_MSG_IF(m_lookahead == 0, "No lookahead; call ParallelSimulator::Install()");
+        uint64_t start = 0;
+        while (Synchronize(&start))
+        {
+            // Nothing sent from now on can arrive before start + lookahead
+            uint64_t end = start + m_lookahead;
+            while (!m_events->IsEmpty() && !m_stop && m_events->PeekNext().key.m_ts < end)
+            {
+                ProcessOneEvent();
+            }
+        }
+    }
+
+    Time Now() const override
+    {
+        return TimeStep(m_currentTs);
+    }
+
+    Time GetDelayLeft(const EventId& id) const override
+    {
+        return IsExpired(id) ? TimeStep(0) : TimeStep(id.GetTs() - m_currentTs);
+    }
+
+    Time GetMaximumSimulationTime() const override
+    {
+        return TimeStep(0x7fffffffffffffffLL);
+    }
+
+    void SetScheduler(ObjectFactory schedulerFactory) override
+    {
+        Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler>();
+        if (m_events)
+        {
+            while (!m_events->IsEmpty())
+            {
+                scheduler->Insert(m_events->RemoveNext());
+            }
+        }
+        m_events = scheduler;
+    }
+
+    uint32_t GetSystemId() const override
+    {
+        return m_rank;
+    }
+
+    uint32_t GetContext() const override
+    {
+        return m_currentContext;
+    }
+
+    uint64_t GetEventCount() const override
+    {
+        return m_eventCount;
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        while (!m_events->IsEmpty())
+        {
+            m_events->RemoveNext().impl->Unref();
+        }
+        m_events = nullptr;
+        Reap();
+        SimulatorImpl::DoDispose();
+    }
+
+  private:
+    // Uids 0-3 are reserved by EventId; 2 marks destroy events
+    static const uint32_t kDestroyUid = 2;
+    static const uint64_t kNever = ~uint64_t(0);
+
+    // One packet in an outbox, followed by its size serialized bytes
+    struct RemotePacket
+    {
+        uint32_t partition;
+        uint32_t node;
+        uint32_t device;
+        uint32_t size;
+        uint32_t src; // sending node
+        uint64_t ts;
+        uint64_t seq; // per sending node
+    };
+
+    // Partition to main partition at a barrier, followed by the outbox
+    struct WindowReport
+    {
+        uint64_t next;
+        uint64_t events;
+        uint64_t stop;
+        uint64_t bytes;
+    };
+
+    // Main partition to partition, followed by the packets routed to it
+    struct WindowGrant
+    {
+        uint64_t start;
+        uint64_t stop;
+        uint64_t bytes;
+    };
+
+    EventId Insert(uint64_t ts, uint32_t context, EventImpl* event)
+    {
+        Scheduler::Event ev;
+        ev.impl = event;
+        ev.key.m_ts = ts;
+        ev.key.m_context = context;
+        ev.key.m_uid = m_uid++;
+        m_unscheduledEvents++;
+        m_events->Insert(ev);
+        return EventId(event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+    }
+
+    void ProcessOneEvent()
+    {
+        Scheduler::Event next = m_events->RemoveNext();
+        NS_ASSERT(next.key.m_ts >= m_currentTs);
+        m_unscheduledEvents--;
+        m_eventCount++;
+        m_currentTs = next.key.m_ts;
+        m_currentContext = next.key.m_context;
+        m_currentUid = next.key.m_uid;
+        next.impl->Invoke();
+        next.impl->Unref();
+    }
+
+    uint64_t NextTs() const
+    {
+        return m_events->IsEmpty() ? kNever : m_events->PeekNext().key.m_ts;
+    }
+
+    // Forks partitions 1..n-1 and drops every queued event of other partitions
+    void Fork()
+    {
+        // Unflushed output would be written once per partition
+        std::fflush(nullptr);
+        m_peers.assign(m_nPartitions, -1);
+        for (uint32_t r = 1; r < m_nPartitions; r++)
+        {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            {
+                std::perror("socketpair");
+                std::exit(1);
+            }
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                close(fds[0]);
+                for (uint32_t p = 1; p < r; p++)
+                {
+                    close(m_peers[p]);
+                }
+                m_peers.clear();
+                m_pids.clear();
+                m_up = fds[1];
+                m_rank = r;
+                break;
+            }
+            close(fds[1]);
+            m_peers[r] = fds[0];
+            m_pids.push_back(pid);
+        }
+        m_forked = true;
+
+        std::vector<Scheduler::Event> events;
+        while (!m_events->IsEmpty())
+        {
+            events.push_back(m_events->RemoveNext());
+        }
+        for (const Scheduler::Event& ev : events)
+        {
+            if (IsLocal(ev.key.m_context))
+            {
+                m_events->Insert(ev);
+                continue;
+            }
+            ev.impl->Cancel();
+            ev.impl->Unref();
+            m_unscheduledEvents--;
+        }
+    }
+
+    // Barrier: exchanges outboxes and agrees on the next window. Returns
+    // false once any partition stopped or no events are left anywhere.
+    bool Synchronize(uint64_t* start)
+    {
+        if (m_rank != 0)
+        {
+            WindowReport report{NextTs(), m_eventCount, m_stop, m_outbox.size()};
+            WriteAll(m_up, &report, sizeof(report));
+            WriteAll(m_up, m_outbox.data(), m_outbox.size());
+            m_outbox.clear();
+
+            WindowGrant grant;
+            ReadAll(m_up, &grant, sizeof(grant));
+            std::vector<uint8_t> inbox(grant.bytes);
+            ReadAll(m_up, inbox.data(), inbox.size());
+            Deliver(inbox);
+            *start = grant.start;
+            return !grant.stop;
+        }
+
+        uint64_t next = NextTs();
+        bool stop = m_stop;
+        std::vector<std::vector<uint8_t>> routed(m_nPartitions);
+        Route(m_outbox, &routed, &next);
+        m_outbox.clear();
+        for (uint32_t r = 1; m_forked && r < m_nPartitions; r++)
+        {
+            WindowReport report;
+            ReadAll(m_peers[r], &report, sizeof(report));
+            std::vector<uint8_t> outbox(report.bytes);
+            ReadAll(m_peers[r], outbox.data(), outbox.size());
+            next = std::min(next, report.next);
+            stop = stop || report.stop;
+            m_partitionEvents[r] = report.events;
+            Route(outbox, &routed, &next);
+        }
+        m_partitionEvents[0] = m_eventCount;
+        m_windows++;
+
+        stop = stop || next == kNever;
+        for (uint32_t r = 1; m_forked && r < m_nPartitions; r++)
+        {
+            WindowGrant grant{next, stop, routed[r].size()};
+            WriteAll(m_peers[r], &grant, sizeof(grant));
+            WriteAll(m_peers[r], routed[r].data(), routed[r].size());
+        }
+        for (uint32_t r = 1; !m_forked && r < m_nPartitions; r++)
+        {
+            // Sequential: this process is every partition
+            routed[0].insert(routed[0].end(), routed[r].begin(), routed[r].end());
+        }
+        Deliver(routed[0]);
+        *start = next;
+        return !stop;
+    }
+
+    // Sorts an outbox by destination partition; next becomes the earliest arrival
+    static void Route(const std::vector<uint8_t>& outbox, std::vector<std::vector<uint8_t>>* routed,
+                      uint64_t* next)
+    {
+        for (size_t at = 0; at < outbox.size();)
+        {
+            RemotePacket h;
+            std::memcpy(&h, &outbox[at], sizeof(h));
+            size_t len = sizeof(h) + h.size;
+            std::vector<uint8_t>& to = (*routed)[h.partition];
+            to.insert(to.end(), outbox.begin() + at, outbox.begin() + at + len);
+            *next = std::min(*next, h.ts);
+            at += len;
+        }
+    }
+
+    // Schedules the reception of every packet in an inbox, in (arrival
+    // time, sender, sequence) order whatever order the outboxes came in
+    void Deliver(const std::vector<uint8_t>& inbox)
+    {
+        std::vector<std::pair<RemotePacket, size_t>> packets;
+        for (size_t at = 0; at < inbox.size();)
+        {
+            RemotePacket h;
+            std::memcpy(&h, &inbox[at], sizeof(h));
+            packets.emplace_back(h, at + sizeof(h));
+            at += sizeof(h) + h.size;
+        }
+        std::sort(packets.begin(), packets.end(), [](const auto& a, const auto& b) {
+            return std::tie(a.first.ts, a.first.src, a.first.seq) <
+                   std::tie(b.first.ts, b.first.src, b.first.seq);
+        });
+        for (const auto& packet : packets)
+        {
+            const RemotePacket& h = packet.first;
+            Ptr<Packet> p = Create<Packet>(&inbox[packet.second], h.size, true);
+            Ptr<PointToPointNetDevice> dev =
+                DynamicCast<PointToPointNetDevice>(NodeList::GetNode(h.node)->GetDevice(h.device));
+            NS_ASSERT(dev && h.ts >= m_currentTs);
+            Insert(h.ts, h.node, MakeEvent(&PointToPointNetDevice::Receive, dev, p));
+        }
+    }
+
+    static void WriteAll(int fd, const void* data, size_t n)
+    {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0)
+        {
+            ssize_t w = write(fd, p, n);
+            NS_ABORT_MSG_IF(w <= 0, "Partition link write failed");
+            p += w;
+            n -= w;
+        }
+    }
+
+    static void ReadAll(int fd, void* data, size_t n)
+    {
+        char* p = static_cast<char*>(data);
+        while (n > 0)
+        {
+            ssize_t r = read(fd, p, n);
+            NS_ABORT_MSG_IF(r <= 0, "Partition link closed; a partition process failed");
+            p += r;
+            n -= r;
+        }
+    }
+
+    // Closes the links and waits for the other partitions to exit
+    void Reap()
+    {
+        for (int fd : m_peers)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        m_peers.clear();
+        for (pid_t pid : m_pids)
+        {
+            waitpid(pid, nullptr, 0);
+        }
+        m_pids.clear();
+        if (m_up >= 0)
+        {
+            close(m_up);
+            m_up = -1;
+        }
+    }
+
+    Ptr<Scheduler> m_events;
+    std::list<EventId> m_destroyEvents;
+    bool m_stop = false;
+    uint32_t m_uid = 4;
+    uint32_t m_currentUid = 0;
+    uint64_t m_currentTs = 0;
+    uint32_t m_currentContext = Simulator::NO_CONTEXT;
+    int m_unscheduledEvents = 0;
+    uint64_t m_eventCount = 0;
+
+    uint32_t m_nPartitions = 1;
+    uint32_t m_rank = 0;
+    bool m_forked = false;
+    bool m_sequential = false;
+    std::vector<uint64_t> m_sent;  // cross-partition packets by sending node
+    std::vector<uint32_t> m_owner; // partition by node id
+    uint64_t m_lookahead = 0;      // time steps
+    std::vector<uint8_t> m_outbox;
+    std::vector<int> m_peers;      // main partition: socket per rank
+    std::vector<pid_t> m_pids;
+    int m_up = -1;                 // other partitions: socket to the main one
+    uint64_t m_windows = 0;
+    std::vector<uint64_t> m_partitionEvents = {0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PartitionedSimulatorImpl);
+
+/* ---------- CROSS-PARTITION LINK ---------- */
+class PartitionChannel : public PointToPointChannel
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::PartitionChannel")
+                                .SetParent<PointToPointChannel>()
+                                .SetGroupName("PointToPoint")
+                                .AddConstructor<PartitionChannel>();
+        return tid;
+    }
+
+    bool TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevice> src, Time txTime) override
+    {
+        Ptr<PointToPointNetDevice> dst =
+            GetPointToPointDevice(src == GetPointToPointDevice(0) ? 1 : 0);
+        Ptr<PartitionedSimulatorImpl> impl =
+            DynamicCast<PartitionedSimulatorImpl>(Simulator::GetImplementation());
+        // Through the outbox even when dst is local (sequential run), so the
+        // arrival is scheduled at the same barrier either way
+        impl->SendRemote(p, src, dst, Simulator::Now() + txTime + GetDelay());
+        return true;
+    }
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PartitionChannel);
+
+/* ---------- SCENARIO INTERFACE ---------- */
+class ParallelSimulator
+{
+  public:
+    // Selects the partitioned simulator; must come before any other
+    // Simulator call, i.e. right after cmd.Parse. A sequential run keeps
+    // the layout but does not fork.
+    static void Enable(uint32_t partitions, bool sequential = false)
+    {
+        GlobalValue::Bind("SimulatorImplementationType",
+                          StringValue("ns3::PartitionedSimulatorImpl"));
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        NS_ABORT_MSG_UNLESS(impl, "ParallelSimulator::Enable() after the simulator was created");
+        impl->SetPartitions(partitions);
+        impl->SetSequential(sequential);
+    }
+
+    // Null unless Enable() was called
+    static Ptr<PartitionedSimulatorImpl> GetImpl()
+    {
+        return DynamicCast<PartitionedSimulatorImpl>(Simulator::GetImplementation());
+    }
+
+    static void Assign(Ptr<Node> node, uint32_t partition)
+    {
+        GetImpl()->SetOwner(node->GetId(), partition);
+    }
+
+    static void Assign(NodeContainer nodes, uint32_t partition)
+    {
+        for (uint32_t i = 0; i < nodes.GetN(); i++)
+        {
+            Assign(nodes.Get(i), partition);
+        }
+    }
+
+    // Contiguous, equally sized blocks of nodes over partitions [first, last)
+    static void Spread(NodeContainer nodes, uint32_t first, uint32_t last)
+    {
+        uint32_t n = std::max(last, first + 1) - first;
+        for (uint32_t i = 0; i < nodes.GetN(); i++)
+        {
+            Assign(nodes.Get(i), first + uint64_t(i) * n / nodes.GetN());
+        }
+    }
+
+    // Swaps links between partitions for PartitionChannels and sets the
+    // lookahead to their smallest delay. Call after the topology is built.
+    static Time Install()
+    {
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        Time lookahead = Time::Max();
+        for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+        {
+            Ptr<Node> node = NodeList::GetNode(n);
+            for (uint32_t d = 0; d < node->GetNDevices(); d++)
+            {
+                Ptr<Channel> channel = node->GetDevice(d)->GetChannel();
+                if (!channel || !CrossesPartitions(impl, channel))
+                {
+                    continue;
+                }
+                Ptr<PointToPointChannel> p2p = DynamicCast<PointToPointChannel>(channel);
+                NS_ABORT_MSG_UNLESS(p2p, "Only point-to-point links may join partitions");
+                if (!DynamicCast<PartitionChannel>(p2p))
+                {
+                    p2p = Replace(p2p);
+                }
+                TimeValue delay;
+                p2p->GetAttribute("Delay", delay);
+                lookahead = std::min(lookahead, delay.Get());
+            }
+        }
+        NS_ABORT_MSG_IF(impl->GetNPartitions() > 1 && !lookahead.IsStrictlyPositive(),
+                        "Partitions need a cross-partition link with a positive delay");
+        impl->SetLookahead(lookahead);
+        return lookahead;
+    }
+
+    static uint32_t GetRank()
+    {
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        return impl ? impl->GetRank() : 0;
+    }
+
+    static bool IsMain()
+    {
+        return GetRank() == 0;
+    }
+
+    // Collective, after Run(): the main partition gets the items of all
+    // other partitions, in rank order; the others get nothing
+    template <typename T>
+    static std::vector<T> Gather(const std::vector<T>& items)
+    {
+        std::vector<T> all;
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        if (!impl)
+        {
+            return all;
+        }
+        std::string data(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+        std::vector<std::string> parts = impl->Gather(data);
+        for (size_t r = 1; r < parts.size(); r++)
+        {
+            size_t at = all.size();
+            all.resize(at + parts[r].size() / sizeof(T));
+            std::memcpy(all.data() + at, parts[r].data(), parts[r].size());
+        }
+        return all;
+    }
+
+    // Collective, after Run(): free-form data, e.g. serialized statistics;
+    // the main partition gets that of all other partitions, in rank order
+    static std::vector<std::string> Gather(const std::string& data)
+    {
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        if (!impl)
+        {
+            return {};
+        }
+        std::vector<std::string> parts = impl->Gather(data);
+        if (!parts.empty())
+        {
+            parts.erase(parts.begin());
+        }
+        return parts;
+    }
+
+    static void Print(std::ostream& os)
+    {
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        if (!impl)
+        {
+            return;
+        }
+        os << "Parallel: " << impl->GetNPartitions()
+           << (impl->IsSequential() ? " partitions in one process" : " partitions") << ", lookahead "
+           << impl->GetLookahead().GetSeconds() * 1e3 << " ms, " << impl->GetNWindows()
+           << " windows; events per partition:";
+        for (uint64_t e : impl->GetPartitionEvents())
+        {
+            os << " " << e;
+        }
+        os << "\n";
+    }
+
+    // events is the total over all partitions; balance is max over mean
+    static void PrintSummary(std::ostream& os)
+    {
+        Ptr<PartitionedSimulatorImpl> impl = GetImpl();
+        if (!impl)
+        {
+            return;
+        }
+        const std::vector<uint64_t>& events = impl->GetPartitionEvents();
+        uint64_t total = 0;
+        uint64_t most = 0;
+        for (uint64_t e : events)
+        {
+            total += e;
+            most = std::max(most, e);
+        }
+        os << "SUMMARY scope=parallel partitions=" << impl->GetNPartitions()
+           << " lookahead=" << impl->GetLookahead().GetSeconds()
+           << " windows=" << impl->GetNWindows()
+           << " events=" << total
+           << " balance=" << (total > 0 ? double(most) * events.size() / total : 0) << "\n";
+    }
+
+  private:
+    static bool CrossesPartitions(Ptr<PartitionedSimulatorImpl> impl, Ptr<Channel> channel)
+    {
+        uint32_t first = impl->GetOwner(channel->GetDevice(0)->GetNode()->GetId());
+        for (std::size_t i = 1; i < channel->GetNDevices(); i++)
+        {
+            if (impl->GetOwner(channel->GetDevice(i)->GetNode()->GetId()) != first)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static Ptr<PointToPointChannel> Replace(Ptr<PointToPointChannel> old)
+    {
+        TimeValue delay;
+        old->GetAttribute("Delay", delay);
+        Ptr<PartitionChannel> channel = CreateObject<PartitionChannel>();
+        channel->SetAttribute("Delay", delay);
+        old->GetPointToPointDevice(0)->Attach(channel);
+        old->GetPointToPointDevice(1)->Attach(channel);
+        return channel;
+    }
+};
+
+} // namespace ns3
+
+#endif /* PARALLEL_SIMULATOR_H */
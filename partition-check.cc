@@ -0,0 +1,150 @@
+/*
+ * Equivalence check of a partitioned run against its sequential reference.
+ *
+ * The scenario runs with --partitions=N and --flowMonitor=light, and once
+ * more as the reference:
+ *
+ *    sequential   --partitions=N --sequential=1: the same layout, windows
+ *                 and barriers in one process, so the results must match
+ *                 exactly
+ *    plain        no partitions at all; same-time ties between a packet
+ *                 arrival and a local event may be ordered differently, so
+ *                 small differences are expected
+ *
+ * Flows are matched by 5-tuple (src, srcPort, dst, dstPort, protocol), as
+ * FlowIds are handed out in a different order, and every other field of
+ * their SUMMARY scope=flow lines must be equal. The exit status is 1 if a
+ * run fails, a flow is missing on either side or any field differs.
+ *
+ * Usage:
+ *    ./ns3 build tcpvsudp partition-check
+ *    ./ns3 run "partition-check --binary=build/scratch/ns3-dev-tcpvsudp-default
+ *               --partitions=3 --args='--nTcp=4 --nUdp=2'"
+ */
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <iostream>
+#include <map>
+
+using namespace ns3;
+using namespace std;
+
+// SUMMARY scope=flow lines by 5-tuple, FlowId left out
+static map<string, SummaryLine>
+FlowsByTuple(const string &output)
+{
+    map<string, SummaryLine> flows;
+    for (SummaryLine &l : ParseSummary(output))
+    {
+        if (l["scope"] != "flow")
+        {
+            continue;
+        }
+        string tuple = l["src"] + ":" + l["srcPort"] + " -> " + l["dst"] + ":" + l["dstPort"] +
+                       " proto " + l["protocol"];
+        l.erase("flow");
+        flows[tuple] = l;
+    }
+    return flows;
+}
+
+int main(int argc, char *argv[])
+{
+    string binary = "";
+    string args = "";
+    uint32_t partitions = 2;
+    string reference = "sequential";
+
+    CommandLine cmd;
+    cmd.AddValue("binary", "Path to the built scenario (tcpvsudp)", binary);
+    cmd.AddValue("args", "Space-separated extra arguments for both runs", args);
+    cmd.AddValue("partitions", "Partitions of the run under test", partitions);
+    cmd.AddValue("reference", "Reference run: sequential (same layout, one process) or plain", reference);
+    cmd.Parse(argc, argv);
+
+    if (binary.empty())
+    {
+        cerr << "--binary=<path to the scenario> is required" << endl;
+        return 1;
+    }
+    NS_ABORT_MSG_IF(partitions < 2, "--partitions must be at least 2");
+    NS_ABORT_MSG_IF(reference != "sequential" && reference != "plain",
+                    "Unknown reference " << reference);
+
+    /* ---------- RUN ---------- */
+    vector<string> base = {binary, "--flowMonitor=light", "--summary=1"};
+    vector<string> extra = SplitList(args, ' ');
+    base.insert(base.end(), extra.begin(), extra.end());
+
+    vector<string> parallel = base;
+    parallel.push_back("--partitions=" + to_string(partitions));
+    vector<string> sequential = base;
+    if (reference == "sequential")
+    {
+        sequential.push_back("--partitions=" + to_string(partitions));
+        sequential.push_back("--sequential=1");
+    }
+
+    ProcessPool pool(2);
+    pool.Submit(parallel);
+    pool.Submit(sequential);
+    vector<ProcessResult> results(2);
+    pool.Wait([&results](size_t index, const ProcessResult &result) { results[index] = result; });
+
+    /* ---------- COMPARE ---------- */
+    const char *names[] = {"partitioned", reference.c_str()};
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].status != 0)
+        {
+            cout << "The " << names[i] << " run failed (exit " << results[i].status << ")\n";
+            return 1;
+        }
+    }
+    map<string, SummaryLine> tested = FlowsByTuple(results[0].output);
+    map<string, SummaryLine> expected = FlowsByTuple(results[1].output);
+    if (expected.empty())
+    {
+        cout << "No SUMMARY scope=flow lines in the " << reference << " run\n";
+        return 1;
+    }
+
+    uint32_t differences = 0;
+    for (const auto &flow : expected)
+    {
+        auto it = tested.find(flow.first);
+        if (it == tested.end())
+        {
+            cout << flow.first << ": missing in the partitioned run\n";
+            differences++;
+            continue;
+        }
+        for (const auto &field : flow.second)
+        {
+            auto value = it->second.find(field.first);
+            string got = value != it->second.end() ? value->second : "<none>";
+            if (got != field.second)
+            {
+                cout << flow.first << ": " << field.first << " " << got << " (" << reference
+                     << ": " << field.second << ")\n";
+                differences++;
+            }
+        }
+    }
+    for (const auto &flow : tested)
+    {
+        if (!expected.count(flow.first))
+        {
+            cout << flow.first << ": missing in the " << reference << " run\n";
+            differences++;
+        }
+    }
+
+    cout << expected.size() << " flows, " << partitions << " partitions against " << reference
+         << ": " << (differences ? to_string(differences) + " difference(s)" : "identical")
+         << "\n";
+    return differences ? 1 : 0;
+}
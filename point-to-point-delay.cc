@@ -4,6 +4,9 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 
+#include "result-cache.h"
+#include "run-stats.h"
+
 //Logging
 using namespace ns3;
 using namespace std;
@@ -16,14 +19,30 @@ int main(int argc,char *argv[])
     string delay="10ms";
     uint32_t packetSize=1024;
     uint32_t numPackets=1;
+    double interval=1.0;
+    bool pcap=true;
+    bool summary=false;
+    string resultCache="";
 
     CommandLine cmd;
     cmd.AddValue("dataRate", "Data rate of the link", dataRate);    
     cmd.AddValue("delay", "Propagation delay", delay);
     cmd.AddValue("packetSize", "Packet size in bytes", packetSize);
     cmd.AddValue("numPackets", "Number of packets", numPackets);
+    cmd.AddValue("interval", "Echo request interval (s)", interval);
+    cmd.AddValue("pcap", "Write scratch/point-to-point pcap traces", pcap);
+    cmd.AddValue("summary", "Print a machine-readable SUMMARY line with event throughput", summary);
+    cmd.AddValue("resultCache", "Directory of cached results; a known configuration is not re-run (empty = off)", resultCache);
     cmd.Parse(argc, argv);
 
+    // The pcap files are this scenario's results; only a real run writes them
+    ResultCache cache(resultCache);
+    cache.SetFileOutput(pcap);
+    if(cache.Replay(argc, argv))
+    {
+        return 0;
+    }
+
 
     //Node creation
     NS_LOG_INFO("Creating two nodes");
@@ -59,7 +78,7 @@ int main(int argc,char *argv[])
     //NODE 0
     UdpEchoClientHelper echoClient(interfaces.GetAddress(1),port);
     echoClient.SetAttribute("MaxPackets",UintegerValue(numPackets));
-    echoClient.SetAttribute("Interval",TimeValue(Seconds(1.0)));
+    echoClient.SetAttribute("Interval",TimeValue(Seconds(interval)));
     echoClient.SetAttribute("PacketSize",UintegerValue(packetSize));
 
     ApplicationContainer clientApps=echoClient.Install(nodes.Get(0));
@@ -67,13 +86,24 @@ int main(int argc,char *argv[])
     clientApps.Stop(Seconds(5.0));
 
     //pcap
-    NS_LOG_INFO("enabling pcap");
-    pointToPoint.EnablePcap("scratch/point-to-point",devices.Get(0),true);
+    if(pcap)
+    {
+        NS_LOG_INFO("enabling pcap");
+        pointToPoint.EnablePcap("scratch/point-to-point",devices.Get(0),true);
+    }
 
     //simulator
     NS_LOG_INFO("Running simulation");
     Simulator::Stop(Seconds(5.0));
+    RunStats runStats;
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+    if(summary)
+    {
+        runStats.PrintSummary(cout);
+    }
+    cache.Store();
     Simulator::Destroy();
 
     NS_LOG_INFO("SIMULATOR ENDED");
@@ -0,0 +1,336 @@
+/*
+ * Bounded pool of child processes for running isolated simulations.
+ *
+ * ns-3 keeps one global simulator per process, so every sweep point runs as
+ * its own scenario process. At most `workers` children run at once; the
+ * stdout of each child is captured and handed back on completion together
+ * with its wall time and peak RSS.
+ *
+ * Fork() runs jobs without exec: each child returns from Fork() with a
+ * copy of the caller's state, so one process can branch into variants that
+ * share everything computed so far.
+ *
+ * Scenarios report results as lines of the form
+ *    SUMMARY key=value key=value ...
+ * which ParseSummary() turns into key/value maps.
+ */
+
+#ifndef PROCESS_POOL_H
+#define PROCESS_POOL_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+struct ProcessResult
+{
+    int status = -1;          // exit code, or -1 if the child did not exit normally
+    std::string output;       // captured stdout
+    double wallSeconds = 0;
+    long maxRssKb = 0;        // peak resident set size of the child
+};
+
+class ProcessPool
+{
+  public:
+    typedef std::function<void(size_t, const ProcessResult&)> DoneCallback;
+
+    // workers == 0 uses one worker per hardware thread
+    explicit ProcessPool(unsigned workers = 0)
+        : m_workers(workers ? workers : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    unsigned GetWorkers() const
+    {
+        return m_workers;
+    }
+
+    // Queues argv for execution and returns the job index
+    size_t Submit(const std::vector<std::string>& argv)
+    {
+        m_pending.push_back(Job{m_nextIndex, argv});
+        return m_nextIndex++;
+    }
+
+    // Runs until every submitted job has finished. onDone may Submit() more work.
+    void Wait(const DoneCallback& onDone)
+    {
+        while (!m_pending.empty() || !m_running.empty())
+        {
+            while (!m_pending.empty() && m_running.size() < m_workers)
+            {
+                Launch(m_pending.front());
+                m_pending.pop_front();
+            }
+            Poll(onDone);
+        }
+    }
+
+    // Forks n children that continue from the call. In child i this returns
+    // i with stdout captured by the parent; the parent returns -1 once all
+    // of them have finished, each reported through onDone as job index i.
+    long Fork(size_t n, const DoneCallback& onDone)
+    {
+        // Unflushed output would be written once per child
+        std::fflush(nullptr);
+        for (size_t i = 0; i < n; i++)
+        {
+            while (m_running.size() >= m_workers)
+            {
+                Poll(onDone);
+            }
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                std::perror("pipe");
+                std::exit(1);
+            }
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                std::perror("fork");
+                close(fds[0]);
+                close(fds[1]);
+                std::exit(1);
+            }
+            if (pid == 0)
+            {
+                close(fds[0]);
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[1]);
+                for (const Running& r : m_running)
+                {
+                    close(r.fd);
+                }
+                m_running.clear();
+                return long(i);
+            }
+            close(fds[1]);
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+            Running r;
+            r.index = i;
+            r.pid = pid;
+            r.fd = fds[0];
+            r.start = std::chrono::steady_clock::now();
+            m_running.push_back(r);
+        }
+        while (!m_running.empty())
+        {
+            Poll(onDone);
+        }
+        return -1;
+    }
+
+  private:
+    struct Job
+    {
+        size_t index;
+        std::vector<std::string> argv;
+    };
+
+    struct Running
+    {
+        size_t index;
+        pid_t pid;
+        int fd;
+        std::string output;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void Launch(const Job& job)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            std::perror("pipe");
+            std::exit(1);
+        }
+
+        std::vector<char*> args;
+        for (const std::string& a : job.argv)
+        {
+            args.push_back(const_cast<char*>(a.c_str()));
+        }
+        args.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            // Without a pid, wait4 could not tell this job's result from another's
+            std::perror("fork");
+            close(fds[0]);
+            close(fds[1]);
+            std::exit(1);
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            dup2(fds[1], STDOUT_FILENO);
+            close(fds[1]);
+            execv(args[0], args.data());
+            std::perror(args[0]);
+            _exit(127);
+        }
+        close(fds[1]);
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+        Running r;
+        r.index = job.index;
+        r.pid = pid;
+        r.fd = fds[0];
+        r.start = std::chrono::steady_clock::now();
+        m_running.push_back(r);
+    }
+
+    void Poll(const DoneCallback& onDone)
+    {
+        std::vector<pollfd> fds(m_running.size());
+        for (size_t i = 0; i < m_running.size(); i++)
+        {
+            fds[i].fd = m_running[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            return;
+        }
+
+        char buf[65536];
+        for (size_t i = fds.size(); i-- > 0;)
+        {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+            Running& r = m_running[i];
+            ssize_t n = read(r.fd, buf, sizeof(buf));
+            if (n > 0)
+            {
+                r.output.append(buf, n);
+                continue;
+            }
+            // Interrupted by a signal: not the end, poll again. Only 0 is
+            // EOF; other errors end the output too, as it can no longer be read.
+            if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            {
+                continue;
+            }
+
+            close(r.fd);
+            int status = 0;
+            rusage usage;
+            std::memset(&usage, 0, sizeof(usage));
+            while (wait4(r.pid, &status, 0, &usage) < 0 && errno == EINTR)
+            {
+            }
+
+            ProcessResult result;
+            result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+            result.output.swap(r.output);
+            result.wallSeconds = std::chrono::duration<double>(
+                                     std::chrono::steady_clock::now() - r.start)
+                                     .count();
+            result.maxRssKb = usage.ru_maxrss;
+            size_t index = r.index;
+            m_running.erase(m_running.begin() + i);
+            if (onDone)
+            {
+                onDone(index, result);
+            }
+        }
+    }
+
+    unsigned m_workers;
+    size_t m_nextIndex = 0;
+    std::deque<Job> m_pending;
+    std::vector<Running> m_running;
+};
+
+typedef std::map<std::string, std::string> SummaryLine;
+
+// Extracts every "SUMMARY key=value ..." line from a scenario's output
+inline std::vector<SummaryLine>
+ParseSummary(const std::string& output)
+{
+    std::vector<SummaryLine> lines;
+    std::istringstream in(output);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 8, "SUMMARY ") != 0)
+        {
+            continue;
+        }
+        SummaryLine fields;
+        std::istringstream words(line.substr(8));
+        std::string word;
+        while (words >> word)
+        {
+            size_t eq = word.find('=');
+            if (eq != std::string::npos)
+            {
+                fields[word.substr(0, eq)] = word.substr(eq + 1);
+            }
+        }
+        lines.push_back(fields);
+    }
+    return lines;
+}
+
+// First summary line whose key matches value, or an empty line
+inline SummaryLine
+FindSummary(const std::vector<SummaryLine>& lines, const std::string& key, const std::string& value)
+{
+    for (const SummaryLine& l : lines)
+    {
+        auto it = l.find(key);
+        if (it != l.end() && it->second == value)
+        {
+            return l;
+        }
+    }
+    return SummaryLine();
+}
+
+// Splits a comma-separated command-line list
+inline std::vector<std::string>
+SplitList(const std::string& list, char sep = ',')
+{
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, sep))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+} // namespace ns3
+
+#endif /* PROCESS_POOL_H */
@@ -0,0 +1,283 @@
+/*
+ * Incremental queue statistics for any number of queue discs.
+ *
+ * QueueSojournMonitor follows each attached disc through its Enqueue,
+ * Dequeue, Requeue and drop traces and keeps, in bounded memory per queue:
+ *
+ *    occupancy   time-weighted mean packets and bytes, maximum packets
+ *    sojourn     dequeue time minus the timestamp QueueDisc::Enqueue puts
+ *                on every item, in a DelaySketch (delay-sketch.h); an item
+ *                the device refused and the disc requeued counts once, at
+ *                its first dequeue
+ *    drops       before enqueue (overflow, early drop) and after dequeue
+ *                (e.g. CoDel), as a fraction of arrivals
+ *    busy        number, mean and longest length of busy periods, and the
+ *                fraction of time the queue was non-empty
+ *
+ * Nothing is written per packet, so every queue in a large topology can be
+ * instrumented. Statistics cover the time from Attach() to the report.
+ *
+ * Usage:
+ *    QueueSojournMonitor queues;
+ *    queues.Attach(qdisc, "bottleneck");   // or queues.InstallAll()
+ *    Simulator::Run();
+ *    queues.Print(std::cout);
+ *    queues.PrintSummary(std::cout);       // SUMMARY scope=queue ...
+ */
+
+#ifndef QUEUE_SOJOURN_H
+#define QUEUE_SOJOURN_H
+
+#include "delay-sketch.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <list>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class QueueSojournMonitor
+{
+  public:
+    struct Stats
+    {
+        std::string name;
+        uint64_t arrivals = 0; // enqueued or dropped before enqueue
+        uint64_t departures = 0;
+        uint64_t dropsBeforeEnqueue = 0;
+        uint64_t dropsAfterDequeue = 0;
+        uint32_t maxPackets = 0;
+        DelaySketch sojourn; // ns
+        uint64_t busyPeriods = 0;
+        Time maxBusy;
+
+        double meanPackets = 0; // filled in by GetStats()
+        double meanBytes = 0;
+        Time busyTime;
+        Time observed;
+
+        double GetDropRate() const
+        {
+            return arrivals > 0 ? double(dropsBeforeEnqueue + dropsAfterDequeue) / arrivals : 0;
+        }
+
+        Time GetMeanBusyPeriod() const
+        {
+            return busyPeriods > 0 ? Seconds(busyTime.GetSeconds() / busyPeriods) : Time();
+        }
+
+        double GetBusyFraction() const
+        {
+            return observed.IsStrictlyPositive() ? busyTime.GetSeconds() / observed.GetSeconds()
+                                                 : 0;
+        }
+    };
+
+    void Attach(Ptr<QueueDisc> qdisc, const std::string& name)
+    {
+        m_queues.emplace_back();
+        Queue* q = &m_queues.back();
+        q->qdisc = qdisc;
+        q->stats.name = name;
+        q->start = Simulator::Now();
+        q->last = q->start;
+        q->packets = qdisc->GetNPackets();
+        q->bytes = qdisc->GetNBytes();
+        q->busySince = q->packets > 0 ? q->start : Seconds(-1);
+        qdisc->TraceConnectWithoutContext("Enqueue", MakeCallback(&Queue::Enqueue, q));
+        qdisc->TraceConnectWithoutContext("Dequeue", MakeCallback(&Queue::Dequeue, q));
+        qdisc->TraceConnectWithoutContext("Requeue", MakeCallback(&Queue::Requeue, q));
+        qdisc->TraceConnectWithoutContext("DropBeforeEnqueue",
+                                          MakeCallback(&Queue::DropBeforeEnqueue, q));
+        qdisc->TraceConnectWithoutContext("DropAfterDequeue",
+                                          MakeCallback(&Queue::DropAfterDequeue, q));
+    }
+
+    // Root queue disc of every device, named node/device
+    void InstallAll()
+    {
+        for (uint32_t n = 0; n < NodeList::GetNNodes(); n++)
+        {
+            Ptr<Node> node = NodeList::GetNode(n);
+            Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+            if (!tc)
+            {
+                continue;
+            }
+            for (uint32_t d = 0; d < node->GetNDevices(); d++)
+            {
+                Ptr<QueueDisc> qdisc = tc->GetRootQueueDiscOnDevice(node->GetDevice(d));
+                if (qdisc)
+                {
+                    Attach(qdisc, std::to_string(n) + "/" + std::to_string(d));
+                }
+            }
+        }
+    }
+
+    uint32_t GetNQueues() const
+    {
+        return m_queues.size();
+    }
+
+    // Statistics of every queue up to now, in attach order
+    std::vector<Stats> GetStats() const
+    {
+        std::vector<Stats> all;
+        Time now = Simulator::Now();
+        for (const Queue& q : m_queues)
+        {
+            Stats s = q.stats;
+            double span = (now - q.last).GetSeconds();
+            s.observed = now - q.start;
+            s.busyTime = q.busyTime;
+            if (!q.busySince.IsNegative())
+            {
+                s.busyTime += now - q.busySince;
+            }
+            if (s.observed.IsStrictlyPositive())
+            {
+                s.meanPackets = (q.packetSeconds + q.packets * span) / s.observed.GetSeconds();
+                s.meanBytes = (q.byteSeconds + q.bytes * span) / s.observed.GetSeconds();
+            }
+            all.push_back(s);
+        }
+        return all;
+    }
+
+    void Print(std::ostream& os) const
+    {
+        for (const Stats& s : GetStats())
+        {
+            os << std::fixed << std::setprecision(3)
+               << "Queue " << s.name << ": mean " << s.meanPackets << " packets ("
+               << s.meanBytes << " bytes), max " << s.maxPackets << "\n"
+               << "  Sojourn mean/p50/p99: " << s.sojourn.GetMean() / 1e6 << " / "
+               << s.sojourn.Quantile(0.5) / 1e6 << " / " << s.sojourn.Quantile(0.99) / 1e6
+               << " ms over " << s.departures << " packets\n"
+               << "  Drops: " << s.dropsBeforeEnqueue + s.dropsAfterDequeue << " of "
+               << s.arrivals << " arrivals (" << 100 * s.GetDropRate() << "%)\n"
+               << "  Busy: " << 100 * s.GetBusyFraction() << "% of the time, "
+               << s.busyPeriods << " periods, mean "
+               << s.GetMeanBusyPeriod().GetSeconds() * 1e3 << " ms, max "
+               << s.maxBusy.GetSeconds() * 1e3 << " ms\n"
+               << std::defaultfloat;
+        }
+    }
+
+    void PrintSummary(std::ostream& os) const
+    {
+        for (const Stats& s : GetStats())
+        {
+            os << "SUMMARY scope=queue queue=" << s.name
+               << " arrivals=" << s.arrivals
+               << " departures=" << s.departures
+               << " drops=" << s.dropsBeforeEnqueue + s.dropsAfterDequeue
+               << " dropRate=" << s.GetDropRate()
+               << " meanPackets=" << s.meanPackets
+               << " meanBytes=" << s.meanBytes
+               << " maxPackets=" << s.maxPackets
+               << " meanSojourn=" << s.sojourn.GetMean() / 1e9
+               << " sojournP50=" << s.sojourn.Quantile(0.5) / 1e9
+               << " sojournP99=" << s.sojourn.Quantile(0.99) / 1e9
+               << " busyPeriods=" << s.busyPeriods
+               << " meanBusy=" << s.GetMeanBusyPeriod().GetSeconds()
+               << " maxBusy=" << s.maxBusy.GetSeconds()
+               << " busyFraction=" << s.GetBusyFraction() << "\n";
+        }
+    }
+
+  private:
+    struct Queue
+    {
+        Ptr<QueueDisc> qdisc;
+        Stats stats;
+        Time start;
+        Time last;            // of the last occupancy change
+        uint32_t packets = 0; // occupancy since last
+        uint32_t bytes = 0;
+        double packetSeconds = 0;
+        double byteSeconds = 0;
+        Time busySince;       // negative while idle
+        Time busyTime;        // of the finished busy periods
+        std::set<const QueueDiscItem*> requeued; // held by the disc until dequeued again
+
+        // The traces fire after the disc has changed, so the old occupancy
+        // is integrated up to now and the new one read back
+        void Update()
+        {
+            Time now = Simulator::Now();
+            double span = (now - last).GetSeconds();
+            packetSeconds += packets * span;
+            byteSeconds += bytes * span;
+            last = now;
+            packets = qdisc->GetNPackets();
+            bytes = qdisc->GetNBytes();
+            stats.maxPackets = std::max(stats.maxPackets, packets);
+
+            if (packets > 0 && busySince.IsNegative())
+            {
+                busySince = now;
+                stats.busyPeriods++;
+            }
+            else if (packets == 0 && !busySince.IsNegative())
+            {
+                Time busy = now - busySince;
+                busyTime += busy;
+                stats.maxBusy = std::max(stats.maxBusy, busy);
+                busySince = Seconds(-1);
+            }
+        }
+
+        void Enqueue(Ptr<const QueueDiscItem> item)
+        {
+            stats.arrivals++;
+            Update();
+        }
+
+        void Dequeue(Ptr<const QueueDiscItem> item)
+        {
+            // A requeued item fires Dequeue again; it departed the first time
+            if (requeued.erase(PeekPointer(item)) == 0)
+            {
+                stats.departures++;
+                stats.sojourn.Add((Simulator::Now() - item->GetTimeStamp()).GetNanoSeconds());
+            }
+            Update();
+        }
+
+        void Requeue(Ptr<const QueueDiscItem> item)
+        {
+            requeued.insert(PeekPointer(item));
+            Update();
+        }
+
+        void DropBeforeEnqueue(Ptr<const QueueDiscItem> item, const char* reason)
+        {
+            stats.arrivals++;
+            stats.dropsBeforeEnqueue++;
+        }
+
+        void DropAfterDequeue(Ptr<const QueueDiscItem> item, const char* reason)
+        {
+            requeued.erase(PeekPointer(item));
+            stats.dropsAfterDequeue++;
+            Update();
+        }
+    };
+
+    std::list<Queue> m_queues;
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_SOJOURN_H */
@@ -0,0 +1,141 @@
+/*
+ * Binary recorder for queue disc Enqueue/Dequeue/Drop traces.
+ *
+ * Usage:
+ *    QueueTraceRecorder recorder;
+ *    recorder.Open("scratch/queue.qtr");
+ *    recorder.Attach(qdisc);
+ *    ...
+ *    Simulator::Run();
+ *    recorder.Close();
+ *
+ * Decode with: ./ns3 run "trace-decode --input=scratch/queue.qtr"
+ */
+
+#ifndef QUEUE_TRACE_RECORDER_H
+#define QUEUE_TRACE_RECORDER_H
+
+#include "record-ring.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <list>
+
+namespace ns3
+{
+
+static const char QUEUE_TRACE_MAGIC[8] = {'Q', 'T', 'R', 'A', 'C', 'E', '0', '1'};
+
+enum QueueTraceEvent : uint8_t
+{
+    QUEUE_ENQUEUE = 0,
+    QUEUE_DEQUEUE = 1,
+    QUEUE_DROP = 2
+};
+
+struct QueueTraceRecord
+{
+    int64_t timeNs;
+    uint32_t packetSize;
+    uint32_t queueLength; // packets in the disc after the event
+    uint32_t flowId;      // QueueDiscItem flow hash
+    uint8_t event;
+    uint8_t queueId;
+    uint8_t pad[2];
+};
+
+static_assert(sizeof(QueueTraceRecord) == 24, "QueueTraceRecord must stay 24 bytes");
+
+inline const char*
+QueueTraceEventName(uint8_t event)
+{
+    switch (event)
+    {
+    case QUEUE_ENQUEUE:
+        return "ENQUEUE";
+    case QUEUE_DEQUEUE:
+        return "DEQUEUE";
+    case QUEUE_DROP:
+        return "DROP";
+    }
+    return "UNKNOWN";
+}
+
+class QueueTraceRecorder
+{
+  public:
+    bool Open(const std::string& path, size_t capacity = 1 << 20)
+    {
+        return m_writer.Open(path, QUEUE_TRACE_MAGIC, capacity);
+    }
+
+    void Close()
+    {
+        m_writer.Close();
+    }
+
+    // Connects Enqueue/Dequeue/Drop of one queue disc; queueId tags its records
+    void Attach(Ptr<QueueDisc> qdisc, uint8_t queueId = 0)
+    {
+        m_queues.push_back({this, qdisc, queueId});
+        Queue* q = &m_queues.back();
+        qdisc->TraceConnectWithoutContext("Enqueue", MakeCallback(&Queue::Enqueue, q));
+        qdisc->TraceConnectWithoutContext("Dequeue", MakeCallback(&Queue::Dequeue, q));
+        qdisc->TraceConnectWithoutContext("Drop", MakeCallback(&Queue::Drop, q));
+    }
+
+    uint64_t GetRecordCount() const
+    {
+        return m_writer.GetRecordCount();
+    }
+
+    uint64_t GetStallCount() const
+    {
+        return m_writer.GetStallCount();
+    }
+
+  private:
+    struct Queue
+    {
+        QueueTraceRecorder* recorder;
+        Ptr<QueueDisc> qdisc;
+        uint8_t id;
+
+        void Enqueue(Ptr<const QueueDiscItem> item)
+        {
+            recorder->Record(*this, QUEUE_ENQUEUE, item);
+        }
+
+        void Dequeue(Ptr<const QueueDiscItem> item)
+        {
+            recorder->Record(*this, QUEUE_DEQUEUE, item);
+        }
+
+        void Drop(Ptr<const QueueDiscItem> item)
+        {
+            recorder->Record(*this, QUEUE_DROP, item);
+        }
+    };
+
+    void Record(const Queue& q, uint8_t event, Ptr<const QueueDiscItem> item)
+    {
+        QueueTraceRecord r;
+        r.timeNs = Simulator::Now().GetNanoSeconds();
+        r.packetSize = item->GetPacket()->GetSize();
+        r.queueLength = q.qdisc->GetNPackets();
+        r.flowId = item->Hash(0);
+        r.event = event;
+        r.queueId = q.id;
+        r.pad[0] = r.pad[1] = 0;
+        m_writer.Write(r);
+    }
+
+    BinaryRecordWriter<QueueTraceRecord> m_writer;
+    std::list<Queue> m_queues; // stable addresses for the bound callbacks
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_TRACE_RECORDER_H */
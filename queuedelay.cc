@@ -8,6 +8,20 @@
 #include "ns3/netanim-module.h"
 #include "ns3/traffic-control-module.h"
 
+#include "anim-recorder.h"
+#include "delay-sketch.h"
+#include "fluid-background.h"
+#include "ladder-scheduler.h"
+#include "lazy-routing.h"
+#include "light-flow-monitor.h"
+#include "packet-pool.h"
+#include "queue-sojourn.h"
+#include "queue-trace-recorder.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "topology-builder.h"
+#include "watchpoint.h"
+
 using namespace ns3;
 using namespace std;
 
@@ -34,12 +48,15 @@ void DequeueTrace(Ptr<const QueueDiscItem> item)
 
 void DropTrace(Ptr<const QueueDiscItem> item)
 {
-    double now = Simulator::Now().GetSeconds();
-
-    cout << now
+    cout << Simulator::Now().GetSeconds()
          << " s [DROP] PacketSize="
          << item->GetPacket()->GetSize()
          << " bytes" << endl;
+}
+
+void FirstDropTrace(Ptr<const QueueDiscItem> item)
+{
+    double now = Simulator::Now().GetSeconds();
 
     if (!firstDropPrinted)
     {
@@ -53,138 +70,341 @@ void DropTrace(Ptr<const QueueDiscItem> item)
 
 int main(int argc, char *argv[])
 {
+    uint32_t nSenders = 2;
+    double simTime = 3.0;
+    string bottleneckRate = "5Mbps";
+    string background = "packet";
+    double probeInterval = 0;
+    bool textTrace = false;
+    string traceFile = "scratch/queuedelay.qtr";
+
+    string routing = "global";
+    bool summary = false;
+    bool packetPool = false;
+    string animMode = "binary";
+    uint32_t animSample = 1;
+    string flowMonitor = "full";
+    uint32_t flowSample = 1;
+    string flowOutput = "";
+    string queueStats = "bottleneck";
+    string watchList = "";
+    string resultCache = "";
+
     CommandLine cmd;
+    cmd.AddValue("nSenders", "Number of UDP clients", nSenders);
+    cmd.AddValue("simTime", "Simulation duration (s); clients send from 1 s to simTime - 1 s", simTime);
+    cmd.AddValue("bottleneckRate", "Router-server data rate", bottleneckRate);
+    cmd.AddValue("background", "Client flows as packet (OnOff) or fluid flows", background);
+    cmd.AddValue("probeInterval", "Send a 64-byte UDP probe from client 0 every n ms (0 = none)", probeInterval);
+    cmd.AddValue("textTrace", "Print every queue event to stdout", textTrace);
+    cmd.AddValue("traceFile", "Binary queue trace (empty to disable)", traceFile);
+    cmd.AddValue("routing", "Routing: global (full SPF at start) or lazy (on demand)", routing);
+    cmd.AddValue("summary", "Print a machine-readable SUMMARY line with event throughput", summary);
+    cmd.AddValue("animMode", "Animation output: xml, binary or none", animMode);
+    cmd.AddValue("animSample", "Record 1 in n packets in binary animation mode", animSample);
+    cmd.AddValue("packetPool", "Serve packet allocations from per-thread free lists", packetPool);
+    cmd.AddValue("flowMonitor", "Flow statistics: full (FlowMonitor) or light (edge probes only)", flowMonitor);
+    cmd.AddValue("flowSample", "Light flow monitor: time 1 in n packets per flow", flowSample);
+    cmd.AddValue("flowOutput", "Light flow monitor: binary result file (empty to disable)", flowOutput);
+    cmd.AddValue("queueStats", "Occupancy and sojourn statistics for the bottleneck, all or no queues", queueStats);
+    cmd.AddValue("watch",
+                 "Watchpoints, ';'-separated predicate[=value][:actions] with predicates firstDrop, queueAbove=n "
+                 "and actions snapshot,quiet,stop",
+                 watchList);
+    cmd.AddValue("resultCache", "Directory of cached results; a known configuration is not re-run (empty = off)", resultCache);
     cmd.Parse(argc, argv);
 
-    /* ---------- 1. NODES ---------- */
-    NodeContainer clients, router, server;
-    clients.Create(2);
-    router.Create(1);
-    server.Create(1);
+    // 0 turns the probe off; anything else below 1 ms is a fraction, not 0
+    NS_ABORT_MSG_IF(probeInterval < 0, "--probeInterval must not be negative");
+
+    // Queue trace, flow file and animation are only written by a real run
+    ResultCache cache(resultCache);
+    cache.SetFileOutput(!traceFile.empty() || !flowOutput.empty() || animMode != "none");
+    if (cache.Replay(argc, argv))
+    {
+        return 0;
+    }
+
+    if (packetPool)
+    {
+        PacketPool::Enable();
+    }
+
+    /* ---------- 1. TOPOLOGY ---------- */
+    // nSenders -- 1000Mbps/2ms -- router -- bottleneckRate/10ms -- server
+    TopologyBuilder builder;
+    LazyGlobalRoutingHelper lazyRouting;
+    if (routing == "lazy")
+    {
+        builder.SetRoutingHelper(lazyRouting.GetListRouting());
+    }
+    Topology topo = builder.Dumbbell(nSenders, 1,
+                                     LinkSpec("1000Mbps", "2ms"),
+                                     LinkSpec(bottleneckRate, "10ms"));
+
+    NodeContainer clients = topo.senders;
+    NodeContainer router = topo.routers;
+    NodeContainer server = topo.receivers;
+    NetDeviceContainer drs = topo.bottleneck;
+    Ipv4InterfaceContainer serverIf = topo.bottleneckIf;
 
     /* ---------- 2. MOBILITY ---------- */
     MobilityHelper mobility;
     mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobility.InstallAll();
 
-    /* ---------- 3. LINKS ---------- */
-    PointToPointHelper access;
-    access.SetDeviceAttribute("DataRate", StringValue("1000Mbps"));
-    access.SetChannelAttribute("Delay", StringValue("2ms"));
-
-    PointToPointHelper bottleneck;
-    bottleneck.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
-    bottleneck.SetChannelAttribute("Delay", StringValue("10ms"));
-
-    NetDeviceContainer d0r = access.Install(clients.Get(0), router.Get(0));
-    NetDeviceContainer d1r = access.Install(clients.Get(1), router.Get(0));
-    NetDeviceContainer drs = bottleneck.Install(router.Get(0), server.Get(0));
+    if (routing == "global")
+    {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
-    /* ---------- 4. INTERNET ---------- */
-    InternetStackHelper stack;
-    stack.InstallAll();
+    /* ---------- 3. TRAFFIC CONTROL ---------- */
+    TrafficControlHelper tch;
 
-    /* ---------- 5. IP ADDRESSING ---------- */
-    Ipv4AddressHelper addr;
+    Ptr<QueueDisc> qdisc;
+    Ptr<FluidQueueDisc> fluid;
+    if (background == "fluid")
+    {
+        // Same 5p FIFO, shared by the fluid flows and the probe packets
+        fluid = FluidQueueDisc::Install(drs.Get(0), QueueSize("5p"));
+        qdisc = fluid;
+    }
+    else
+    {
+        // Remove default FqCoDel
+        tch.Uninstall(drs.Get(0));
 
-    addr.SetBase("10.1.1.0", "255.255.255.0");
-    addr.Assign(d0r);
+        // Install small FIFO queue
+        tch.SetRootQueueDisc(
+            "ns3::PfifoFastQueueDisc",
+            "MaxSize", QueueSizeValue(QueueSize("5p"))
+        );
 
-    addr.SetBase("10.1.2.0", "255.255.255.0");
-    addr.Assign(d1r);
+        qdisc = tch.Install(drs.Get(0)).Get(0);
+    }
 
-    addr.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer serverIf = addr.Assign(drs);
+    // Connect traces
+    qdisc->TraceConnectWithoutContext(
+        "Drop", MakeCallback(&FirstDropTrace));
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    if (textTrace)
+    {
+        qdisc->TraceConnectWithoutContext(
+            "Enqueue", MakeCallback(&EnqueueTrace));
+        qdisc->TraceConnectWithoutContext(
+            "Dequeue", MakeCallback(&DequeueTrace));
+        qdisc->TraceConnectWithoutContext(
+            "Drop", MakeCallback(&DropTrace));
+    }
 
-    /* ---------- 6. TRAFFIC CONTROL ---------- */
-    TrafficControlHelper tch;
+    // Binary per-event trace, drained to disk by a background thread
+    QueueTraceRecorder recorder;
+    if (!traceFile.empty())
+    {
+        bool opened = recorder.Open(traceFile);
+        NS_ABORT_MSG_UNLESS(opened, "Cannot write queue trace " << traceFile);
+        recorder.Attach(qdisc);
+    }
 
-    // Remove default FqCoDel
-    tch.Uninstall(drs.Get(0));
+    // Time in queue and time-weighted occupancy, without per-packet output
+    QueueSojournMonitor queues;
+    if (queueStats == "all")
+    {
+        queues.InstallAll();
+    }
+    else if (queueStats == "bottleneck")
+    {
+        queues.Attach(qdisc, "bottleneck");
+    }
 
-    // Install small FIFO queue
-    tch.SetRootQueueDisc(
-        "ns3::PfifoFastQueueDisc",
-        "MaxSize", QueueSizeValue(QueueSize("5p"))
-    );
+    /* ---------- 4. UDP APPLICATIONS ---------- */
+    // One saturating OnOff flow per client, on ports 5000, 5001, ...
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        if (fluid)
+        {
+            fluid->AddCbrFlow(DataRate("20Mbps"), 1472, Seconds(1.0), Seconds(simTime - 1.0));
+            continue;
+        }
+
+        OnOffHelper onoff("ns3::UdpSocketFactory",
+            InetSocketAddress(serverIf.GetAddress(1), 5000 + i));
+
+        onoff.SetAttribute("DataRate", StringValue("20Mbps"));
+        onoff.SetAttribute("PacketSize", UintegerValue(1472));
+        onoff.SetAttribute("OnTime",
+            StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+        onoff.SetAttribute("OffTime",
+            StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+
+        ApplicationContainer app = onoff.Install(clients.Get(i));
+        app.Start(Seconds(1.0));
+        app.Stop(Seconds(simTime - 1.0));
+    }
 
-    QueueDiscContainer qdiscs = tch.Install(drs.Get(0));
+    // Foreground probe: the packets whose delay and loss we measure
+    uint16_t probePort = 6000;
+    if (probeInterval > 0)
+    {
+        UdpServerHelper probeServer(probePort);
+        ApplicationContainer probeSink = probeServer.Install(server.Get(0));
+        probeSink.Start(Seconds(0.0));
+        probeSink.Stop(Seconds(simTime));
+
+        UdpClientHelper probe(serverIf.GetAddress(1), probePort);
+        probe.SetAttribute("MaxPackets", UintegerValue(0));
+        probe.SetAttribute("Interval", TimeValue(Time::FromDouble(probeInterval, Time::MS)));
+        probe.SetAttribute("PacketSize", UintegerValue(64));
+        ApplicationContainer probeApp = probe.Install(clients.Get(0));
+        probeApp.Start(Seconds(1.0));
+        probeApp.Stop(Seconds(simTime - 1.0));
+    }
 
-    // Connect traces
-    qdiscs.Get(0)->TraceConnectWithoutContext(
-        "Enqueue", MakeCallback(&EnqueueTrace));
-    qdiscs.Get(0)->TraceConnectWithoutContext(
-        "Dequeue", MakeCallback(&DequeueTrace));
-    qdiscs.Get(0)->TraceConnectWithoutContext(
-        "Drop", MakeCallback(&DropTrace));
-
-    /* ---------- 7. UDP APPLICATIONS ---------- */
-    uint16_t port1 = 5000;
-    uint16_t port2 = 5001;
-
-    OnOffHelper onoff1("ns3::UdpSocketFactory",
-        InetSocketAddress(serverIf.GetAddress(1), port1));
-    OnOffHelper onoff2("ns3::UdpSocketFactory",
-        InetSocketAddress(serverIf.GetAddress(1), port2));
-
-    onoff1.SetAttribute("DataRate", StringValue("20Mbps"));
-    onoff1.SetAttribute("PacketSize", UintegerValue(1472));
-    onoff1.SetAttribute("OnTime",
-        StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onoff1.SetAttribute("OffTime",
-        StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-
-    onoff2.SetAttribute("DataRate", StringValue("20Mbps"));
-    onoff2.SetAttribute("PacketSize", UintegerValue(1472));
-    onoff2.SetAttribute("OnTime",
-        StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onoff2.SetAttribute("OffTime",
-        StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-
-    ApplicationContainer app1 = onoff1.Install(clients.Get(0));
-    ApplicationContainer app2 = onoff2.Install(clients.Get(1));
-
-    app1.Start(Seconds(1.0));
-    app2.Start(Seconds(1.0));
-    app1.Stop(Seconds(2.0));
-    app2.Stop(Seconds(2.0));
-
-    /* ---------- 8. FLOW MONITOR ---------- */
+    /* ---------- 5. FLOW MONITOR ---------- */
     FlowMonitorHelper flowmon;
-    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+    Ptr<FlowMonitor> monitor;
+    LightFlowMonitor light;
+    DelaySketchMonitor sketches;
+    bool lightMonitor = flowMonitor == "light";
+    if (lightMonitor)
+    {
+        light.SetSampling(flowSample);
+        light.SetDelayCallback([&sketches](FlowId id, Time delay) {
+            sketches.Add(id, delay.GetNanoSeconds());
+        });
+        light.Install(NodeContainer::GetGlobal());
+    }
+    else
+    {
+        monitor = flowmon.InstallAll();
+        sketches.Install(NodeContainer::GetGlobal(),
+            DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()));
+    }
 
-    /* ---------- 9. NETANIM ---------- */
-    AnimationInterface anim("scratch/queuedelayudp.xml");
+    /* ---------- 6. NETANIM ---------- */
+    AnimRecorder anim("scratch/queuedelayudp", animMode);
+    anim.SetSampling(animSample);
 
-    anim.SetConstantPosition(clients.Get(0), 5, 10);
-    anim.SetConstantPosition(clients.Get(1), 5, 20);
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        anim.SetConstantPosition(clients.Get(i), 5, 10 + 10 * i);
+    }
     anim.SetConstantPosition(router.Get(0), 25, 15);
     anim.SetConstantPosition(server.Get(0), 45, 15);
 
-    /* ---------- 10. RUN ---------- */
-    Simulator::Stop(Seconds(3.0));
+    /* ---------- 7. WATCHPOINTS ---------- */
+    // e.g. --watch="firstDrop:snapshot,stop" ends the run at the first drop
+    Watchpoints watch;
+    watch.SetSnapshot([&](ostream &os) { queues.Print(os); });
+    watch.SetQuiet([&]() {
+        anim.StopRecording();
+        if (monitor)
+        {
+            monitor->StopRightNow();
+        }
+    });
+    for (const Watchpoints::Spec &w : Watchpoints::Parse(watchList))
+    {
+        if (w.predicate == "firstDrop")
+        {
+            watch.OnFirstDrop(qdisc).Then(w.actions);
+        }
+        else if (w.predicate == "queueAbove")
+        {
+            watch.OnQueueAbove(qdisc, uint32_t(w.value)).Then(w.actions);
+        }
+        else
+        {
+            NS_ABORT_MSG("Unknown watchpoint " << w.predicate);
+        }
+    }
+
+    /* ---------- 8. RUN ---------- */
+    Simulator::Stop(Seconds(simTime));
+    RunStats runStats;
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+    recorder.Close();
 
-    /* ---------- 11. FLOW RESULTS ---------- */
-    monitor->CheckForLostPackets();
-    Ptr<Ipv4FlowClassifier> classifier =
-        DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    /* ---------- 9. FLOW RESULTS ---------- */
+    Ptr<Ipv4FlowClassifier> classifier;
+    if (lightMonitor)
+    {
+        light.CheckForLostPackets();
+        if (!flowOutput.empty() && light.SerializeToBinaryFile(flowOutput))
+        {
+            cout << "Flow results: " << light.GetNFlows() << " flows in " << flowOutput << "\n";
+        }
+    }
+    else
+    {
+        monitor->CheckForLostPackets();
+        classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    }
 
-    for (auto &flow : monitor->GetFlowStats())
+    for (auto &flow : lightMonitor ? light.GetFlowStats() : monitor->GetFlowStats())
     {
-        auto t = classifier->FindFlow(flow.first);
+        auto t = lightMonitor ? light.FindFlow(flow.first) : classifier->FindFlow(flow.first);
         cout << "\nFlow " << flow.first
              << " (" << t.sourceAddress
              << " -> " << t.destinationAddress << ")\n";
         cout << "Lost Packets: "
              << flow.second.lostPackets << endl;
+        sketches.Print(flow.first, cout);
+
+        if (summary)
+        {
+            const DelaySketchMonitor::FlowSketches &fs = sketches.Get(flow.first);
+            double duration = flow.second.timeLastRxPacket.GetSeconds()
+                              - flow.second.timeFirstTxPacket.GetSeconds();
+            double meanDelay = flow.second.rxPackets > 0
+                ? flow.second.delaySum.GetSeconds() / flow.second.rxPackets : 0;
+            cout << "SUMMARY scope=flow flow=" << flow.first
+                 << " src=" << t.sourceAddress
+                 << " dst=" << t.destinationAddress
+                 << " dstPort=" << t.destinationPort
+                 << " txPackets=" << flow.second.txPackets
+                 << " rxPackets=" << flow.second.rxPackets
+                 << " lostPackets=" << flow.second.lostPackets
+                 << " meanDelay=" << meanDelay
+                 << " throughputMbps="
+                 << (duration > 0 ? flow.second.rxBytes * 8.0 / duration / 1e6 : 0)
+                 << " delayP50=" << fs.delay.Quantile(0.5) / 1e9
+                 << " delayP99=" << fs.delay.Quantile(0.99) / 1e9 << "\n";
+        }
     }
 
     cout << "\nFIRST PACKET DROP TIME = "
          << firstDropTime << " seconds\n";
 
+    if (recorder.GetRecordCount() > 0)
+    {
+        cout << "Queue trace: " << recorder.GetRecordCount()
+             << " records in " << traceFile << "\n";
+    }
+
+    if (fluid)
+    {
+        fluid->Print(cout);
+    }
+    runStats.Print(cout);
+    queues.Print(cout);
+    watch.Print(cout);
+    PacketPool::Print(cout);
+    if (summary)
+    {
+        runStats.PrintSummary(cout);
+        PacketPool::PrintSummary(cout);
+        queues.PrintSummary(cout);
+        watch.PrintSummary(cout);
+        if (fluid)
+        {
+            fluid->PrintSummary(cout);
+        }
+    }
+    cache.Store();
+
     Simulator::Destroy();
     return 0;
 }
@@ -0,0 +1,250 @@
+/*
+ * Fixed-size binary record ring with a background disk writer.
+ *
+ * The simulation thread pushes plain structs into a preallocated
+ * single-producer / single-consumer ring. A writer thread drains the ring
+ * to disk in large contiguous blocks, so a trace event costs a couple of
+ * stores instead of a formatted write and a flush.
+ *
+ * File layout: RecordFileHeader followed by raw Record structs.
+ */
+
+#ifndef RECORD_RING_H
+#define RECORD_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace ns3
+{
+
+/* ---------- FILE HEADER ---------- */
+struct RecordFileHeader
+{
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t version;
+};
+
+/* ---------- SPSC RING ---------- */
+template <typename Record>
+class RecordRing
+{
+  public:
+    // Capacity is rounded up to a power of two
+    void Init(size_t capacity)
+    {
+        size_t n = 1;
+        while (n < capacity)
+        {
+            n <<= 1;
+        }
+        m_buffer.reset(new Record[n]);
+        m_mask = n - 1;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_cachedTail = 0;
+    }
+
+    bool TryPush(const Record& r)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail > m_mask)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cachedTail > m_mask)
+            {
+                return false;
+            }
+        }
+        m_buffer[head & m_mask] = r;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Contiguous readable span starting at the tail
+    size_t Peek(const Record** first) const
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t n = head - tail;
+        size_t untilWrap = (m_mask + 1) - (tail & m_mask);
+        *first = &m_buffer[tail & m_mask];
+        return n < untilWrap ? n : untilWrap;
+    }
+
+    void Consume(size_t n)
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+  private:
+    std::unique_ptr<Record[]> m_buffer;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+/* ---------- BACKGROUND WRITER ---------- */
+template <typename Record>
+class BinaryRecordWriter
+{
+  public:
+    BinaryRecordWriter() = default;
+    BinaryRecordWriter(const BinaryRecordWriter&) = delete;
+    BinaryRecordWriter& operator=(const BinaryRecordWriter&) = delete;
+
+    ~BinaryRecordWriter()
+    {
+        Close();
+    }
+
+    bool Open(const std::string& path, const char* magic, size_t capacity = 1 << 20)
+    {
+        Close();
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file)
+        {
+            return false;
+        }
+        m_ioBuffer.reset(new char[kIoBufferSize]);
+        std::setvbuf(m_file, m_ioBuffer.get(), _IOFBF, kIoBufferSize);
+
+        RecordFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(header.magic));
+        header.recordSize = sizeof(Record);
+        header.version = 1;
+        std::fwrite(&header, sizeof(header), 1, m_file);
+
+        m_ring.Init(capacity);
+        m_records = 0;
+        m_stalls = 0;
+        m_stop.store(false);
+        m_thread = std::thread(&BinaryRecordWriter::Drain, this);
+        return true;
+    }
+
+    bool IsOpen() const
+    {
+        return m_file != nullptr;
+    }
+
+    // Hot path: never formats, never touches the file
+    void Write(const Record& r)
+    {
+        while (!m_ring.TryPush(r))
+        {
+            ++m_stalls;
+            std::this_thread::yield();
+        }
+        ++m_records;
+    }
+
+    void Close()
+    {
+        if (!m_file)
+        {
+            return;
+        }
+        m_stop.store(true, std::memory_order_release);
+        m_thread.join();
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+
+    uint64_t GetRecordCount() const
+    {
+        return m_records;
+    }
+
+    // Number of times the producer found the ring full
+    uint64_t GetStallCount() const
+    {
+        return m_stalls;
+    }
+
+  private:
+    static const size_t kIoBufferSize = 1 << 20;
+
+    void Drain()
+    {
+        while (true)
+        {
+            bool stopping = m_stop.load(std::memory_order_acquire);
+            const Record* first;
+            size_t n = m_ring.Peek(&first);
+            if (n == 0)
+            {
+                if (stopping)
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                continue;
+            }
+            std::fwrite(first, sizeof(Record), n, m_file);
+            m_ring.Consume(n);
+        }
+        std::fflush(m_file);
+    }
+
+    RecordRing<Record> m_ring;
+    std::FILE* m_file = nullptr;
+    std::unique_ptr<char[]> m_ioBuffer;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    uint64_t m_records = 0;
+    uint64_t m_stalls = 0;
+};
+
+/* ---------- READER ---------- */
+template <typename Record>
+class BinaryRecordReader
+{
+  public:
+    ~BinaryRecordReader()
+    {
+        if (m_file)
+        {
+            std::fclose(m_file);
+        }
+    }
+
+    // Fails on a missing file, wrong magic or mismatched record size
+    bool Open(const std::string& path, const char* magic)
+    {
+        m_file = std::fopen(path.c_str(), "rb");
+        if (!m_file)
+        {
+            return false;
+        }
+        RecordFileHeader header;
+        if (std::fread(&header, sizeof(header), 1, m_file) != 1)
+        {
+            return false;
+        }
+        return std::memcmp(header.magic, magic, sizeof(header.magic)) == 0 &&
+               header.recordSize == sizeof(Record);
+    }
+
+    // Reads up to max records into out, returns the number read
+    size_t Read(Record* out, size_t max)
+    {
+        return std::fread(out, sizeof(Record), max, m_file);
+    }
+
+  private:
+    std::FILE* m_file = nullptr;
+};
+
+} // namespace ns3
+
+#endif /* RECORD_RING_H */
@@ -0,0 +1,454 @@
+/*
+ * Multi-objective search for RED settings of the aqmred scenario.
+ *
+ * The objectives are those of aqmred's SUMMARY scope=total line: mean and
+ * p99 delay of the bulk flows (lower is better) against bottleneck
+ * utilization, the bytes sent on the bottleneck device over link rate times
+ * the measured interval (higher is better). Configurations are compared by Pareto
+ * rank, ties broken by crowding distance (as in NSGA-II), so the search
+ * keeps the whole trade-off curve instead of one weighted optimum.
+ *
+ * Runs are spent by successive halving. A bracket starts --candidates
+ * configurations with short runs of --minTime seconds; after every rung
+ * only the best 1/eta of them (by the ranking above) are run again, eta
+ * times longer, up to --maxTime. Poor regions are thus dropped after a
+ * short run and only promising settings pay for long ones. The first
+ * bracket samples the space uniformly; later brackets sample half their
+ * candidates around the current front by mutation.
+ *
+ * The search space is MinTh, MaxTh and MaxSize (packets, ranges lo:hi),
+ * Gentle and MeanPktSize (lists). MaxTh > MinTh and MaxSize >= MaxTh are
+ * enforced. Every run uses the same --run, so configurations see common
+ * random numbers. The result is the Pareto front of the full-length runs,
+ * and the simulated time spent in units of full-length runs, i.e. what a
+ * grid of that many points would have cost.
+ *
+ * Usage:
+ *    ./ns3 build aqmred red-optimize
+ *    ./ns3 run "red-optimize --binary=build/scratch/ns3-dev-aqmred-default
+ *               --minTh=1:40 --maxTh=5:80 --queueSize=20:200 --gentle=1,0
+ *               --meanPktSize=500,1000,1500 --brackets=3 --output=scratch/red-opt.csv"
+ */
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+
+using namespace ns3;
+using namespace std;
+
+struct RedConfig
+{
+    double minTh = 0;
+    double maxTh = 0;
+    uint32_t queueSize = 0;
+    bool gentle = true;
+    uint32_t meanPktSize = 1500;
+
+    string Name() const
+    {
+        ostringstream os;
+        os << "minTh=" << minTh << ",maxTh=" << maxTh << ",queueSize=" << queueSize
+           << "p,gentle=" << gentle << ",meanPktSize=" << meanPktSize;
+        return os.str();
+    }
+};
+
+struct Evaluation
+{
+    RedConfig config;
+    double simTime = 0;
+    uint32_t bracket = 0;
+    bool ok = false;
+    double meanDelay = 0;
+    double delayP99 = 0;
+    double utilization = 0;
+    double wallSeconds = 0;
+    bool cached = false;   // replayed from the result cache
+
+    // All minimized
+    vector<double> Objectives() const
+    {
+        return {meanDelay, delayP99, -utilization};
+    }
+};
+
+struct Range
+{
+    double low;
+    double high;
+};
+
+static Range
+ParseRange(const string &text)
+{
+    size_t colon = text.find(':');
+    double low = stod(text.substr(0, colon));
+    double high = colon == string::npos ? low : stod(text.substr(colon + 1));
+    return Range{min(low, high), max(low, high)};
+}
+
+static bool
+Dominates(const vector<double> &a, const vector<double> &b)
+{
+    bool better = false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i] > b[i])
+        {
+            return false;
+        }
+        better = better || a[i] < b[i];
+    }
+    return better;
+}
+
+// Pareto rank (0 = non-dominated) and crowding distance of every point
+static void
+RankPoints(const vector<vector<double>> &points, vector<uint32_t> *rank, vector<double> *crowding)
+{
+    size_t n = points.size();
+    rank->assign(n, 0);
+    crowding->assign(n, 0);
+    vector<bool> assigned(n, false);
+    for (uint32_t r = 0, left = n; left > 0; r++)
+    {
+        vector<size_t> front;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (assigned[i])
+            {
+                continue;
+            }
+            bool dominated = false;
+            for (size_t j = 0; j < n && !dominated; j++)
+            {
+                dominated = !assigned[j] && j != i && Dominates(points[j], points[i]);
+            }
+            if (!dominated)
+            {
+                front.push_back(i);
+            }
+        }
+        for (size_t i : front)
+        {
+            assigned[i] = true;
+            (*rank)[i] = r;
+        }
+        left -= front.size();
+
+        // Crowding: summed normalized gap between each point's neighbours
+        for (size_t k = 0; !front.empty() && k < points[front[0]].size(); k++)
+        {
+            sort(front.begin(), front.end(),
+                 [&](size_t a, size_t b) { return points[a][k] < points[b][k]; });
+            double span = points[front.back()][k] - points[front.front()][k];
+            (*crowding)[front.front()] = numeric_limits<double>::infinity();
+            (*crowding)[front.back()] = numeric_limits<double>::infinity();
+            for (size_t i = 1; span > 0 && i + 1 < front.size(); i++)
+            {
+                (*crowding)[front[i]] +=
+                    (points[front[i + 1]][k] - points[front[i - 1]][k]) / span;
+            }
+        }
+    }
+}
+
+// The k best evaluations by rank, then crowding
+static vector<Evaluation>
+SelectBest(const vector<Evaluation> &evals, size_t k)
+{
+    vector<vector<double>> points;
+    for (const Evaluation &e : evals)
+    {
+        points.push_back(e.Objectives());
+    }
+    vector<uint32_t> rank;
+    vector<double> crowding;
+    RankPoints(points, &rank, &crowding);
+    vector<size_t> order(evals.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return rank[a] != rank[b] ? rank[a] < rank[b] : crowding[a] > crowding[b];
+    });
+    vector<Evaluation> best;
+    for (size_t i = 0; i < min(k, order.size()); i++)
+    {
+        best.push_back(evals[order[i]]);
+    }
+    return best;
+}
+
+static vector<Evaluation>
+ParetoFront(const vector<Evaluation> &evals)
+{
+    vector<Evaluation> front;
+    for (const Evaluation &e : evals)
+    {
+        bool dominated = false;
+        for (const Evaluation &o : evals)
+        {
+            dominated = dominated || Dominates(o.Objectives(), e.Objectives());
+        }
+        if (!dominated)
+        {
+            front.push_back(e);
+        }
+    }
+    sort(front.begin(), front.end(),
+         [](const Evaluation &a, const Evaluation &b) { return a.utilization < b.utilization; });
+    return front;
+}
+
+int main(int argc, char *argv[])
+{
+    string binary = "";
+    string args = "";
+    string minThRange = "1:40";
+    string maxThRange = "5:80";
+    string queueSizeRange = "20:200";
+    string gentleList = "1,0";
+    string meanPktSizeList = "500,1000,1500";
+    uint32_t candidates = 27;
+    double eta = 3;
+    double minTime = 5;
+    double maxTime = 45;
+    uint32_t brackets = 3;
+    uint32_t run = 1;
+    uint32_t seed = 1;
+    unsigned jobs = 0;
+    string resultCache = "";
+    string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binary", "Path to the built aqmred executable", binary);
+    cmd.AddValue("args", "Space-separated extra arguments for every run", args);
+    cmd.AddValue("minTh", "MinTh range lo:hi (packets)", minThRange);
+    cmd.AddValue("maxTh", "MaxTh range lo:hi (packets)", maxThRange);
+    cmd.AddValue("queueSize", "MaxSize range lo:hi (packets)", queueSizeRange);
+    cmd.AddValue("gentle", "Comma-separated Gentle values (1/0)", gentleList);
+    cmd.AddValue("meanPktSize", "Comma-separated MeanPktSize values (bytes)", meanPktSizeList);
+    cmd.AddValue("candidates", "Configurations started per bracket", candidates);
+    cmd.AddValue("eta", "Halving factor: 1/eta survive each rung, which runs eta times longer", eta);
+    cmd.AddValue("minTime", "simTime of the first rung (s)", minTime);
+    cmd.AddValue("maxTime", "simTime of the last rung (s)", maxTime);
+    cmd.AddValue("brackets", "Successive-halving brackets", brackets);
+    cmd.AddValue("run", "RngRun shared by every run", run);
+    cmd.AddValue("seed", "Seed of the search's own sampling", seed);
+    cmd.AddValue("jobs", "Parallel workers (0 = all cores)", jobs);
+    cmd.AddValue("resultCache", "Result cache directory passed to every run (empty = off)", resultCache);
+    cmd.AddValue("output", "CSV file with every run", output);
+    cmd.Parse(argc, argv);
+
+    if (binary.empty())
+    {
+        cerr << "--binary=<path to aqmred> is required" << endl;
+        return 1;
+    }
+    eta = max(eta, 2.0);
+    maxTime = max(maxTime, minTime);
+
+    Range minThR = ParseRange(minThRange);
+    Range maxThR = ParseRange(maxThRange);
+    Range queueR = ParseRange(queueSizeRange);
+    vector<string> gentles = SplitList(gentleList);
+    vector<string> pktSizes = SplitList(meanPktSizeList);
+    if (gentles.empty() || pktSizes.empty())
+    {
+        cerr << "--gentle and --meanPktSize need at least one value each" << endl;
+        return 1;
+    }
+    vector<string> extra = SplitList(args, ' ');
+    mt19937 rng(seed);
+
+    // Rounded to whole packets, with MaxTh > MinTh and MaxSize >= MaxTh
+    auto repair = [&](RedConfig c) {
+        c.minTh = round(min(max(c.minTh, minThR.low), minThR.high));
+        c.maxTh = round(min(max(c.maxTh, max(maxThR.low, c.minTh + 1)), max(maxThR.high, c.minTh + 1)));
+        double q = min(max(double(c.queueSize), max(queueR.low, c.maxTh)), max(queueR.high, c.maxTh));
+        c.queueSize = uint32_t(ceil(q));
+        return c;
+    };
+    auto uniform = [&](const Range &r) { return uniform_real_distribution<double>(r.low, r.high)(rng); };
+    auto pick = [&](const vector<string> &list) {
+        return list[uniform_int_distribution<size_t>(0, list.size() - 1)(rng)];
+    };
+    auto sample = [&]() {
+        RedConfig c;
+        c.minTh = uniform(minThR);
+        c.maxTh = uniform(Range{max(maxThR.low, c.minTh + 1), max(maxThR.high, c.minTh + 1)});
+        c.queueSize = uint32_t(uniform(Range{max(queueR.low, c.maxTh), max(queueR.high, c.maxTh)}));
+        c.gentle = pick(gentles) != "0";
+        c.meanPktSize = stoul(pick(pktSizes));
+        return repair(c);
+    };
+    // A front member moved by 10% of each range; discrete values change with p = 0.2
+    auto mutate = [&](RedConfig c) {
+        normal_distribution<double> step(0, 0.1);
+        c.minTh += step(rng) * (minThR.high - minThR.low);
+        c.maxTh += step(rng) * (maxThR.high - maxThR.low);
+        c.queueSize = uint32_t(max(0.0, c.queueSize + step(rng) * (queueR.high - queueR.low)));
+        if (uniform_real_distribution<double>(0, 1)(rng) < 0.2)
+        {
+            c.gentle = pick(gentles) != "0";
+        }
+        if (uniform_real_distribution<double>(0, 1)(rng) < 0.2)
+        {
+            c.meanPktSize = stoul(pick(pktSizes));
+        }
+        return repair(c);
+    };
+
+    vector<Evaluation> all;
+    auto evaluate = [&](const vector<RedConfig> &configs, double simTime, uint32_t bracket) {
+        ProcessPool pool(jobs);
+        for (const RedConfig &c : configs)
+        {
+            ostringstream time;
+            time << simTime;
+            vector<string> argv = {binary,
+                                   "--summary=1",
+                                   "--RngRun=" + to_string(run),
+                                   "--simTime=" + time.str(),
+                                   "--minTh=" + to_string(c.minTh),
+                                   "--maxTh=" + to_string(c.maxTh),
+                                   "--queueSize=" + to_string(c.queueSize) + "p",
+                                   "--gentle=" + to_string(c.gentle),
+                                   "--meanPktSize=" + to_string(c.meanPktSize)};
+            if (!resultCache.empty())
+            {
+                argv.push_back("--resultCache=" + resultCache);
+            }
+            argv.insert(argv.end(), extra.begin(), extra.end());
+            pool.Submit(argv);
+        }
+        vector<Evaluation> results(configs.size());
+        pool.Wait([&](size_t index, const ProcessResult &result) {
+            Evaluation &e = results[index];
+            e.config = configs[index];
+            e.simTime = simTime;
+            e.bracket = bracket;
+            e.wallSeconds = result.wallSeconds;
+            SummaryLine total = FindSummary(ParseSummary(result.output), "scope", "total");
+            e.ok = result.status == 0 && total.count("utilization");
+            if (!e.ok)
+            {
+                cerr << "Run " << e.config.Name() << " at " << simTime << " s failed (exit "
+                     << result.status << ")" << endl;
+                return;
+            }
+            e.meanDelay = stod(total["meanDelay"]);
+            e.delayP99 = stod(total["delayP99"]);
+            e.utilization = stod(total["utilization"]);
+            e.cached = total.count("cached") > 0;
+        });
+        all.insert(all.end(), results.begin(), results.end());
+        vector<Evaluation> ok;
+        for (const Evaluation &e : results)
+        {
+            if (e.ok)
+            {
+                ok.push_back(e);
+            }
+        }
+        return ok;
+    };
+
+    auto printFront = [](const vector<Evaluation> &front) {
+        cout << left << setw(14) << "utilization" << setw(14) << "meanDelay(s)" << setw(14)
+             << "p99Delay(s)" << "configuration\n";
+        for (const Evaluation &e : front)
+        {
+            cout << setw(14) << e.utilization << setw(14) << e.meanDelay << setw(14) << e.delayP99
+                 << e.config.Name() << "\n";
+        }
+    };
+
+    /* ---------- SUCCESSIVE HALVING ---------- */
+    uint32_t rungs = 1;
+    while (minTime * pow(eta, rungs) <= maxTime * (1 + 1e-9))
+    {
+        rungs++;
+    }
+    vector<Evaluation> finals; // full-length runs of every bracket
+    set<string> tried;
+    for (uint32_t b = 0; b < brackets; b++)
+    {
+        vector<Evaluation> front = ParetoFront(finals);
+        vector<RedConfig> configs;
+        for (uint32_t i = 0, attempts = 0; configs.size() < candidates && attempts < 100 * candidates;
+             attempts++, i++)
+        {
+            RedConfig c = !front.empty() && i % 2 == 1
+                ? mutate(front[uniform_int_distribution<size_t>(0, front.size() - 1)(rng)].config)
+                : sample();
+            if (tried.insert(c.Name()).second)
+            {
+                configs.push_back(c);
+            }
+        }
+
+        double simTime = maxTime / pow(eta, rungs - 1);
+        for (uint32_t r = 0; r < rungs && !configs.empty(); r++)
+        {
+            cout << "Bracket " << b << ", rung " << r << ": " << configs.size() << " configurations at "
+                 << simTime << " s" << endl;
+            vector<Evaluation> results = evaluate(configs, simTime, b);
+            if (r + 1 == rungs)
+            {
+                finals.insert(finals.end(), results.begin(), results.end());
+                break;
+            }
+            configs.clear();
+            for (const Evaluation &e : SelectBest(results, max<size_t>(1, size_t(results.size() / eta))))
+            {
+                configs.push_back(e.config);
+            }
+            simTime = min(simTime * eta, maxTime);
+        }
+        cout << "\nPareto front after bracket " << b << ":\n";
+        printFront(ParetoFront(finals));
+        cout << "\n";
+    }
+
+    /* ---------- RESULT ---------- */
+    double simSeconds = 0;
+    double wall = 0;
+    for (const Evaluation &e : all)
+    {
+        simSeconds += e.simTime;
+        wall += e.wallSeconds;
+    }
+    cout << all.size() << " runs, " << simSeconds << " simulated s (" << simSeconds / maxTime
+         << " full-length runs), " << wall << " s of run time; " << tried.size()
+         << " configurations tried, " << finals.size() << " run at " << maxTime << " s\n";
+
+    if (!output.empty())
+    {
+        ofstream csv(output);
+        csv << "bracket,simTime,minTh,maxTh,queueSize,gentle,meanPktSize,"
+               "meanDelay,delayP99,utilization,wallSeconds,cached,ok\n";
+        for (const Evaluation &e : all)
+        {
+            csv << e.bracket << ',' << e.simTime << ',' << e.config.minTh << ',' << e.config.maxTh
+                << ',' << e.config.queueSize << ',' << e.config.gentle << ','
+                << e.config.meanPktSize << ',' << e.meanDelay << ',' << e.delayP99 << ','
+                << e.utilization << ',' << e.wallSeconds << ',' << e.cached << ',' << e.ok
+                << '\n';
+        }
+    }
+    return finals.empty() ? 1 : 0;
+}
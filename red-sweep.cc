@@ -0,0 +1,199 @@
+/*
+ * Parallel parameter sweep over the RED AQM scenario (aqmred.cc).
+ *
+ * Every grid point runs as an isolated aqmred process; a bounded pool keeps
+ * all cores busy and the SUMMARY totals of each point are collected into one
+ * table.
+ *
+ * Usage:
+ *    ./ns3 build aqmred red-sweep
+ *    ./ns3 run "red-sweep --binary=build/scratch/ns3-dev-aqmred-default
+ *               --minTh=2,5,10 --maxTh=5,15,30 --queueSize=20p,50p
+ *               --linkRate=5Mbps,10Mbps --gentle=1,0 --runs=1,2,3
+ *               --output=scratch/red-sweep.csv"
+ *
+ * With --resultCache=<dir> every run looks itself up in that result cache
+ * (result-cache.h) first, so repeating a sweep only simulates new points.
+ * Replayed points show "cached" instead of a wall time.
+ */
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace ns3;
+using namespace std;
+
+struct SweepPoint
+{
+    string minTh;
+    string maxTh;
+    string queueSize;
+    string linkRate;
+    string gentle;
+    string run;
+    SummaryLine total;
+    double wallSeconds = 0;
+    bool cached = false;
+    int status = -1;
+};
+
+int main(int argc, char *argv[])
+{
+    string binary = "";
+    string minThList = "2";
+    string maxThList = "5";
+    string queueSizeList = "20p";
+    string linkRateList = "5Mbps";
+    string gentleList = "1";
+    string runList = "1";
+    double simTime = 20.0;
+    unsigned jobs = 0;
+    string output = "";
+    string resultCache = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binary", "Path to the built aqmred executable", binary);
+    cmd.AddValue("minTh", "Comma-separated MinTh values", minThList);
+    cmd.AddValue("maxTh", "Comma-separated MaxTh values", maxThList);
+    cmd.AddValue("queueSize", "Comma-separated MaxSize values", queueSizeList);
+    cmd.AddValue("linkRate", "Comma-separated bottleneck rates", linkRateList);
+    cmd.AddValue("gentle", "Comma-separated Gentle values (1/0)", gentleList);
+    cmd.AddValue("runs", "Comma-separated RngRun values", runList);
+    cmd.AddValue("simTime", "Duration of each run (s)", simTime);
+    cmd.AddValue("jobs", "Parallel workers (0 = all cores)", jobs);
+    cmd.AddValue("output", "CSV file for the aggregated table", output);
+    cmd.AddValue("resultCache", "Result cache directory passed to every run (empty = off)", resultCache);
+    cmd.Parse(argc, argv);
+
+    if (binary.empty())
+    {
+        cerr << "--binary=<path to aqmred> is required" << endl;
+        return 1;
+    }
+
+    // Thresholds are compared below, so they must be numbers
+    for (const string &value : SplitList(minThList + "," + maxThList))
+    {
+        char *end = nullptr;
+        strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0')
+        {
+            cerr << "--minTh and --maxTh take comma-separated numbers, not \"" << value << "\""
+                 << endl;
+            return 1;
+        }
+    }
+
+    /* ---------- BUILD GRID ---------- */
+    vector<SweepPoint> points;
+    for (const string &minTh : SplitList(minThList))
+        for (const string &maxTh : SplitList(maxThList))
+            for (const string &queueSize : SplitList(queueSizeList))
+                for (const string &linkRate : SplitList(linkRateList))
+                    for (const string &gentle : SplitList(gentleList))
+                        for (const string &run : SplitList(runList))
+                        {
+                            if (stod(minTh) >= stod(maxTh))
+                            {
+                                continue;
+                            }
+                            SweepPoint p;
+                            p.minTh = minTh;
+                            p.maxTh = maxTh;
+                            p.queueSize = queueSize;
+                            p.linkRate = linkRate;
+                            p.gentle = gentle;
+                            p.run = run;
+                            points.push_back(p);
+                        }
+
+    ProcessPool pool(jobs);
+    cout << "Running " << points.size() << " points on "
+         << pool.GetWorkers() << " workers\n";
+
+    for (const SweepPoint &p : points)
+    {
+        vector<string> argv = {binary,
+                               "--minTh=" + p.minTh,
+                               "--maxTh=" + p.maxTh,
+                               "--queueSize=" + p.queueSize,
+                               "--linkRate=" + p.linkRate,
+                               "--gentle=" + p.gentle,
+                               "--RngRun=" + p.run,
+                               "--simTime=" + to_string(simTime),
+                               "--summary=1"};
+        if (!resultCache.empty())
+        {
+            argv.push_back("--resultCache=" + resultCache);
+        }
+        pool.Submit(argv);
+    }
+
+    /* ---------- RUN ---------- */
+    size_t done = 0;
+    pool.Wait([&](size_t index, const ProcessResult &result) {
+        SweepPoint &p = points[index];
+        p.status = result.status;
+        p.wallSeconds = result.wallSeconds;
+        p.total = FindSummary(ParseSummary(result.output), "scope", "total");
+        p.cached = p.total.count("cached") > 0;
+        cerr << "\r" << ++done << "/" << points.size() << " done" << flush;
+    });
+    cerr << "\n";
+
+    /* ---------- AGGREGATED TABLE ---------- */
+    ofstream csv;
+    if (!output.empty())
+    {
+        csv.open(output);
+        csv << "minTh,maxTh,queueSize,linkRate,gentle,run,"
+               "lossRatio,meanDelay,delayP99,throughputMbps,wallSeconds,cached,status\n";
+    }
+
+    cout << left << setw(7) << "minTh" << setw(7) << "maxTh"
+         << setw(8) << "qSize" << setw(10) << "rate"
+         << setw(7) << "gentle" << setw(5) << "run"
+         << setw(11) << "loss" << setw(13) << "delay(s)"
+         << setw(13) << "p99(s)"
+         << setw(11) << "thr(Mbps)" << "wall(s)\n";
+
+    for (const SweepPoint &p : points)
+    {
+        string loss = p.total.count("lossRatio") ? p.total.at("lossRatio") : "-";
+        string delay = p.total.count("meanDelay") ? p.total.at("meanDelay") : "-";
+        string p99 = p.total.count("delayP99") ? p.total.at("delayP99") : "-";
+        string thr = p.total.count("throughputMbps") ? p.total.at("throughputMbps") : "-";
+
+        cout << left << setw(7) << p.minTh << setw(7) << p.maxTh
+             << setw(8) << p.queueSize << setw(10) << p.linkRate
+             << setw(7) << p.gentle << setw(5) << p.run
+             << setw(11) << loss << setw(13) << delay << setw(13) << p99
+             << setw(11) << thr;
+        if (p.cached)
+        {
+            cout << "cached";
+        }
+        else
+        {
+            cout << fixed << setprecision(2) << p.wallSeconds << defaultfloat;
+        }
+        cout << (p.status != 0 ? "  FAILED" : "") << "\n";
+
+        if (csv.is_open())
+        {
+            csv << p.minTh << ',' << p.maxTh << ',' << p.queueSize << ','
+                << p.linkRate << ',' << p.gentle << ',' << p.run << ','
+                << loss << ',' << delay << ',' << p99 << ',' << thr << ','
+                << (p.cached ? "" : to_string(p.wallSeconds)) << ',' << p.cached << ','
+                << p.status << '\n';
+        }
+    }
+
+    return 0;
+}
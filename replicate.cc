@@ -0,0 +1,267 @@
+/*
+ * Independent replications of any scenario until its confidence intervals
+ * are tight enough.
+ *
+ * Replication i runs the scenario with --summary=1 and --RngRun=firstRun+i
+ * (ns-3's run number global value, which every scenario accepts), so each
+ * replication draws from its own random number streams. Metrics are fields
+ * of the scenario's SUMMARY lines:
+ *
+ *    field@scope[,key=value...]     e.g. throughputMbps@flow,dstPort=9000
+ *
+ * is the mean of field over the run's SUMMARY scope=<scope> lines carrying
+ * every key=value. A run without such a line counts as failed.
+ *
+ * The pool keeps --jobs replications running and starts the next one as
+ * each finishes. Results are folded into running means and variances in
+ * run-number order, so the stopping decision never depends on which runs
+ * happen to finish first. No further replications start once every
+ * metric's 95% CI half-width is within --precision of its mean (after at
+ * least --minRuns), or --maxRuns have started, or the finished runs have
+ * used --budget seconds of run time. Runs already started are waited for
+ * and counted.
+ *
+ * The exit status is 1 if a run fails or the precision is not reached.
+ *
+ * Usage:
+ *    ./ns3 build tcpvsudp replicate
+ *    ./ns3 run "replicate --binary=build/scratch/ns3-dev-tcpvsudp-default
+ *               --args='--animMode=none --sampleFile=' --precision=0.02
+ *               --metrics='throughputMbps@flow,dstPort=9000;meanDelay@flow,dstPort=8000'"
+ */
+
+#include "process-pool.h"
+#include "stats-util.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+using namespace ns3;
+using namespace std;
+
+struct Metric
+{
+    string spec;
+    string field;
+    string scope;
+    vector<pair<string, string>> match;
+    RunningStats stats;
+};
+
+struct Replication
+{
+    uint32_t run = 0;
+    bool done = false;
+    vector<double> values; // one per metric
+    double wallSeconds = 0;
+};
+
+static Metric
+ParseMetric(const string &spec)
+{
+    Metric m;
+    m.spec = spec;
+    size_t at = spec.find('@');
+    NS_ABORT_MSG_IF(at == string::npos, "Metric without @scope: " << spec);
+    m.field = spec.substr(0, at);
+    vector<string> parts = SplitList(spec.substr(at + 1));
+    m.scope = parts[0];
+    for (size_t i = 1; i < parts.size(); i++)
+    {
+        size_t eq = parts[i].find('=');
+        NS_ABORT_MSG_IF(eq == string::npos, "Metric filter without '=': " << parts[i]);
+        m.match.emplace_back(parts[i].substr(0, eq), parts[i].substr(eq + 1));
+    }
+    return m;
+}
+
+// Mean of the metric over the matching lines; false if there are none
+static bool
+Extract(const Metric &m, vector<SummaryLine> &lines, double *value)
+{
+    double sum = 0;
+    uint32_t n = 0;
+    for (SummaryLine &l : lines)
+    {
+        bool match = l["scope"] == m.scope && l.count(m.field);
+        for (const auto &kv : m.match)
+        {
+            match = match && l[kv.first] == kv.second;
+        }
+        if (match)
+        {
+            sum += stod(l[m.field]);
+            n++;
+        }
+    }
+    *value = n > 0 ? sum / n : 0;
+    return n > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    string binary = "";
+    string args = "";
+    string metricList = "throughputMbps@flow";
+    double precision = 0.05;
+    uint32_t minRuns = 5;
+    uint32_t maxRuns = 100;
+    double budget = 0;
+    unsigned jobs = 0;
+    uint32_t firstRun = 1;
+    string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binary", "Path to the built scenario", binary);
+    cmd.AddValue("args", "Space-separated extra arguments for every run", args);
+    cmd.AddValue("metrics", "';'-separated field@scope[,key=value...] metrics", metricList);
+    cmd.AddValue("precision", "Target 95% CI half-width relative to the mean", precision);
+    cmd.AddValue("minRuns", "Replications before the precision is checked", minRuns);
+    cmd.AddValue("maxRuns", "Upper bound on the number of replications", maxRuns);
+    cmd.AddValue("budget", "Run time (s, summed over runs) after which no run starts; 0 = none", budget);
+    cmd.AddValue("jobs", "Parallel workers (0 = all cores)", jobs);
+    cmd.AddValue("firstRun", "RngRun of the first replication", firstRun);
+    cmd.AddValue("output", "CSV file with every replication", output);
+    cmd.Parse(argc, argv);
+
+    if (binary.empty())
+    {
+        cerr << "--binary=<path to the scenario> is required" << endl;
+        return 1;
+    }
+    minRuns = max(minRuns, 2u);
+    maxRuns = max(maxRuns, minRuns);
+
+    vector<Metric> metrics;
+    for (const string &spec : SplitList(metricList, ';'))
+    {
+        metrics.push_back(ParseMetric(spec));
+    }
+    vector<string> extra = SplitList(args, ' ');
+
+    ProcessPool pool(jobs);
+    vector<Replication> reps;
+    size_t folded = 0;   // reps[0..folded) are in the running statistics
+    double cost = 0;
+    bool failed = false;
+    bool stopping = false;
+
+    auto precise = [&]() {
+        if (folded < minRuns)
+        {
+            return false;
+        }
+        for (const Metric &m : metrics)
+        {
+            if (m.stats.GetCi().GetRelativeHalfWidth() > precision)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto submit = [&]() {
+        Replication r;
+        r.run = firstRun + reps.size();
+        reps.push_back(r);
+        vector<string> argv = {binary, "--summary=1", "--RngRun=" + to_string(r.run)};
+        argv.insert(argv.end(), extra.begin(), extra.end());
+        pool.Submit(argv);
+    };
+
+    /* ---------- REPLICATIONS ---------- */
+    cout << left << setw(7) << "run" << setw(10) << "wall(s)";
+    for (const Metric &m : metrics)
+    {
+        cout << setw(32) << m.spec;
+    }
+    cout << "\n";
+
+    while (reps.size() < min<size_t>(maxRuns, max<size_t>(minRuns, pool.GetWorkers())))
+    {
+        submit();
+    }
+    pool.Wait([&](size_t index, const ProcessResult &result) {
+        Replication &r = reps[index];
+        r.wallSeconds = result.wallSeconds;
+        cost += result.wallSeconds;
+        vector<SummaryLine> lines = ParseSummary(result.output);
+        bool ok = result.status == 0;
+        r.values.resize(metrics.size());
+        for (size_t k = 0; ok && k < metrics.size(); k++)
+        {
+            ok = Extract(metrics[k], lines, &r.values[k]);
+        }
+        if (!ok)
+        {
+            cerr << "Run " << r.run << " failed (exit " << result.status << ")" << endl;
+            failed = true;
+            return;
+        }
+        r.done = true;
+
+        // Fold the finished prefix, in run order
+        while (folded < reps.size() && reps[folded].done)
+        {
+            const Replication &f = reps[folded++];
+            cout << setw(7) << f.run << setw(10) << fixed << setprecision(2) << f.wallSeconds
+                 << defaultfloat;
+            for (size_t k = 0; k < metrics.size(); k++)
+            {
+                metrics[k].stats.Add(f.values[k]);
+                ConfidenceInterval ci = metrics[k].stats.GetCi();
+                ostringstream cell;
+                cell << f.values[k] << " (" << ci.mean << " +- " << ci.halfWidth << ")";
+                cout << setw(32) << cell.str();
+            }
+            cout << "\n";
+        }
+
+        stopping = stopping || failed || precise() || reps.size() >= maxRuns ||
+                   (budget > 0 && cost >= budget);
+        if (!stopping)
+        {
+            submit();
+        }
+    });
+
+    /* ---------- RESULT ---------- */
+    bool reached = !failed && precise();
+    cout << "\n" << folded << " replications (RngRun " << firstRun << ".."
+         << firstRun + folded - 1 << "), " << cost << " s of run time"
+         << (reached ? "" : "; precision not reached") << "\n";
+    for (const Metric &m : metrics)
+    {
+        ConfidenceInterval ci = m.stats.GetCi();
+        cout << m.spec << ": " << ci.mean << " +- " << ci.halfWidth << " (95% CI, "
+             << 100 * ci.GetRelativeHalfWidth() << "% of the mean)\n";
+    }
+
+    if (!output.empty())
+    {
+        ofstream csv(output);
+        csv << "run,wallSeconds";
+        for (const Metric &m : metrics)
+        {
+            csv << ",\"" << m.spec << "\"";
+        }
+        csv << '\n';
+        for (size_t i = 0; i < folded; i++)
+        {
+            csv << reps[i].run << ',' << reps[i].wallSeconds;
+            for (double v : reps[i].values)
+            {
+                csv << ',' << v;
+            }
+            csv << '\n';
+        }
+    }
+    return reached ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+/*
+ * Content-addressed cache of scenario output.
+ *
+ * A run is identified by a canonical description of everything that
+ * determines its output:
+ *
+ *    binary  path, size and modification time of the executable and of
+ *            every ns-3 library it has loaded
+ *    arg     command-line arguments, sorted by name, last one wins
+ *    global  every GlobalValue (RngSeed, RngRun, SchedulerType, ...)
+ *    attr    every attribute default of every registered TypeId, i.e. the
+ *            values left by Config::SetDefault and --ns3::Type::Name=
+ *    extra   whatever the scenario adds with Add()
+ *
+ * Pointer, object-container and callback attributes print as addresses and
+ * are left out; their defaults come from the binary. The scenario's own
+ * CommandLine variables follow from the binary and the arguments.
+ *
+ * The digest of the description names two files in the cache directory:
+ * <digest>.key holds the description, <digest>.out the run's stdout. If
+ * both exist and the key matches, Replay() prints the stored output and the
+ * scenario returns without simulating. Otherwise std::cout is copied from
+ * Replay() on and Store() files it, so only new configurations are run.
+ *
+ * Files the scenario writes (NetAnim, traces, pcap) are not cached: a
+ * scenario that writes any calls SetFileOutput(true), which bypasses the
+ * cache so they are always produced by a real run. Replayed SUMMARY lines
+ * carry cached=1, and the wall-time fields of scope=run lines are dropped,
+ * so a replay is never read as a new measurement.
+ *
+ * Usage:
+ *    cmd.AddValue("resultCache", "Result cache directory (empty = off)", resultCache);
+ *    cmd.Parse(argc, argv);
+ *    ResultCache cache(resultCache);
+ *    cache.SetFileOutput(pcap);  // files are only written by real runs
+ *    if (cache.Replay(argc, argv)) return 0;
+ *    ... simulate, print results to std::cout ...
+ *    cache.Store();              // in forked children (warm start) a no-op
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+class ResultCache
+{
+  public:
+    // An empty directory disables the cache
+    explicit ResultCache(const std::string& dir)
+        : m_dir(dir)
+    {
+    }
+
+    ~ResultCache()
+    {
+        StopCapture();
+    }
+
+    // With files == true the run writes files the cache cannot restore,
+    // so Replay() and Store() do nothing. Call before Replay().
+    void SetFileOutput(bool files)
+    {
+        if (files && !m_dir.empty())
+        {
+            std::cerr << "Result cache bypassed: this run writes files" << std::endl;
+            m_dir.clear();
+        }
+    }
+
+    // Key material the command line and attributes do not show
+    void Add(const std::string& key, const std::string& value)
+    {
+        m_extra[key] = value;
+    }
+
+    // Prints the cached output of this configuration and returns true, or
+    // starts copying std::cout and returns false. Call after cmd.Parse and
+    // the scenario's Config::SetDefault calls.
+    bool Replay(int argc, char* argv[])
+    {
+        if (m_dir.empty())
+        {
+            return false;
+        }
+        m_key = Describe(argc, argv);
+        m_digest = Digest(m_key);
+        std::ifstream key(Path(".key"));
+        std::ifstream out(Path(".out"));
+        if (key && out)
+        {
+            std::stringstream stored;
+            stored << key.rdbuf();
+            if (stored.str() == m_key)
+            {
+                std::stringstream replay;
+                replay << out.rdbuf();
+                std::cout << MarkReplayed(replay.str()) << std::flush;
+                return true;
+            }
+        }
+        m_pid = getpid();
+        m_tee.SetTarget(std::cout.rdbuf());
+        m_saved = std::cout.rdbuf(&m_tee);
+        return false;
+    }
+
+    // Files the output printed since Replay(); only in the process that called it
+    bool Store()
+    {
+        if (!m_saved || getpid() != m_pid)
+        {
+            return false;
+        }
+        std::cout.flush();
+        StopCapture();
+        MakeDirs(m_dir);
+        // Written under temporary names and renamed, so concurrent runs of
+        // the same configuration never leave a torn entry
+        std::string tmp = "." + std::to_string(getpid()) + ".tmp";
+        bool ok = Write(Path(".out") + tmp, m_tee.GetCopy()) && Write(Path(".key") + tmp, m_key) &&
+                  std::rename((Path(".out") + tmp).c_str(), Path(".out").c_str()) == 0 &&
+                  std::rename((Path(".key") + tmp).c_str(), Path(".key").c_str()) == 0;
+        return ok;
+    }
+
+    // Hex digest of the configuration, once Replay() has run
+    const std::string& GetDigest() const
+    {
+        return m_digest;
+    }
+
+    // Canonical description of the running configuration
+    std::string Describe(int argc, char* argv[]) const
+    {
+        std::ostringstream os;
+        for (const std::string& file : LoadedBinaries())
+        {
+            struct stat st;
+            if (stat(file.c_str(), &st) == 0)
+            {
+                os << "binary " << file << " " << st.st_size << " " << st.st_mtim.tv_sec << "."
+                   << st.st_mtim.tv_nsec << "\n";
+            }
+        }
+
+        std::map<std::string, std::string> args;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string a = argv[i];
+            size_t eq = a.find('=');
+            std::string name = a.substr(0, eq);
+            if (name != "--resultCache")
+            {
+                args[name] = eq == std::string::npos ? "" : a.substr(eq + 1);
+            }
+        }
+        for (const auto& a : args)
+        {
+            os << "arg " << a.first << "=" << a.second << "\n";
+        }
+
+        std::map<std::string, std::string> globals;
+        for (auto i = GlobalValue::Begin(); i != GlobalValue::End(); i++)
+        {
+            Ptr<AttributeValue> v = (*i)->GetChecker()->Create();
+            (*i)->GetValue(*v);
+            globals[(*i)->GetName()] = v->SerializeToString((*i)->GetChecker());
+        }
+        for (const auto& g : globals)
+        {
+            os << "global " << g.first << "=" << g.second << "\n";
+        }
+
+        std::map<std::string, std::string> attrs;
+        for (uint32_t t = 0; t < TypeId::GetRegisteredN(); t++)
+        {
+            TypeId tid = TypeId::GetRegistered(t);
+            for (std::size_t j = 0; j < tid.GetAttributeN(); j++)
+            {
+                TypeId::AttributeInformation info = tid.GetAttribute(j);
+                std::string type = info.checker->GetValueTypeName();
+                if (type == "ns3::PointerValue" || type == "ns3::ObjectPtrContainerValue" ||
+                    type == "ns3::CallbackValue")
+                {
+                    continue;
+                }
+                attrs[tid.GetName() + "::" + info.name] =
+                    info.initialValue->SerializeToString(info.checker);
+            }
+        }
+        for (const auto& a : attrs)
+        {
+            os << "attr " << a.first << "=" << a.second << "\n";
+        }
+
+        for (const auto& e : m_extra)
+        {
+            os << "extra " << e.first << "=" << e.second << "\n";
+        }
+        return os.str();
+    }
+
+  private:
+    // Copies everything written to std::cout into a string
+    class TeeBuf : public std::streambuf
+    {
+      public:
+        void SetTarget(std::streambuf* target)
+        {
+            m_target = target;
+        }
+
+        const std::string& GetCopy() const
+        {
+            return m_copy;
+        }
+
+      protected:
+        int overflow(int c) override
+        {
+            if (c != EOF)
+            {
+                m_copy.push_back(char(c));
+                return m_target->sputc(char(c));
+            }
+            return 0;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            m_copy.append(s, n);
+            return m_target->sputn(s, n);
+        }
+
+        int sync() override
+        {
+            return m_target->pubsync();
+        }
+
+      private:
+        std::streambuf* m_target = nullptr;
+        std::string m_copy;
+    };
+
+    // Adds cached=1 to every SUMMARY line and drops the wall-time fields of
+    // scope=run lines, which describe the original run
+    static std::string MarkReplayed(const std::string& output)
+    {
+        static const std::set<std::string> wallFields = {"wallSeconds", "eventsPerSecond",
+                                                         "simPerWall"};
+        std::ostringstream os;
+        std::istringstream lines(output);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            if (line.compare(0, 8, "SUMMARY ") != 0)
+            {
+                os << line << "\n";
+                continue;
+            }
+            std::vector<std::string> words;
+            std::istringstream in(line.substr(8));
+            std::string word;
+            while (in >> word)
+            {
+                words.push_back(word);
+            }
+            bool run = std::find(words.begin(), words.end(), "scope=run") != words.end();
+            os << "SUMMARY";
+            for (const std::string& w : words)
+            {
+                if (!run || !wallFields.count(w.substr(0, w.find('='))))
+                {
+                    os << " " << w;
+                }
+            }
+            os << " cached=1\n";
+        }
+        return os.str();
+    }
+
+    // The executable and the ns-3 libraries mapped into this process
+    static std::vector<std::string> LoadedBinaries()
+    {
+        std::set<std::string> files;
+        char exe[4096];
+        ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if (n > 0)
+        {
+            files.insert(std::string(exe, n));
+        }
+        std::ifstream maps("/proc/self/maps");
+        std::string line;
+        while (std::getline(maps, line))
+        {
+            size_t slash = line.find('/');
+            if (slash != std::string::npos && line.find("libns3", slash) != std::string::npos)
+            {
+                files.insert(line.substr(slash));
+            }
+        }
+        return std::vector<std::string>(files.begin(), files.end());
+    }
+
+    // 128-bit FNV-1a: two 64-bit passes with different offset bases
+    static std::string Digest(const std::string& text)
+    {
+        uint64_t h[2] = {0xcbf29ce484222325ull, 0x84222325cbf29ce4ull};
+        for (uint64_t& v : h)
+        {
+            for (unsigned char c : text)
+            {
+                v = (v ^ c) * 0x100000001b3ull;
+            }
+        }
+        char hex[33];
+        std::snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)h[0],
+                      (unsigned long long)h[1]);
+        return hex;
+    }
+
+    std::string Path(const std::string& suffix) const
+    {
+        return m_dir + "/" + m_digest + suffix;
+    }
+
+    static bool Write(const std::string& path, const std::string& data)
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << data;
+        return bool(f.flush());
+    }
+
+    static void MakeDirs(const std::string& dir)
+    {
+        for (size_t at = dir.find('/', 1); ; at = dir.find('/', at + 1))
+        {
+            mkdir(dir.substr(0, at).c_str(), 0755);
+            if (at == std::string::npos)
+            {
+                return;
+            }
+        }
+    }
+
+    void StopCapture()
+    {
+        if (m_saved)
+        {
+            std::cout.rdbuf(m_saved);
+            m_saved = nullptr;
+        }
+    }
+
+    std::string m_dir;
+    std::map<std::string, std::string> m_extra;
+    std::string m_key;
+    std::string m_digest;
+    TeeBuf m_tee;
+    std::streambuf* m_saved = nullptr;
+    pid_t m_pid = 0;
+};
+
+} // namespace ns3
+
+#endif /* RESULT_CACHE_H */
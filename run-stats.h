@@ -0,0 +1,102 @@
+/*
+ * Wall time and event throughput of one simulation run.
+ *
+ * Prints the number of events the simulator executed, the wall time of
+ * Simulator::Run, the resulting events per second and simulated seconds per
+ * wall second, together with the scheduler in use, as
+ *    SUMMARY scope=run scheduler=ns3::MapScheduler events=... wallSeconds=...
+ *            eventsPerSecond=... simSeconds=... simPerWall=...
+ * (one line) so benchmarks can compare scheduler and scenario variants.
+ * Peak RSS is measured by the parent (ProcessPool), not here.
+ *
+ * Usage:
+ *    RunStats stats;
+ *    stats.Start();
+ *    Simulator::Run();
+ *    stats.Stop();
+ *    stats.PrintSummary(std::cout);
+ */
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include "ns3/core-module.h"
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace ns3
+{
+
+class RunStats
+{
+  public:
+    void Start()
+    {
+        m_events = Simulator::GetEventCount();
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    void Stop()
+    {
+        m_wallSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        m_events = Simulator::GetEventCount() - m_events;
+        m_simSeconds = Simulator::Now().GetSeconds();
+    }
+
+    uint64_t GetEvents() const
+    {
+        return m_events;
+    }
+
+    double GetWallSeconds() const
+    {
+        return m_wallSeconds;
+    }
+
+    double GetEventsPerSecond() const
+    {
+        return m_wallSeconds > 0 ? m_events / m_wallSeconds : 0;
+    }
+
+    double GetSimPerWall() const
+    {
+        return m_wallSeconds > 0 ? m_simSeconds / m_wallSeconds : 0;
+    }
+
+    // TypeId name of the SchedulerType global value
+    static std::string GetSchedulerName()
+    {
+        TypeIdValue type;
+        GlobalValue::GetValueByName("SchedulerType", type);
+        return type.Get().GetName();
+    }
+
+    void Print(std::ostream& os) const
+    {
+        os << "Events: " << m_events << " in " << m_wallSeconds << " s ("
+           << GetEventsPerSecond() << " events/s, " << GetSchedulerName() << ")\n";
+    }
+
+    void PrintSummary(std::ostream& os) const
+    {
+        os << "SUMMARY scope=run scheduler=" << GetSchedulerName()
+           << " events=" << m_events
+           << " wallSeconds=" << m_wallSeconds
+           << " eventsPerSecond=" << GetEventsPerSecond()
+           << " simSeconds=" << m_simSeconds
+           << " simPerWall=" << GetSimPerWall() << "\n";
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+    uint64_t m_events = 0;
+    double m_wallSeconds = 0;
+    double m_simSeconds = 0;
+};
+
+} // namespace ns3
+
+#endif /* RUN_STATS_H */
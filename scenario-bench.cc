@@ -0,0 +1,353 @@
+/*
+ * Benchmark harness for the scratch scenarios, with regression gating.
+ *
+ * Every scenario runs at each scale factor k. Its scale parameters
+ * (duration, flow count, link rate, packet count) are multiplied by k and
+ * its NetAnim, packet trace and pcap output is switched off, so the timings
+ * cover the simulation core only. For every (scenario, k) the harness keeps
+ * the fastest of --runs repetitions and records
+ *
+ *    wall time, events executed, events/s, simulated s per wall s, peak RSS
+ *
+ * (the first four from the scenario's "SUMMARY scope=run" line, RSS from
+ * wait4). The results are compared with a baseline file. A wall time or
+ * peak RSS above baseline * (1 + tolerance), or an event count that moved
+ * by more than --eventTolerance, is a regression and the exit status is 1;
+ * so is any failed repetition of a point. --update rewrites the baseline
+ * from this run instead, leaving out points with failed repetitions.
+ *
+ * Usage:
+ *    ./ns3 build
+ *    ./ns3 run "scenario-bench --scales=1,2,4 --update"       (record baseline)
+ *    ./ns3 run "scenario-bench --scales=1,2,4"                (gate a new build)
+ *    ./ns3 run "scenario-bench --scenarios=aqmred,tcpvsudp --runs=5"
+ *
+ * Baseline format, one line per (scenario, k):
+ *    scenario k wallSeconds events eventsPerSecond simPerWall maxRssKb
+ */
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace ns3;
+using namespace std;
+
+/* ---------- SCENARIO TABLE ---------- */
+struct ScaleParam
+{
+    string name;
+    double base;
+    string unit;
+};
+
+struct ScenarioSpec
+{
+    string name;
+    vector<string> fixedArgs;   // output switched off
+    vector<ScaleParam> scaled;  // multiplied by the scale factor
+};
+
+static const vector<ScenarioSpec> g_scenarios = {
+    {"aqmred", {}, {{"simTime", 20, ""}, {"nSenders", 2, ""}, {"linkRate", 5, "Mbps"}}},
+    {"queuedelay", {"--animMode=none", "--traceFile="},
+     {{"simTime", 3, ""}, {"nSenders", 2, ""}, {"bottleneckRate", 5, "Mbps"}}},
+    {"tcpqueuedelay", {"--animMode=none"},
+     {{"simTime", 3, ""}, {"nSenders", 2, ""}, {"bottleneckRate", 5, "Mbps"}}},
+    {"tcpvsudp", {"--animMode=none", "--sampleFile="},
+     {{"simTime", 10, ""}, {"nTcp", 1, ""}, {"nUdp", 1, ""}, {"bottleneckRate", 5, "Mbps"}}},
+    {"IP", {}, {{"attackRate", 1000, ""}}},
+    {"multihop-delay-analysis", {"--animMode=none", "--traceFormat=none", "--interval=0.001"},
+     {{"numPackets", 1000, ""}}},
+    {"mesh-routing-analysis", {"--animMode=none", "--traceFormat=none"},
+     {{"simTime", 20, ""}, {"rows", 3, ""}, {"cols", 3, ""}}},
+    {"netanim-exercise", {"--animMode=none", "--interval=0.001"}, {{"numPackets", 500, ""}}},
+    {"point-to-point-delay", {"--pcap=0", "--interval=0.001"}, {{"numPackets", 500, ""}}},
+};
+
+struct Measurement
+{
+    double wallSeconds = 0;
+    double events = 0;
+    double eventsPerSecond = 0;
+    double simPerWall = 0;
+    double maxRssKb = 0;
+    int runs = 0;
+    int failures = 0;
+};
+
+typedef pair<string, string> BenchKey; // scenario, scale
+
+static string
+FormatValue(double v)
+{
+    ostringstream os;
+    if (v == floor(v))
+    {
+        os << uint64_t(v);
+    }
+    else
+    {
+        os << v;
+    }
+    return os.str();
+}
+
+static map<BenchKey, Measurement>
+LoadBaseline(const string &path)
+{
+    map<BenchKey, Measurement> baseline;
+    ifstream in(path);
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        istringstream fields(line);
+        string scenario;
+        string scale;
+        Measurement m;
+        if (fields >> scenario >> scale >> m.wallSeconds >> m.events >> m.eventsPerSecond >>
+            m.simPerWall >> m.maxRssKb)
+        {
+            baseline[BenchKey(scenario, scale)] = m;
+        }
+    }
+    return baseline;
+}
+
+int main(int argc, char *argv[])
+{
+    string binaryPattern = "build/scratch/ns3-dev-%s-default";
+    string scenarioList = "all";
+    string scaleList = "1,2,4";
+    uint32_t runs = 3;
+    unsigned jobs = 1;
+    string baselineFile = "scratch/scenario-bench.baseline";
+    bool update = false;
+    double timeTolerance = 0.10;
+    double rssTolerance = 0.10;
+    double eventTolerance = 0.01;
+    string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binaryPattern", "Scenario executable path, %s is replaced by the scenario name", binaryPattern);
+    cmd.AddValue("scenarios", "Comma-separated scenario names, or all", scenarioList);
+    cmd.AddValue("scales", "Comma-separated scale factors", scaleList);
+    cmd.AddValue("runs", "Repetitions per point; the fastest is kept", runs);
+    cmd.AddValue("jobs", "Parallel runs (1 keeps timings free of contention)", jobs);
+    cmd.AddValue("baseline", "Baseline file", baselineFile);
+    cmd.AddValue("update", "Write this run as the new baseline instead of comparing", update);
+    cmd.AddValue("timeTolerance", "Allowed relative wall time increase", timeTolerance);
+    cmd.AddValue("rssTolerance", "Allowed relative peak RSS increase", rssTolerance);
+    cmd.AddValue("eventTolerance", "Allowed relative change of the event count", eventTolerance);
+    cmd.AddValue("output", "CSV file for the results", output);
+    cmd.Parse(argc, argv);
+
+    vector<string> wanted = SplitList(scenarioList);
+    vector<string> scales = SplitList(scaleList);
+
+    /* ---------- JOBS ---------- */
+    ProcessPool pool(jobs);
+    vector<BenchKey> jobKey;
+    vector<BenchKey> order;
+    for (const ScenarioSpec &spec : g_scenarios)
+    {
+        if (scenarioList != "all" && find(wanted.begin(), wanted.end(), spec.name) == wanted.end())
+        {
+            continue;
+        }
+        string binary = binaryPattern;
+        size_t at = binary.find("%s");
+        if (at != string::npos)
+        {
+            binary.replace(at, 2, spec.name);
+        }
+        for (const string &scale : scales)
+        {
+            double k = stod(scale);
+            vector<string> args = {binary, "--summary=1"};
+            args.insert(args.end(), spec.fixedArgs.begin(), spec.fixedArgs.end());
+            for (const ScaleParam &p : spec.scaled)
+            {
+                double v = p.base * k;
+                if (p.unit.empty() && p.name != "simTime")
+                {
+                    v = max(1.0, round(v)); // counts stay integral
+                }
+                args.push_back("--" + p.name + "=" + FormatValue(v) + p.unit);
+            }
+            order.push_back(BenchKey(spec.name, scale));
+            for (uint32_t r = 0; r < runs; r++)
+            {
+                pool.Submit(args);
+                jobKey.push_back(order.back());
+            }
+        }
+    }
+    if (order.empty())
+    {
+        cerr << "No scenario matches --scenarios=" << scenarioList << endl;
+        return 1;
+    }
+
+    /* ---------- RUN ---------- */
+    map<BenchKey, Measurement> results;
+    size_t done = 0;
+    pool.Wait([&](size_t index, const ProcessResult &result) {
+        Measurement &m = results[jobKey[index]];
+        SummaryLine run = FindSummary(ParseSummary(result.output), "scope", "run");
+        // A result-cache replay measured nothing
+        if (result.status != 0 || run.empty() || run.count("cached"))
+        {
+            m.failures++;
+        }
+        else
+        {
+            double wall = stod(run["wallSeconds"]);
+            // Keep the fastest repetition; RSS is the largest seen
+            if (m.runs == 0 || wall < m.wallSeconds)
+            {
+                m.wallSeconds = wall;
+                m.events = stod(run["events"]);
+                m.eventsPerSecond = stod(run["eventsPerSecond"]);
+                m.simPerWall = stod(run["simPerWall"]);
+            }
+            m.maxRssKb = max(m.maxRssKb, double(result.maxRssKb));
+            m.runs++;
+        }
+        cerr << "\r" << ++done << "/" << jobKey.size() << " runs done" << flush;
+    });
+    cerr << "\n";
+
+    /* ---------- COMPARE ---------- */
+    map<BenchKey, Measurement> baseline;
+    if (!update)
+    {
+        baseline = LoadBaseline(baselineFile);
+        if (baseline.empty())
+        {
+            cerr << "No baseline in " << baselineFile << "; run with --update to record one\n";
+        }
+    }
+
+    ofstream csv;
+    if (!output.empty())
+    {
+        csv.open(output);
+        csv << "scenario,scale,wallSeconds,events,eventsPerSecond,simPerWall,maxRssKb,"
+               "baseWallSeconds,baseMaxRssKb,status\n";
+    }
+
+    cout << left << setw(26) << "scenario" << setw(6) << "k"
+         << setw(10) << "wall(s)" << setw(12) << "events"
+         << setw(12) << "events/s" << setw(11) << "sim/wall"
+         << setw(10) << "RSS(MB)" << setw(10) << "vs base" << "status\n";
+
+    uint32_t regressions = 0;
+    for (const BenchKey &key : order)
+    {
+        const Measurement &m = results[key];
+        string status = "ok";
+        double ratio = 0;
+        auto b = baseline.find(key);
+        // One failed repetition fails the point, even if others succeeded
+        if (m.failures > 0)
+        {
+            status = "FAILED (" + to_string(m.failures) + "/" + to_string(m.failures + m.runs) +
+                     " runs)";
+            regressions++;
+        }
+        else if (b != baseline.end())
+        {
+            const Measurement &base = b->second;
+            ratio = base.wallSeconds > 0 ? m.wallSeconds / base.wallSeconds : 0;
+            vector<string> problems;
+            if (base.events > 0 && fabs(m.events / base.events - 1) > eventTolerance)
+            {
+                problems.push_back("events changed");
+            }
+            if (ratio > 1 + timeTolerance)
+            {
+                problems.push_back("slower");
+            }
+            if (base.maxRssKb > 0 && m.maxRssKb > base.maxRssKb * (1 + rssTolerance))
+            {
+                problems.push_back("more memory");
+            }
+            if (!problems.empty())
+            {
+                status = "REGRESSION:";
+                for (const string &p : problems)
+                {
+                    status += " " + p;
+                }
+                regressions++;
+            }
+        }
+        else if (!update)
+        {
+            status = "no baseline";
+        }
+
+        ostringstream vsBase;
+        if (ratio > 0)
+        {
+            vsBase << fixed << setprecision(2) << ratio << "x";
+        }
+        else
+        {
+            vsBase << "-";
+        }
+
+        cout << left << setw(26) << key.first << setw(6) << key.second << fixed
+             << setprecision(3) << setw(10) << m.wallSeconds << setprecision(0)
+             << setw(12) << m.events << setw(12) << m.eventsPerSecond << setprecision(1)
+             << setw(11) << m.simPerWall << setw(10) << m.maxRssKb / 1024
+             << setw(10) << vsBase.str() << defaultfloat << status << "\n";
+
+        if (csv.is_open())
+        {
+            csv << key.first << ',' << key.second << ',' << m.wallSeconds << ',' << m.events
+                << ',' << m.eventsPerSecond << ',' << m.simPerWall << ',' << m.maxRssKb << ','
+                << (b != baseline.end() ? b->second.wallSeconds : 0) << ','
+                << (b != baseline.end() ? b->second.maxRssKb : 0) << ',' << status << '\n';
+        }
+    }
+
+    /* ---------- BASELINE ---------- */
+    if (update)
+    {
+        ofstream out(baselineFile);
+        out << "# scenario k wallSeconds events eventsPerSecond simPerWall maxRssKb\n";
+        for (const BenchKey &key : order)
+        {
+            const Measurement &m = results[key];
+            if (m.runs > 0 && m.failures == 0)
+            {
+                out << key.first << ' ' << key.second << ' ' << m.wallSeconds << ' '
+                    << uint64_t(m.events) << ' ' << m.eventsPerSecond << ' ' << m.simPerWall
+                    << ' ' << uint64_t(m.maxRssKb) << '\n';
+            }
+        }
+        cout << "Baseline written to " << baselineFile << "\n";
+        return regressions > 0 ? 1 : 0;
+    }
+
+    if (regressions > 0)
+    {
+        cout << regressions << " failed or regressed point(s) against " << baselineFile << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Event scheduler benchmark: built-in schedulers against LadderScheduler.
+ *
+ * Two measurements:
+ *
+ *  1. Scenario runs. Every scenario binary is run once per scheduler and
+ *     repetition (--SchedulerType=<type> --summary=1 plus --args), one at
+ *     a time so the timings do not compete for cores. Events per second
+ *     comes from each run's "SUMMARY scope=run" line.
+ *
+ *  2. A hold model inside this process. The queue is filled with --holdSize
+ *     events, then --holdOps times the earliest event is removed and one is
+ *     inserted at now + a CBR increment. The increments are the 1472-byte
+ *     serialization times at 20 and 5 Mbps and the 2 / 10 ms propagation
+ *     delays of the scenarios. This isolates scheduler cost from model cost.
+ *
+ * Usage:
+ *    ./ns3 build queuedelay tcpvsudp scheduler-bench
+ *    ./ns3 run "scheduler-bench
+ *               --binaries=build/scratch/ns3-dev-queuedelay-default,build/scratch/ns3-dev-tcpvsudp-default
+ *               --runs=3 --output=scratch/scheduler-bench.csv"
+ */
+
+#include "ladder-scheduler.h"
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace ns3;
+using namespace std;
+
+struct BenchResult
+{
+    string scenario;
+    string scheduler;
+    double events = 0;
+    double wallSeconds = 0;
+    double eventsPerSecond = 0;
+    int failures = 0;
+    int runs = 0;
+};
+
+// Events per second of one scheduler in the hold model
+static double
+HoldModel(const string &type, uint32_t size, uint64_t ops)
+{
+    ObjectFactory factory;
+    factory.SetTypeId(type);
+    Ptr<Scheduler> scheduler = factory.Create<Scheduler>();
+
+    const uint64_t increments[] = {588800, 2355200, 2000000, 10000000};
+    mt19937_64 rng(1);
+    uint32_t uid = 0;
+    Scheduler::Event ev;
+    ev.impl = nullptr;
+    ev.key.m_context = 0;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        ev.key.m_ts = rng() % 10000000;
+        ev.key.m_uid = uid++;
+        scheduler->Insert(ev);
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; i++)
+    {
+        Scheduler::Event next = scheduler->RemoveNext();
+        ev.key.m_ts = next.key.m_ts + increments[rng() & 3] + (rng() & 1023);
+        ev.key.m_uid = uid++;
+        scheduler->Insert(ev);
+    }
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    while (!scheduler->IsEmpty())
+    {
+        scheduler->RemoveNext();
+    }
+    return wall > 0 ? ops / wall : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    string binaries = "";
+    string schedulers = "ns3::MapScheduler,ns3::HeapScheduler,ns3::CalendarScheduler,"
+                        "ns3::PriorityQueueScheduler,ns3::LadderScheduler";
+    string args = "--animMode=none";
+    uint32_t runs = 3;
+    uint32_t holdSize = 10000;
+    uint64_t holdOps = 5000000;
+    string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binaries", "Comma-separated scenario executables (empty = hold model only)", binaries);
+    cmd.AddValue("schedulers", "Comma-separated scheduler TypeIds", schedulers);
+    cmd.AddValue("args", "Space-separated extra arguments for every scenario run", args);
+    cmd.AddValue("runs", "Repetitions per scenario and scheduler", runs);
+    cmd.AddValue("holdSize", "Pending events in the hold model (0 = skip)", holdSize);
+    cmd.AddValue("holdOps", "Remove/insert pairs in the hold model", holdOps);
+    cmd.AddValue("output", "CSV file for the results", output);
+    cmd.Parse(argc, argv);
+
+    vector<string> types = SplitList(schedulers);
+    vector<string> extra = SplitList(args, ' ');
+    vector<BenchResult> results;
+
+    /* ---------- HOLD MODEL ---------- */
+    if (holdSize > 0)
+    {
+        for (const string &type : types)
+        {
+            BenchResult r;
+            r.scenario = "hold-" + to_string(holdSize);
+            r.scheduler = type;
+            r.events = holdOps;
+            r.eventsPerSecond = HoldModel(type, holdSize, holdOps);
+            r.wallSeconds = r.eventsPerSecond > 0 ? holdOps / r.eventsPerSecond : 0;
+            r.runs = 1;
+            results.push_back(r);
+            cerr << type << " hold model done\n";
+        }
+    }
+
+    /* ---------- SCENARIO RUNS ---------- */
+    ProcessPool pool(1);
+    vector<size_t> jobResult;
+    for (const string &binary : SplitList(binaries))
+    {
+        string scenario = binary.substr(binary.find_last_of('/') + 1);
+        for (const string &type : types)
+        {
+            BenchResult r;
+            r.scenario = scenario;
+            r.scheduler = type;
+            results.push_back(r);
+            for (uint32_t i = 0; i < runs; i++)
+            {
+                vector<string> argv = {binary, "--SchedulerType=" + type, "--summary=1"};
+                argv.insert(argv.end(), extra.begin(), extra.end());
+                pool.Submit(argv);
+                jobResult.push_back(results.size() - 1);
+            }
+        }
+    }
+
+    size_t done = 0;
+    pool.Wait([&](size_t index, const ProcessResult &result) {
+        BenchResult &r = results[jobResult[index]];
+        SummaryLine run = FindSummary(ParseSummary(result.output), "scope", "run");
+        // A result-cache replay measured nothing
+        if (result.status != 0 || run.empty() || run.count("cached"))
+        {
+            r.failures++;
+        }
+        else
+        {
+            // Sum over repetitions; averaged below
+            r.events += stod(run["events"]);
+            r.wallSeconds += stod(run["wallSeconds"]);
+            r.runs++;
+        }
+        cerr << "\r" << ++done << "/" << jobResult.size() << " runs done" << flush;
+    });
+    if (!jobResult.empty())
+    {
+        cerr << "\n";
+    }
+
+    /* ---------- TABLE ---------- */
+    ofstream csv;
+    if (!output.empty())
+    {
+        csv.open(output);
+        csv << "scenario,scheduler,events,wallSeconds,eventsPerSecond,speedup,runs,failures\n";
+    }
+
+    cout << left << setw(34) << "scenario" << setw(28) << "scheduler"
+         << setw(12) << "events" << setw(10) << "wall(s)"
+         << setw(14) << "events/s" << "vs first\n";
+
+    double baseline = 0;
+    string baselineScenario;
+    for (BenchResult &r : results)
+    {
+        if (r.scenario.compare(0, 5, "hold-") != 0 && r.runs > 0)
+        {
+            r.events /= r.runs;
+            r.wallSeconds /= r.runs;
+            r.eventsPerSecond = r.wallSeconds > 0 ? r.events / r.wallSeconds : 0;
+        }
+        // Speedup is relative to the first scheduler listed for the same scenario
+        if (r.scenario != baselineScenario)
+        {
+            baselineScenario = r.scenario;
+            baseline = r.eventsPerSecond;
+        }
+        double speedup = baseline > 0 ? r.eventsPerSecond / baseline : 0;
+
+        cout << left << setw(34) << r.scenario << setw(28) << r.scheduler
+             << setw(12) << uint64_t(r.events) << fixed << setprecision(3)
+             << setw(10) << r.wallSeconds << setprecision(0)
+             << setw(14) << r.eventsPerSecond << setprecision(2)
+             << speedup << "x" << defaultfloat
+             << (r.failures ? "  (" + to_string(r.failures) + " failed)" : "") << "\n";
+
+        if (csv.is_open())
+        {
+            csv << r.scenario << ',' << r.scheduler << ',' << uint64_t(r.events) << ','
+                << r.wallSeconds << ',' << r.eventsPerSecond << ',' << speedup << ','
+                << r.runs << ',' << r.failures << '\n';
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * High-rate spoofed-source traffic generator.
+ *
+ * A self-scheduling Application that emits IPv4/UDP-protocol packets with
+ * forged source addresses at a configured rate. One event emits a whole
+ * batch; every packet is a copy-on-write copy of one payload template and
+ * goes straight to Ipv4::SendWithHeader over a cached route, so there is no
+ * socket and no per-packet Simulator::Schedule. Packets of one batch leave
+ * at the same instant, so BatchSize trades inter-packet timing for events.
+ *
+ * Source distributions:
+ *    SameSubnet  random host inside the attacker's own subnet
+ *    Random8     random host inside SourcePrefix/8
+ *    List        round-robin over addresses given with AddSource()
+ */
+
+#ifndef SPOOF_GENERATOR_H
+#define SPOOF_GENERATOR_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+class SpoofGenerator : public Application
+{
+  public:
+    enum SourceMode
+    {
+        SAME_SUBNET,
+        RANDOM_8,
+        LIST
+    };
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::SpoofGenerator")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<SpoofGenerator>()
+                .AddAttribute("Remote",
+                              "Victim address",
+                              Ipv4AddressValue(),
+                              MakeIpv4AddressAccessor(&SpoofGenerator::m_remote),
+                              MakeIpv4AddressChecker())
+                .AddAttribute("PacketRate",
+                              "Packets per second",
+                              DoubleValue(1000),
+                              MakeDoubleAccessor(&SpoofGenerator::m_rate),
+                              MakeDoubleChecker<double>(1))
+                .AddAttribute("BatchSize",
+                              "Packets emitted per scheduled event",
+                              UintegerValue(64),
+                              MakeUintegerAccessor(&SpoofGenerator::m_batch),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("PacketSize",
+                              "Payload size in bytes",
+                              UintegerValue(512),
+                              MakeUintegerAccessor(&SpoofGenerator::m_size),
+                              MakeUintegerChecker<uint32_t>())
+                .AddAttribute("Protocol",
+                              "IP protocol number written into the header",
+                              UintegerValue(17),
+                              MakeUintegerAccessor(&SpoofGenerator::m_protocol),
+                              MakeUintegerChecker<uint8_t>())
+                .AddAttribute("SourceMode",
+                              "Distribution of forged source addresses",
+                              EnumValue(SpoofGenerator::SAME_SUBNET),
+                              MakeEnumAccessor(&SpoofGenerator::m_mode),
+                              MakeEnumChecker(SpoofGenerator::SAME_SUBNET, "SameSubnet",
+                                              SpoofGenerator::RANDOM_8, "Random8",
+                                              SpoofGenerator::LIST, "List"))
+                .AddAttribute("SourcePrefix",
+                              "Network used by the Random8 mode (only the first octet counts)",
+                              Ipv4AddressValue("10.0.0.0"),
+                              MakeIpv4AddressAccessor(&SpoofGenerator::m_prefix8),
+                              MakeIpv4AddressChecker())
+                .AddAttribute("MaxPackets",
+                              "Stop after this many packets (0 = unlimited)",
+                              UintegerValue(0),
+                              MakeUintegerAccessor(&SpoofGenerator::m_maxPackets),
+                              MakeUintegerChecker<uint64_t>())
+                .AddTraceSource("Tx",
+                                "A spoofed packet is sent",
+                                MakeTraceSourceAccessor(&SpoofGenerator::m_txTrace),
+                                "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    SpoofGenerator()
+    {
+        m_random = CreateObject<UniformRandomVariable>();
+    }
+
+    void AddSource(Ipv4Address source)
+    {
+        m_sources.push_back(source.Get());
+    }
+
+    int64_t AssignStreams(int64_t stream) override
+    {
+        m_random->SetStream(stream);
+        return 1;
+    }
+
+    uint64_t GetSent() const
+    {
+        return m_sent;
+    }
+
+    // Scheduled events so far; at most ceil(rate / batch) per simulated second
+    uint64_t GetEvents() const
+    {
+        return m_events;
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_ipv4 = nullptr;
+        m_route = nullptr;
+        m_template = nullptr;
+        m_random = nullptr;
+        Application::DoDispose();
+    }
+
+  private:
+    void StartApplication() override
+    {
+        m_ipv4 = GetNode()->GetObject<Ipv4>();
+
+        // One route lookup for the whole run
+        Ipv4Header probe;
+        probe.SetDestination(m_remote);
+        probe.SetProtocol(m_protocol);
+        Socket::SocketErrno err;
+        m_route = m_ipv4->GetRoutingProtocol()->RouteOutput(nullptr, probe, nullptr, err);
+        NS_ABORT_MSG_IF(!m_route, "SpoofGenerator: no route to " << m_remote);
+
+        Ipv4InterfaceAddress local =
+            m_ipv4->GetAddress(m_ipv4->GetInterfaceForDevice(m_route->GetOutputDevice()), 0);
+        m_subnet = local.GetLocal().CombineMask(local.GetMask()).Get();
+        m_hostMask = ~local.GetMask().Get();
+        NS_ABORT_MSG_IF(m_mode == SAME_SUBNET && local.GetMask().GetPrefixLength() >= 31,
+                        "SpoofGenerator: SameSubnet needs a /30 or wider subnet, not /"
+                            << local.GetMask().GetPrefixLength());
+
+        m_template = Create<Packet>(m_size);
+        m_header.SetDestination(m_remote);
+        m_header.SetProtocol(m_protocol);
+        m_header.SetPayloadSize(m_size);
+        m_header.SetTtl(64);
+
+        m_interval = Seconds(m_batch / m_rate);
+        m_event = Simulator::ScheduleNow(&SpoofGenerator::SendBatch, this);
+    }
+
+    void StopApplication() override
+    {
+        Simulator::Cancel(m_event);
+    }
+
+    uint32_t NextSource()
+    {
+        switch (m_mode)
+        {
+        case RANDOM_8:
+            return (m_prefix8.Get() & 0xff000000) | m_random->GetInteger(1, 0x00fffffe);
+        case LIST: {
+            NS_ABORT_MSG_IF(m_sources.empty(), "SpoofGenerator: List mode without sources");
+            uint32_t source = m_sources[m_nextSource];
+            m_nextSource = (m_nextSource + 1) % m_sources.size();
+            return source;
+        }
+        case SAME_SUBNET:
+        default:
+            return m_subnet | m_random->GetInteger(1, m_hostMask - 1);
+        }
+    }
+
+    void SendBatch()
+    {
+        m_events++;
+        for (uint32_t i = 0; i < m_batch; i++)
+        {
+            if (m_maxPackets && m_sent >= m_maxPackets)
+            {
+                return;
+            }
+            Ptr<Packet> p = m_template->Copy();
+            m_header.SetSource(Ipv4Address(NextSource()));
+            m_header.SetIdentification(uint16_t(m_sent));
+            m_txTrace(p);
+            m_ipv4->SendWithHeader(p, m_header, m_route);
+            m_sent++;
+        }
+        m_event = Simulator::Schedule(m_interval, &SpoofGenerator::SendBatch, this);
+    }
+
+    Ipv4Address m_remote;
+    double m_rate;
+    uint32_t m_batch;
+    uint32_t m_size;
+    uint8_t m_protocol;
+    SourceMode m_mode;
+    Ipv4Address m_prefix8;
+    uint64_t m_maxPackets;
+
+    Ptr<Ipv4> m_ipv4;
+    Ptr<Ipv4Route> m_route;
+    Ptr<Packet> m_template;
+    Ipv4Header m_header;
+    Ptr<UniformRandomVariable> m_random;
+    std::vector<uint32_t> m_sources;
+    size_t m_nextSource = 0;
+    uint32_t m_subnet = 0;
+    uint32_t m_hostMask = 0;
+    Time m_interval;
+    EventId m_event;
+    uint64_t m_sent = 0;
+    uint64_t m_events = 0;
+    TracedCallback<Ptr<const Packet>> m_txTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(SpoofGenerator);
+
+} // namespace ns3
+
+#endif /* SPOOF_GENERATOR_H */
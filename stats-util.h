@@ -0,0 +1,205 @@
+/*
+ * Output analysis for simulation time series and replications.
+ *
+ *    StudentT975(df)          two-sided 95% Student t quantile
+ *    MeanCi(values)           mean and 95% CI half-width of iid values
+ *    RunningStats             the same, one value at a time (Welford)
+ *    MserTruncation(series)   warm-up length by MSER-5 (White, 1997)
+ *    BatchMeansCi(series, k)  mean and 95% CI from k non-overlapping batch means
+ *
+ * MSER picks the truncation point d that minimises the standard error of
+ * the mean of what is left:
+ *
+ *    MSER(d) = sum_{i >= d} (x_i - mean_d)^2 / (n - d)^2
+ *
+ * over the means of batches of 5 observations, searching the first half of
+ * the series only (a minimum near the end just means too little data).
+ */
+
+#ifndef STATS_UTIL_H
+#define STATS_UTIL_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+struct ConfidenceInterval
+{
+    double mean = 0;
+    double halfWidth = 0; // 95%, infinite with fewer than two values
+    uint32_t n = 0;
+
+    double GetRelativeHalfWidth() const
+    {
+        return mean != 0 ? halfWidth / std::fabs(mean) : (halfWidth == 0 ? 0 : INFINITY);
+    }
+};
+
+inline double
+StudentT975(uint32_t df)
+{
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                   2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                   2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                   2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df == 0)
+    {
+        return INFINITY;
+    }
+    if (df <= 30)
+    {
+        return table[df - 1];
+    }
+    // Cornish-Fisher expansion around the normal quantile
+    const double z = 1.959964;
+    return z + (z * z * z + z) / (4.0 * df);
+}
+
+inline ConfidenceInterval
+MeanCi(const std::vector<double>& values)
+{
+    ConfidenceInterval ci;
+    ci.n = values.size();
+    if (ci.n == 0)
+    {
+        ci.halfWidth = INFINITY;
+        return ci;
+    }
+    double sum = 0;
+    for (double v : values)
+    {
+        sum += v;
+    }
+    ci.mean = sum / ci.n;
+    if (ci.n < 2)
+    {
+        ci.halfWidth = INFINITY;
+        return ci;
+    }
+    double ss = 0;
+    for (double v : values)
+    {
+        ss += (v - ci.mean) * (v - ci.mean);
+    }
+    ci.halfWidth = StudentT975(ci.n - 1) * std::sqrt(ss / (ci.n - 1) / ci.n);
+    return ci;
+}
+
+// Mean and variance of a stream of iid values without storing them
+class RunningStats
+{
+  public:
+    void Add(double x)
+    {
+        m_n++;
+        double d = x - m_mean;
+        m_mean += d / m_n;
+        m_m2 += d * (x - m_mean);
+    }
+
+    uint32_t GetN() const
+    {
+        return m_n;
+    }
+
+    double GetMean() const
+    {
+        return m_mean;
+    }
+
+    double GetVariance() const
+    {
+        return m_n > 1 ? m_m2 / (m_n - 1) : 0;
+    }
+
+    // Same as MeanCi() over the values added so far
+    ConfidenceInterval GetCi() const
+    {
+        ConfidenceInterval ci;
+        ci.n = m_n;
+        ci.mean = m_mean;
+        ci.halfWidth = m_n < 2 ? INFINITY : StudentT975(m_n - 1) * std::sqrt(GetVariance() / m_n);
+        return ci;
+    }
+
+  private:
+    uint32_t m_n = 0;
+    double m_mean = 0;
+    double m_m2 = 0;
+};
+
+// Number of leading observations to discard as warm-up
+inline size_t
+MserTruncation(const std::vector<double>& series, uint32_t batch = 5)
+{
+    size_t m = series.size() / batch;
+    if (m < 2)
+    {
+        return 0;
+    }
+    std::vector<double> means(m);
+    for (size_t b = 0; b < m; b++)
+    {
+        double s = 0;
+        for (uint32_t j = 0; j < batch; j++)
+        {
+            s += series[b * batch + j];
+        }
+        means[b] = s / batch;
+    }
+
+    // Suffix sums make every candidate d O(1)
+    std::vector<double> sum(m + 1, 0);
+    std::vector<double> sumSq(m + 1, 0);
+    for (size_t i = m; i-- > 0;)
+    {
+        sum[i] = sum[i + 1] + means[i];
+        sumSq[i] = sumSq[i + 1] + means[i] * means[i];
+    }
+    size_t best = 0;
+    double bestValue = INFINITY;
+    for (size_t d = 0; d <= m / 2; d++)
+    {
+        double k = m - d;
+        double mean = sum[d] / k;
+        double value = (sumSq[d] - k * mean * mean) / (k * k);
+        if (value < bestValue)
+        {
+            bestValue = value;
+            best = d;
+        }
+    }
+    return best * batch;
+}
+
+// Batch means over series[from..]; the last partial batch is dropped
+inline ConfidenceInterval
+BatchMeansCi(const std::vector<double>& series, uint32_t nBatches, size_t from = 0)
+{
+    size_t n = series.size() > from ? series.size() - from : 0;
+    size_t size = nBatches > 0 ? n / nBatches : 0;
+    if (size == 0)
+    {
+        ConfidenceInterval ci;
+        ci.halfWidth = INFINITY;
+        return ci;
+    }
+    std::vector<double> means(nBatches);
+    for (uint32_t b = 0; b < nBatches; b++)
+    {
+        double s = 0;
+        for (size_t j = 0; j < size; j++)
+        {
+            s += series[from + b * size + j];
+        }
+        means[b] = s / size;
+    }
+    return MeanCi(means);
+}
+
+} // namespace ns3
+
+#endif /* STATS_UTIL_H */
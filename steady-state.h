@@ -0,0 +1,314 @@
+/*
+ * Online steady-state detection with early termination.
+ *
+ * SteadyStateMonitor reads the FlowMonitor counters every window (100 ms by
+ * default). For each tracked flow it appends one observation per metric:
+ *
+ *    throughput   delivered bits / window                 relative CI
+ *    delay        mean one-way delay of the window's packets relative CI
+ *    loss         drops / packets sent in the window       absolute CI
+ *
+ * Losses come from the flow probes' drop counters, which are updated as
+ * packets are dropped, so no CheckForLostPackets() call is needed.
+ *
+ * After each window every series is cut by MSER-5 (see stats-util.h), and
+ * a batch-means 95% confidence interval is computed over the rest. Once
+ * every series of every tracked flow meets its tolerance, the monitor calls
+ * Simulator::Stop(). The warm-up cutoff and the achieved interval are
+ * reported per flow and metric.
+ *
+ * Usage:
+ *    SteadyStateMonitor steady;
+ *    steady.SetTolerance(0.05);           // relative half-width
+ *    steady.SetPorts({9000});             // data flows only (default all)
+ *    steady.Install(monitor, classifier, Seconds(1.0));
+ *    Simulator::Stop(Seconds(simTime));   // still the upper bound
+ *    Simulator::Run();
+ *    steady.Print(std::cout);
+ *    steady.PrintSummary(std::cout);      // SUMMARY scope=steady ...
+ */
+
+#ifndef STEADY_STATE_H
+#define STEADY_STATE_H
+
+#include "stats-util.h"
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class SteadyStateMonitor
+{
+  public:
+    enum Metric
+    {
+        THROUGHPUT,
+        DELAY,
+        LOSS,
+        N_METRICS
+    };
+
+    struct Estimate
+    {
+        Time warmup;            // end of the truncated warm-up
+        ConfidenceInterval ci;  // over the observations after it
+        bool converged = false;
+    };
+
+    void SetWindow(Time window)
+    {
+        NS_ABORT_MSG_UNLESS(window.IsStrictlyPositive(), "Steady-state window must be positive");
+        m_window = window;
+    }
+
+    // Relative CI half-width for throughput and delay
+    void SetTolerance(double tolerance)
+    {
+        m_tolerance = tolerance;
+    }
+
+    // Absolute CI half-width for the loss ratio
+    void SetLossTolerance(double tolerance)
+    {
+        m_lossTolerance = tolerance;
+    }
+
+    // Comma-separated subset of throughput,delay,loss
+    void SetMetrics(const std::string& list)
+    {
+        static const char* names[] = {"throughput", "delay", "loss"};
+        for (uint32_t m = 0; m < N_METRICS; m++)
+        {
+            m_enabled[m] = ("," + list + ",").find(std::string(",") + names[m] + ",") != std::string::npos;
+        }
+    }
+
+    // Observations per series before a stop is considered
+    void SetMinSamples(uint32_t samples)
+    {
+        m_minSamples = samples;
+    }
+
+    void SetBatches(uint32_t batches)
+    {
+        m_batches = batches;
+    }
+
+    // Destination ports of the flows to track; empty tracks every flow
+    void SetPorts(const std::set<uint16_t>& ports)
+    {
+        m_ports = ports;
+    }
+
+    // Samples from start on; with stop == false the monitor only reports
+    void Install(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Time start,
+                 bool stop = true)
+    {
+        m_monitor = monitor;
+        m_classifier = classifier;
+        m_stop = stop;
+        Simulator::Schedule(start + m_window - Simulator::Now(), &SteadyStateMonitor::Sample, this);
+    }
+
+    bool IsConverged() const
+    {
+        return !m_convergedAt.IsNegative();
+    }
+
+    // First time every series was within tolerance (the stop time when
+    // stopping), negative if the run never converged
+    Time GetConvergenceTime() const
+    {
+        return m_convergedAt;
+    }
+
+    // Latest estimates; only enabled metrics of tracked flows are present
+    const std::map<FlowId, std::map<Metric, Estimate>>& GetEstimates() const
+    {
+        return m_estimates;
+    }
+
+    void Print(std::ostream& os) const
+    {
+        static const char* names[] = {"throughput (Mbps)", "delay (s)", "loss ratio"};
+        os << "Steady state: "
+           << (IsConverged() ? "converged at " + std::to_string(m_convergedAt.GetSeconds()) + " s"
+                             : std::string("not converged"))
+           << " (" << m_windows << " windows of " << m_window.GetMilliSeconds() << " ms)\n";
+        for (const auto& flow : m_estimates)
+        {
+            for (const auto& e : flow.second)
+            {
+                os << "  Flow " << flow.first << " " << names[e.first] << ": "
+                   << e.second.ci.mean << " +/- " << e.second.ci.halfWidth
+                   << " after warm-up to " << e.second.warmup.GetSeconds() << " s"
+                   << (e.second.converged ? "" : " (not within tolerance)") << "\n";
+            }
+        }
+    }
+
+    void PrintSummary(std::ostream& os) const
+    {
+        static const char* names[] = {"throughput", "delay", "loss"};
+        Time warmup;
+        double worst = 0;
+        for (const auto& flow : m_estimates)
+        {
+            for (const auto& e : flow.second)
+            {
+                warmup = std::max(warmup, e.second.warmup);
+                if (e.first != LOSS)
+                {
+                    worst = std::max(worst, e.second.ci.GetRelativeHalfWidth());
+                }
+                os << "SUMMARY scope=steadyFlow flow=" << flow.first
+                   << " metric=" << names[e.first]
+                   << " warmup=" << e.second.warmup.GetSeconds()
+                   << " mean=" << e.second.ci.mean
+                   << " halfWidth=" << e.second.ci.halfWidth
+                   << " converged=" << e.second.converged << "\n";
+            }
+        }
+        os << "SUMMARY scope=steady"
+           << " converged=" << IsConverged()
+           << " convergedAt=" << m_convergedAt.GetSeconds()
+           << " stopTime=" << (IsConverged() && m_stop ? m_convergedAt.GetSeconds() : Simulator::Now().GetSeconds())
+           << " warmup=" << warmup.GetSeconds()
+           << " windows=" << m_windows
+           << " maxRelHalfWidth=" << worst << "\n";
+    }
+
+  private:
+    struct FlowSeries
+    {
+        uint64_t txPackets = 0;
+        uint64_t rxPackets = 0;
+        uint64_t rxBytes = 0;
+        uint64_t drops = 0;
+        Time delaySum;
+        std::vector<double> values[N_METRICS];
+        std::vector<Time> times[N_METRICS];
+    };
+
+    void Sample()
+    {
+        m_windows++;
+        Time now = Simulator::Now();
+        for (const auto& entry : m_monitor->GetFlowStats())
+        {
+            const FlowMonitor::FlowStats& st = entry.second;
+            if (!m_ports.empty() &&
+                !m_ports.count(m_classifier->FindFlow(entry.first).destinationPort))
+            {
+                continue;
+            }
+            FlowSeries& s = m_series[entry.first];
+            uint64_t drops = 0;
+            for (uint32_t d : st.packetsDropped)
+            {
+                drops += d;
+            }
+            uint64_t tx = st.txPackets - s.txPackets;
+            uint64_t rx = st.rxPackets - s.rxPackets;
+            if (tx > 0 || !s.values[THROUGHPUT].empty())
+            {
+                Add(s, THROUGHPUT, now, (st.rxBytes - s.rxBytes) * 8.0 / m_window.GetSeconds() / 1e6);
+            }
+            if (rx > 0)
+            {
+                Add(s, DELAY, now, (st.delaySum - s.delaySum).GetSeconds() / rx);
+            }
+            if (tx > 0)
+            {
+                Add(s, LOSS, now, double(drops - s.drops) / tx);
+            }
+            s.txPackets = st.txPackets;
+            s.rxPackets = st.rxPackets;
+            s.rxBytes = st.rxBytes;
+            s.drops = drops;
+            s.delaySum = st.delaySum;
+        }
+
+        if (Evaluate())
+        {
+            if (!IsConverged())
+            {
+                m_convergedAt = now;
+            }
+            if (m_stop)
+            {
+                Simulator::Stop();
+                return;
+            }
+        }
+        Simulator::Schedule(m_window, &SteadyStateMonitor::Sample, this);
+    }
+
+    void Add(FlowSeries& s, Metric m, Time t, double value)
+    {
+        if (m_enabled[m])
+        {
+            s.values[m].push_back(value);
+            s.times[m].push_back(t);
+        }
+    }
+
+    // Updates every estimate; true if all of them are within tolerance
+    bool Evaluate()
+    {
+        bool all = !m_series.empty();
+        for (auto& entry : m_series)
+        {
+            for (uint32_t m = 0; m < N_METRICS; m++)
+            {
+                const std::vector<double>& v = entry.second.values[m];
+                if (!m_enabled[m])
+                {
+                    continue;
+                }
+                Estimate& e = m_estimates[entry.first][Metric(m)];
+                if (v.size() < m_minSamples)
+                {
+                    all = false;
+                    continue;
+                }
+                size_t cut = MserTruncation(v);
+                e.warmup = cut > 0 ? entry.second.times[m][cut - 1] : Time();
+                e.ci = BatchMeansCi(v, m_batches, cut);
+                e.converged = m == LOSS ? e.ci.halfWidth <= m_lossTolerance
+                                        : e.ci.GetRelativeHalfWidth() <= m_tolerance;
+                all = all && e.converged;
+            }
+        }
+        return all;
+    }
+
+    Time m_window = MilliSeconds(100);
+    double m_tolerance = 0.05;
+    double m_lossTolerance = 0.01;
+    uint32_t m_minSamples = 50;
+    uint32_t m_batches = 10;
+    bool m_enabled[N_METRICS] = {true, true, true};
+    std::set<uint16_t> m_ports;
+    bool m_stop = true;
+
+    Ptr<FlowMonitor> m_monitor;
+    Ptr<Ipv4FlowClassifier> m_classifier;
+    std::map<FlowId, FlowSeries> m_series;
+    std::map<FlowId, std::map<Metric, Estimate>> m_estimates;
+    uint64_t m_windows = 0;
+    Time m_convergedAt = Seconds(-1);
+};
+
+} // namespace ns3
+
+#endif /* STEADY_STATE_H */
@@ -0,0 +1,335 @@
+/*
+ * Decimated per-flow TCP state sampler.
+ *
+ * Finds the TCP sockets that BulkSendApplication / OnOffApplication create
+ * when they start, follows their cwnd, ssthresh, RTT, bytes-in-flight and
+ * retransmissions through trace sources (which only store the latest value),
+ * and records rows either every Interval or on every Decimation-th cwnd
+ * change. Rows are kept in memory as columns and written as one columnar
+ * file per run on Close().
+ *
+ * Usage:
+ *    TcpStateSampler sampler;
+ *    sampler.SetInterval(MilliSeconds(10));     // or Time(0) + SetDecimation(n)
+ *    sampler.Watch(bulkApps, Seconds(1.0));     // the apps' start time
+ *    Simulator::Run();
+ *    sampler.Close("scratch/tcp-samples.tcs");
+ *
+ * Decode with: ./ns3 run "trace-decode --input=scratch/tcp-samples.tcs"
+ */
+
+#ifndef TCP_SAMPLER_H
+#define TCP_SAMPLER_H
+
+#include "record-ring.h"
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+static const char TCP_SAMPLE_MAGIC[8] = {'T', 'C', 'P', 'S', 'M', 'P', '0', '1'};
+
+/* ---------- COLUMNAR FILE LAYOUT ----------
+ * RecordFileHeader (recordSize = 0)
+ * uint32 nFlows, then per flow: uint32 nodeId, uint32 appIndex
+ * uint64 nRows
+ * columns, each nRows values in this order:
+ *    int64 timeNs, uint32 flow, uint32 cwnd, uint32 ssthresh,
+ *    uint32 rttUs, uint32 bytesInFlight, uint32 retransmits
+ */
+struct TcpSampleColumns
+{
+    std::vector<int64_t> timeNs;
+    std::vector<uint32_t> flow;
+    std::vector<uint32_t> cwnd;
+    std::vector<uint32_t> ssthresh;
+    std::vector<uint32_t> rttUs;
+    std::vector<uint32_t> bytesInFlight;
+    std::vector<uint32_t> retransmits;
+
+    size_t GetN() const
+    {
+        return timeNs.size();
+    }
+};
+
+struct TcpSampleFlow
+{
+    uint32_t nodeId;
+    uint32_t appIndex;
+};
+
+template <typename T>
+inline bool ReadTcpSampleColumn(std::FILE* f, std::vector<T>* column, uint64_t n)
+{
+    column->resize(n);
+    return n == 0 || std::fread(column->data(), sizeof(T), n, f) == n;
+}
+
+// Reads a file written by TcpStateSampler::Close()
+inline bool LoadTcpSamples(const std::string& path,
+                           std::vector<TcpSampleFlow>* flows,
+                           TcpSampleColumns* columns)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        return false;
+    }
+    RecordFileHeader header;
+    uint32_t nFlows = 0;
+    uint64_t nRows = 0;
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 &&
+              std::memcmp(header.magic, TCP_SAMPLE_MAGIC, sizeof(header.magic)) == 0 &&
+              std::fread(&nFlows, sizeof(nFlows), 1, f) == 1;
+    if (ok)
+    {
+        flows->resize(nFlows);
+        ok = nFlows == 0 || std::fread(flows->data(), sizeof(TcpSampleFlow), nFlows, f) == nFlows;
+    }
+    ok = ok && std::fread(&nRows, sizeof(nRows), 1, f) == 1 &&
+         ReadTcpSampleColumn(f, &columns->timeNs, nRows) &&
+         ReadTcpSampleColumn(f, &columns->flow, nRows) &&
+         ReadTcpSampleColumn(f, &columns->cwnd, nRows) &&
+         ReadTcpSampleColumn(f, &columns->ssthresh, nRows) &&
+         ReadTcpSampleColumn(f, &columns->rttUs, nRows) &&
+         ReadTcpSampleColumn(f, &columns->bytesInFlight, nRows) &&
+         ReadTcpSampleColumn(f, &columns->retransmits, nRows);
+    std::fclose(f);
+    return ok;
+}
+
+class TcpStateSampler
+{
+  public:
+    // Sampling period; Time(0) switches to on-change sampling
+    void SetInterval(Time interval)
+    {
+        m_interval = interval;
+    }
+
+    // On-change mode keeps one row per n cwnd changes of a flow
+    void SetDecimation(uint32_t n)
+    {
+        m_decimation = n ? n : 1;
+    }
+
+    // Attaches to the sockets of apps once they have started at `start`
+    void Watch(ApplicationContainer apps, Time start)
+    {
+        for (uint32_t i = 0; i < apps.GetN(); i++)
+        {
+            Simulator::Schedule(start + NanoSeconds(1), &TcpStateSampler::Discover, this,
+                                apps.Get(i), 0);
+        }
+        if (!m_interval.IsZero() && !m_timer.IsRunning())
+        {
+            m_timer = Simulator::Schedule(start + m_interval, &TcpStateSampler::SampleAll, this);
+        }
+    }
+
+    uint32_t GetNFlows() const
+    {
+        return m_flows.size();
+    }
+
+    const TcpSampleColumns& GetColumns() const
+    {
+        return m_columns;
+    }
+
+    bool Close(const std::string& path)
+    {
+        Simulator::Cancel(m_timer);
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            return false;
+        }
+        RecordFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TCP_SAMPLE_MAGIC, sizeof(header.magic));
+        header.version = 1;
+        std::fwrite(&header, sizeof(header), 1, f);
+
+        uint32_t nFlows = m_flows.size();
+        std::fwrite(&nFlows, sizeof(nFlows), 1, f);
+        for (const Flow& flow : m_flows)
+        {
+            TcpSampleFlow ids = {flow.nodeId, flow.appIndex};
+            std::fwrite(&ids, sizeof(ids), 1, f);
+        }
+
+        uint64_t nRows = m_columns.GetN();
+        std::fwrite(&nRows, sizeof(nRows), 1, f);
+        WriteColumn(f, m_columns.timeNs);
+        WriteColumn(f, m_columns.flow);
+        WriteColumn(f, m_columns.cwnd);
+        WriteColumn(f, m_columns.ssthresh);
+        WriteColumn(f, m_columns.rttUs);
+        WriteColumn(f, m_columns.bytesInFlight);
+        WriteColumn(f, m_columns.retransmits);
+        return std::fclose(f) == 0;
+    }
+
+  private:
+    struct Flow
+    {
+        TcpStateSampler* sampler;
+        uint32_t index;
+        uint32_t nodeId;
+        uint32_t appIndex;
+        uint32_t cwnd = 0;
+        uint32_t ssthresh = 0;
+        uint32_t rttUs = 0;
+        uint32_t bytesInFlight = 0;
+        uint32_t retransmits = 0;
+        uint32_t changes = 0;
+        SequenceNumber32 highestTx;
+        bool sentData = false;
+
+        void Cwnd(uint32_t, uint32_t value)
+        {
+            cwnd = value;
+            if (sampler->m_interval.IsZero() && ++changes % sampler->m_decimation == 0)
+            {
+                sampler->Append(*this);
+            }
+        }
+
+        void Ssthresh(uint32_t, uint32_t value)
+        {
+            ssthresh = value;
+        }
+
+        void Rtt(Time, Time value)
+        {
+            rttUs = value.GetMicroSeconds();
+        }
+
+        void InFlight(uint32_t, uint32_t value)
+        {
+            bytesInFlight = value;
+        }
+
+        // A data segment at or below the highest sequence already sent is a retransmission
+        void Tx(Ptr<const Packet> p, const TcpHeader& h, Ptr<const TcpSocketBase>)
+        {
+            if (p->GetSize() == 0)
+            {
+                return;
+            }
+            SequenceNumber32 seq = h.GetSequenceNumber();
+            if (sentData && seq < highestTx)
+            {
+                retransmits++;
+            }
+            else
+            {
+                highestTx = seq + p->GetSize();
+                sentData = true;
+            }
+        }
+    };
+
+    void Discover(Ptr<Application> app, uint32_t attempt)
+    {
+        Ptr<Socket> socket;
+        if (Ptr<BulkSendApplication> bulk = DynamicCast<BulkSendApplication>(app))
+        {
+            socket = bulk->GetSocket();
+        }
+        else if (Ptr<OnOffApplication> onoff = DynamicCast<OnOffApplication>(app))
+        {
+            socket = onoff->GetSocket();
+        }
+
+        Ptr<TcpSocketBase> tcp = DynamicCast<TcpSocketBase>(socket);
+        if (!tcp)
+        {
+            // Not started yet, or not a TCP application
+            if (attempt < 100)
+            {
+                Simulator::Schedule(MilliSeconds(1), &TcpStateSampler::Discover, this, app,
+                                    attempt + 1);
+            }
+            return;
+        }
+
+        Flow flow;
+        flow.sampler = this;
+        flow.index = m_flows.size();
+        flow.nodeId = app->GetNode()->GetId();
+        flow.appIndex = AppIndex(app);
+        m_flows.push_back(flow);
+        Flow* f = &m_flows.back();
+
+        tcp->TraceConnectWithoutContext("CongestionWindow", MakeCallback(&Flow::Cwnd, f));
+        tcp->TraceConnectWithoutContext("SlowStartThreshold", MakeCallback(&Flow::Ssthresh, f));
+        tcp->TraceConnectWithoutContext("RTT", MakeCallback(&Flow::Rtt, f));
+        tcp->TraceConnectWithoutContext("BytesInFlight", MakeCallback(&Flow::InFlight, f));
+        tcp->TraceConnectWithoutContext("Tx", MakeCallback(&Flow::Tx, f));
+    }
+
+    static uint32_t AppIndex(Ptr<Application> app)
+    {
+        Ptr<Node> node = app->GetNode();
+        for (uint32_t i = 0; i < node->GetNApplications(); i++)
+        {
+            if (node->GetApplication(i) == app)
+            {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    void SampleAll()
+    {
+        for (const Flow& flow : m_flows)
+        {
+            Append(flow);
+        }
+        m_timer = Simulator::Schedule(m_interval, &TcpStateSampler::SampleAll, this);
+    }
+
+    void Append(const Flow& flow)
+    {
+        m_columns.timeNs.push_back(Simulator::Now().GetNanoSeconds());
+        m_columns.flow.push_back(flow.index);
+        m_columns.cwnd.push_back(flow.cwnd);
+        m_columns.ssthresh.push_back(flow.ssthresh);
+        m_columns.rttUs.push_back(flow.rttUs);
+        m_columns.bytesInFlight.push_back(flow.bytesInFlight);
+        m_columns.retransmits.push_back(flow.retransmits);
+    }
+
+    template <typename T>
+    static void WriteColumn(std::FILE* f, const std::vector<T>& column)
+    {
+        if (!column.empty())
+        {
+            std::fwrite(column.data(), sizeof(T), column.size(), f);
+        }
+    }
+
+    Time m_interval = MilliSeconds(10);
+    uint32_t m_decimation = 1;
+    EventId m_timer;
+    std::list<Flow> m_flows; // stable addresses for the bound callbacks
+    TcpSampleColumns m_columns;
+};
+
+} // namespace ns3
+
+#endif /* TCP_SAMPLER_H */
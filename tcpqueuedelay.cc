@@ -8,6 +8,18 @@
 #include "ns3/netanim-module.h"
 #include "ns3/traffic-control-module.h"
 
+#include "anim-recorder.h"
+#include "delay-sketch.h"
+#include "lazy-routing.h"
+#include "light-flow-monitor.h"
+#include "packet-pool.h"
+#include "queue-sojourn.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "topology-builder.h"
+#include "watchpoint.h"
+#include "warm-start.h"
+
 using namespace ns3;
 using namespace std;
 
@@ -33,72 +45,197 @@ QueueDiscDropTrace(Ptr<const QueueDiscItem> item)
     }
 }
 
-int
-main(int argc, char *argv[])
+/* ---------- WARM-START CHECK ---------- */
+// Reruns this scenario with branch 0's variant applied without forking and
+// compares its flow results with those of the branch
+bool
+CheckBranch(int argc, char *argv[], const WarmStartBrancher &brancher)
 {
-    CommandLine cmd;
-    cmd.Parse(argc, argv);
+    vector<string> args = {"/proc/self/exe"};
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]).compare(0, 13, "--checkBranch") != 0 &&
+            string(argv[i]).compare(0, 13, "--resultCache") != 0)
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    args.push_back("--coldBranch=0");
 
-    /* ---------- NODES ---------- */
-    NodeContainer clients, router, server;
-    clients.Create(2);
-    router.Create(1);
-    server.Create(1);
+    ProcessResult cold;
+    ProcessPool pool(1);
+    pool.Submit(args);
+    pool.Wait([&cold](size_t, const ProcessResult &r) { cold = r; });
 
-    /* ---------- MOBILITY ---------- */
-    MobilityHelper mobility;
-    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    mobility.InstallAll();
+    vector<string> branched = ResultLines(brancher.GetBranches().at(0).result.output, "Flow ");
+    vector<string> reference = ResultLines(cold.output, "Flow ");
+    if (cold.status != 0 || reference.empty())
+    {
+        cout << "Branch check: cold run failed (exit " << cold.status << ")\n";
+        return false;
+    }
+    auto diff = mismatch(branched.begin(), branched.end(), reference.begin(), reference.end());
+    if (diff.first == branched.end() && diff.second == reference.end())
+    {
+        cout << "Branch check: branch 0 matches the cold run (" << reference.size() << " lines)\n";
+        return true;
+    }
+    cout << "Branch check: branch 0 differs from the cold run\n"
+         << "  branch: " << (diff.first != branched.end() ? *diff.first : "<end>") << "\n"
+         << "  cold:   " << (diff.second != reference.end() ? *diff.second : "<end>") << "\n";
+    return false;
+}
 
-    /* ---------- LINKS ---------- */
-    PointToPointHelper accessLink;
-    accessLink.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
-    accessLink.SetChannelAttribute("Delay", StringValue("2ms"));
+int
+main(int argc, char *argv[])
+{
+    uint32_t nSenders = 2;
+    double simTime = 3.0;
+    string bottleneckRate = "5Mbps";
+    string routing = "global";
+    bool summary = false;
+    bool packetPool = false;
+    string animMode = "binary";
+    uint32_t animSample = 1;
+    double branchAt = 0;
+    string variants = "";
+    unsigned jobs = 0;
+    int coldBranch = -1;
+    bool checkBranch = false;
+    string flowMonitor = "full";
+    uint32_t flowSample = 1;
+    string flowOutput = "";
+    string queueStats = "bottleneck";
+    string watchList = "";
+    string resultCache = "";
 
-    PointToPointHelper bottleneck;
-    bottleneck.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
-    bottleneck.SetChannelAttribute("Delay", StringValue("10ms"));
+    CommandLine cmd;
+    cmd.AddValue("nSenders", "Number of TCP clients", nSenders);
+    cmd.AddValue("simTime", "Simulation duration (s); clients send from 1 s to simTime - 1 s", simTime);
+    cmd.AddValue("bottleneckRate", "Router-server data rate", bottleneckRate);
+    cmd.AddValue("routing", "Routing: global (full SPF at start) or lazy (on demand)", routing);
+    cmd.AddValue("summary", "Print a machine-readable SUMMARY line with event throughput", summary);
+    cmd.AddValue("animMode", "Animation output: xml, binary or none", animMode);
+    cmd.AddValue("animSample", "Record 1 in n packets in binary animation mode", animSample);
+    cmd.AddValue("packetPool", "Serve packet allocations from per-thread free lists", packetPool);
+    cmd.AddValue("branchAt", "Fork one process per variant at this time (s, 0 = no branching)", branchAt);
+    cmd.AddValue("variants",
+                 "Bottleneck variants for --branchAt, ';'-separated lists of "
+                 "qdisc=PfifoFast|Red,queueSize=,minTh=,maxTh=",
+                 variants);
+    cmd.AddValue("jobs", "Branches running at once (0 = one per core)", jobs);
+    cmd.AddValue("coldBranch", "Apply variant n at --branchAt in this process instead of forking (-1 = fork)", coldBranch);
+    cmd.AddValue("checkBranch", "Compare branch 0 with a run applying its variant without forking", checkBranch);
+    cmd.AddValue("flowMonitor", "Flow statistics: full (FlowMonitor) or light (edge probes only)", flowMonitor);
+    cmd.AddValue("flowSample", "Light flow monitor: time 1 in n packets per flow", flowSample);
+    cmd.AddValue("flowOutput", "Light flow monitor: binary result file (empty to disable)", flowOutput);
+    cmd.AddValue("queueStats", "Occupancy and sojourn statistics for the bottleneck, all or no queues", queueStats);
+    cmd.AddValue("watch",
+                 "Watchpoints, ';'-separated predicate[=value][:actions] with predicates firstDrop, queueAbove=n, cwndBelow=bytes "
+                 "and actions snapshot,quiet,stop",
+                 watchList);
+    cmd.AddValue("resultCache", "Directory of cached results; a known configuration is not re-run (empty = off)", resultCache);
+    cmd.Parse(argc, argv);
 
-    NetDeviceContainer d0r = accessLink.Install(clients.Get(0), router.Get(0));
-    NetDeviceContainer d1r = accessLink.Install(clients.Get(1), router.Get(0));
-    NetDeviceContainer drs = bottleneck.Install(router.Get(0), server.Get(0));
+    if (branchAt > 0)
+    {
+        // Branches would all write into the same animation file
+        animMode = "none";
+    }
 
-    /* ---------- INTERNET STACK ---------- */
-    InternetStackHelper stack;
-    stack.InstallAll();
+    // A branch check compares two real runs, so it never uses the cache
+    ResultCache cache(checkBranch ? "" : resultCache);
+    cache.SetFileOutput(!flowOutput.empty() || animMode != "none");
+    if (cache.Replay(argc, argv))
+    {
+        return 0;
+    }
 
-    /* ---------- IP ADDRESSING ---------- */
-    Ipv4AddressHelper address;
+    if (packetPool)
+    {
+        PacketPool::Enable();
+    }
 
-    address.SetBase("10.1.1.0", "255.255.255.0");
-    address.Assign(d0r);
+    /* ---------- TOPOLOGY ---------- */
+    // nSenders -- 100Mbps/2ms -- router -- bottleneckRate/10ms -- server
+    TopologyBuilder builder;
+    LazyGlobalRoutingHelper lazyRouting;
+    if (routing == "lazy")
+    {
+        builder.SetRoutingHelper(lazyRouting.GetListRouting());
+    }
+    Topology topo = builder.Dumbbell(nSenders, 1,
+                                     LinkSpec("100Mbps", "2ms"),
+                                     LinkSpec(bottleneckRate, "10ms"));
 
-    address.SetBase("10.1.2.0", "255.255.255.0");
-    address.Assign(d1r);
+    NodeContainer clients = topo.senders;
+    NodeContainer router = topo.routers;
+    NodeContainer server = topo.receivers;
+    NetDeviceContainer drs = topo.bottleneck;
+    Ipv4InterfaceContainer serverIf = topo.bottleneckIf;
 
-    address.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer serverIf = address.Assign(drs);
+    /* ---------- MOBILITY ---------- */
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.InstallAll();
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    if (routing == "global")
+    {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
     /* ---------- TRAFFIC CONTROL (CRITICAL FIX) ---------- */
-    TrafficControlHelper tch;
+    // Small FIFO queue to force drops, or a variant of it
+    auto bottleneckQdisc = [&bottleneckRate](const map<string, string> &v) {
+        auto get = [&v](const string &key, const string &base) {
+            auto it = v.find(key);
+            return it != v.end() ? it->second : base;
+        };
+        TrafficControlHelper tch;
+        string size = get("queueSize", "5p");
+        if (get("qdisc", "PfifoFast") == "Red")
+        {
+            tch.SetRootQueueDisc(
+                "ns3::RedQueueDisc",
+                "MinTh", DoubleValue(stod(get("minTh", "1"))),
+                "MaxTh", DoubleValue(stod(get("maxTh", "4"))),
+                "LinkBandwidth", StringValue(bottleneckRate),
+                "LinkDelay", StringValue("10ms"),
+                "MaxSize", QueueSizeValue(QueueSize(size))
+            );
+        }
+        else
+        {
+            tch.SetRootQueueDisc(
+                "ns3::PfifoFastQueueDisc",
+                "MaxSize", QueueSizeValue(QueueSize(size))
+            );
+        }
+        return tch;
+    };
+
+    TrafficControlHelper tch = bottleneckQdisc({});
 
     // Remove default FqCoDel
     tch.Uninstall(drs.Get(0));
 
-    // Install small FIFO queue to force drops
-    tch.SetRootQueueDisc(
-        "ns3::PfifoFastQueueDisc",
-        "MaxSize", QueueSizeValue(QueueSize("5p"))
-    );
-
     QueueDiscContainer qdiscs = tch.Install(drs.Get(0));
 
     // Connect drop trace
     qdiscs.Get(0)->TraceConnectWithoutContext(
         "Drop", MakeCallback(&QueueDiscDropTrace));
 
+    // Time in queue and time-weighted occupancy, without per-packet output
+    QueueSojournMonitor queues;
+    if (queueStats == "all")
+    {
+        queues.InstallAll();
+    }
+    else if (queueStats == "bottleneck")
+    {
+        queues.Attach(qdiscs.Get(0), "bottleneck");
+    }
+
     /* ---------- TCP SERVER ---------- */
     uint16_t port = 50000;
     PacketSinkHelper sink(
@@ -108,7 +245,7 @@ main(int argc, char *argv[])
 
     ApplicationContainer serverApp = sink.Install(server.Get(0));
     serverApp.Start(Seconds(0.0));
-    serverApp.Stop(Seconds(3.0));
+    serverApp.Stop(Seconds(simTime));
 
     /* ---------- TCP CLIENTS ---------- */
     OnOffHelper client(
@@ -125,37 +262,145 @@ main(int argc, char *argv[])
 
     ApplicationContainer clientApps = client.Install(clients);
     clientApps.Start(Seconds(1.0));
-    clientApps.Stop(Seconds(2.0));
+    clientApps.Stop(Seconds(simTime - 1.0));
 
     /* ---------- FLOW MONITOR ---------- */
     FlowMonitorHelper flowmon;
-    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+    Ptr<FlowMonitor> monitor;
+    LightFlowMonitor light;
+    DelaySketchMonitor sketches;
+    bool lightMonitor = flowMonitor == "light";
+    if (lightMonitor)
+    {
+        light.SetSampling(flowSample);
+        light.SetDelayCallback([&sketches](FlowId id, Time delay) {
+            sketches.Add(id, delay.GetNanoSeconds());
+        });
+        light.Install(NodeContainer::GetGlobal());
+    }
+    else
+    {
+        monitor = flowmon.InstallAll();
+        sketches.Install(NodeContainer::GetGlobal(),
+            DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()));
+    }
 
     /* ---------- NETANIM ---------- */
-    AnimationInterface anim("scratch/tcp-bottleneck.xml");
+    AnimRecorder anim("scratch/tcp-bottleneck", animMode);
+    anim.SetSampling(animSample);
 
-    anim.SetConstantPosition(clients.Get(0), 5, 10);
-    anim.SetConstantPosition(clients.Get(1), 5, 20);
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        anim.SetConstantPosition(clients.Get(i), 5, 10 + 10 * i);
+    }
     anim.SetConstantPosition(router.Get(0), 25, 15);
     anim.SetConstantPosition(server.Get(0), 45, 15);
 
+    /* ---------- WATCHPOINTS ---------- */
+    // e.g. --watch="firstDrop:snapshot,stop" ends the run at the first drop
+    Watchpoints watch;
+    watch.SetSnapshot([&](ostream &os) { queues.Print(os); });
+    watch.SetQuiet([&]() {
+        anim.StopRecording();
+        if (monitor)
+        {
+            monitor->StopRightNow();
+        }
+    });
+    for (const Watchpoints::Spec &w : Watchpoints::Parse(watchList))
+    {
+        if (w.predicate == "firstDrop")
+        {
+            watch.OnFirstDrop(qdiscs.Get(0)).Then(w.actions);
+        }
+        else if (w.predicate == "queueAbove")
+        {
+            watch.OnQueueAbove(qdiscs.Get(0), uint32_t(w.value)).Then(w.actions);
+        }
+        else if (w.predicate == "cwndBelow")
+        {
+            // Followed from just after the clients open their sockets
+            for (uint32_t i = 0; i < clients.GetN(); i++)
+            {
+                watch.OnCwndBelow(clients.Get(i), uint32_t(w.value), Seconds(1.001),
+                                  "cwndBelow/" + to_string(i)).Then(w.actions);
+            }
+        }
+        else
+        {
+            NS_ABORT_MSG("Unknown watchpoint " << w.predicate);
+        }
+    }
+
+    /* ---------- WARM-START BRANCHES ---------- */
+    // Every variant shares the TCP start-up up to branchAt
+    WarmStartBrancher brancher;
+    if (branchAt > 0)
+    {
+        for (const string &spec : SplitList(variants, ';'))
+        {
+            brancher.AddVariant(spec, [&drs, &qdiscs, &bottleneckQdisc, &queues, &queueStats, &watch, spec]() {
+                TrafficControlHelper variant = bottleneckQdisc(ParseVariant(spec));
+                Ptr<QueueDisc> qdisc = ReplaceRootQueueDisc(drs.Get(0), variant);
+                watch.MoveQueueDisc(qdiscs.Get(0), qdisc);
+                qdisc->TraceConnectWithoutContext(
+                    "Drop", MakeCallback(&QueueDiscDropTrace));
+                if (queueStats != "none")
+                {
+                    queues.Attach(qdisc, "bottleneck-variant");
+                }
+            });
+        }
+        if (coldBranch >= 0)
+        {
+            brancher.ScheduleCold(Seconds(branchAt), size_t(coldBranch));
+        }
+        else
+        {
+            brancher.Schedule(Seconds(branchAt), jobs);
+        }
+    }
+
     /* ---------- RUN ---------- */
-    Simulator::Stop(Seconds(3.0));
+    Simulator::Stop(Seconds(simTime));
+    RunStats runStats;
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+
+    if (brancher.IsParent())
+    {
+        brancher.Print(cout);
+        cache.Store();
+        Simulator::Destroy();
+        return checkBranch && !CheckBranch(argc, argv, brancher) ? 1 : 0;
+    }
 
     /* ---------- FLOW RESULTS ---------- */
-    monitor->CheckForLostPackets();
-    Ptr<Ipv4FlowClassifier> classifier =
-        DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    Ptr<Ipv4FlowClassifier> classifier;
+    if (lightMonitor)
+    {
+        light.CheckForLostPackets();
+        if (!flowOutput.empty() && light.SerializeToBinaryFile(flowOutput))
+        {
+            cout << "Flow results: " << light.GetNFlows() << " flows in " << flowOutput << "\n";
+        }
+    }
+    else
+    {
+        monitor->CheckForLostPackets();
+        classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    }
 
-    for (auto &flow : monitor->GetFlowStats())
+    for (auto &flow : lightMonitor ? light.GetFlowStats() : monitor->GetFlowStats())
     {
-        auto t = classifier->FindFlow(flow.first);
+        auto t = lightMonitor ? light.FindFlow(flow.first) : classifier->FindFlow(flow.first);
         cout << "Flow " << flow.first
              << " (" << t.sourceAddress
              << " -> " << t.destinationAddress << ")\n";
         cout << "  Lost Packets: "
              << flow.second.lostPackets << "\n";
+        sketches.Print(flow.first, cout);
     }
 
     if (firstDropPrinted)
@@ -168,6 +413,18 @@ main(int argc, char *argv[])
         cout << "\nNo packet loss occurred\n";
     }
 
+    queues.Print(cout);
+    watch.Print(cout);
+    PacketPool::Print(cout);
+    if (summary)
+    {
+        runStats.PrintSummary(cout);
+        PacketPool::PrintSummary(cout);
+        queues.PrintSummary(cout);
+        watch.PrintSummary(cout);
+    }
+    cache.Store();
+
     Simulator::Destroy();
     return 0;
 }
@@ -7,28 +7,138 @@
 #include "ns3/mobility-module.h"
 #include "ns3/netanim-module.h"
 
+#include "anim-recorder.h"
+#include "delay-sketch.h"
+#include "fluid-background.h"
+#include "ladder-scheduler.h"
+#include "lazy-routing.h"
+#include "light-flow-monitor.h"
+#include "packet-pool.h"
+#include "parallel-simulator.h"
+#include "result-cache.h"
+#include "run-stats.h"
+#include "steady-state.h"
+#include "tcp-sampler.h"
+#include "topology-builder.h"
+
+#include <map>
+#include <sstream>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TcpVsUdpBottleneck");
 
-// -------- TCP CWND TRACE --------
-void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd)
-{
-    std::cout << Simulator::Now().GetSeconds()
-              << " s : CWND " << oldCwnd
-              << " -> " << newCwnd << " bytes" << std::endl;
-}
-
 int main(int argc, char *argv[])
 {
+    uint32_t nTcp = 1;
+    uint32_t nUdp = 1;
+    double simTime = 10.0;
+    std::string bottleneckRate = "5Mbps";
+    std::string background = "packet";
+    bool fifo = false;
+    bool steadyState = false;
+    double ssTolerance = 0.05;
+    double ssWindow = 100;
+
+    double sampleInterval = 10.0;
+    uint32_t sampleDecimation = 1;
+    std::string sampleFile = "scratch/tcp-vs-udp.tcs";
+
+    std::string routing = "global";
+    bool summary = false;
+    bool packetPool = false;
+    std::string animMode = "binary";
+    uint32_t animSample = 1;
+    std::string flowMonitor = "full";
+    uint32_t flowSample = 1;
+    uint32_t partitions = 1;
+    bool sequential = false;
+    std::string resultCache = "";
+
     CommandLine cmd;
+    cmd.AddValue("nTcp", "Number of BulkSend TCP clients", nTcp);
+    cmd.AddValue("nUdp", "Number of 20Mbps OnOff UDP clients", nUdp);
+    cmd.AddValue("simTime", "Simulation duration (s); clients send from 1 s", simTime);
+    cmd.AddValue("steadyState", "Stop once throughput, delay and loss have converged", steadyState);
+    cmd.AddValue("ssTolerance", "Relative 95% CI half-width that counts as converged", ssTolerance);
+    cmd.AddValue("ssWindow", "Steady-state sampling window (ms)", ssWindow);
+    cmd.AddValue("bottleneckRate", "Router-server data rate", bottleneckRate);
+    cmd.AddValue("background", "UDP clients as packet (OnOff) or fluid flows; fluid implies fifo", background);
+    cmd.AddValue("fifo", "Drop the FqCoDel qdisc so the 5p device queue is a plain FIFO", fifo);
+    cmd.AddValue("sampleInterval", "TCP state sampling period in ms (0 = on cwnd change)", sampleInterval);
+    cmd.AddValue("sampleDecimation", "Keep every n-th cwnd change when sampleInterval is 0", sampleDecimation);
+    cmd.AddValue("sampleFile", "Columnar TCP state sample file (empty to disable sampling)", sampleFile);
+    cmd.AddValue("routing", "Routing: global (full SPF at start) or lazy (on demand)", routing);
+    cmd.AddValue("summary", "Print a machine-readable SUMMARY line with event throughput", summary);
+    cmd.AddValue("animMode", "Animation output: xml, binary or none", animMode);
+    cmd.AddValue("animSample", "Record 1 in n packets in binary animation mode", animSample);
+    cmd.AddValue("packetPool", "Serve packet allocations from per-thread free lists", packetPool);
+    cmd.AddValue("flowMonitor", "Flow statistics: full (FlowMonitor) or light (edge probes only)", flowMonitor);
+    cmd.AddValue("flowSample", "Light flow monitor: time 1 in n packets per flow", flowSample);
+    cmd.AddValue("partitions", "Run on this many processes (clients spread over all but the first); implies light", partitions);
+    cmd.AddValue("sequential", "Run the --partitions layout in one process (the reference for partition-check)", sequential);
+    cmd.AddValue("resultCache", "Directory of cached results; a known configuration is not re-run (empty = off)", resultCache);
     cmd.Parse(argc, argv);
 
-    // ---------- NODES ----------
-    NodeContainer clients, router, server;
-    clients.Create(2);
-    router.Create(1);
-    server.Create(1);
+    if (partitions > 1)
+    {
+        // Partitions are forked processes: flow statistics must follow
+        // packets between them, and files opened before Run would be shared
+        ParallelSimulator::Enable(partitions, sequential);
+        flowMonitor = "light";
+        animMode = "none";
+        sampleFile = "";
+    }
+    NS_ABORT_MSG_IF(steadyState && flowMonitor == "light", "--steadyState needs --flowMonitor=full");
+    NS_ABORT_MSG_IF(sampleInterval < 0, "--sampleInterval must not be negative");
+
+    // Only the main partition stores; the others never print results
+    ResultCache cache(resultCache);
+    cache.SetFileOutput(!sampleFile.empty() || animMode != "none");
+    if (cache.Replay(argc, argv))
+    {
+        return 0;
+    }
+
+    if (packetPool)
+    {
+        PacketPool::Enable();
+    }
+
+    // ---------- TOPOLOGY ----------
+    // nTcp + nUdp clients -- 100Mbps/2ms -- router -- bottleneckRate/10ms, 5p -- server
+    // (with --background=fluid the UDP clients stay idle and their load is a fluid rate)
+    TopologyBuilder builder;
+    LazyGlobalRoutingHelper lazyRouting;
+    if (routing == "lazy")
+    {
+        builder.SetRoutingHelper(lazyRouting.GetListRouting());
+    }
+    Topology topo = builder.Dumbbell(nTcp + nUdp, 1,
+                                     LinkSpec("100Mbps", "2ms"),
+                                     LinkSpec(bottleneckRate, "10ms", "5p"));
+
+    NodeContainer clients = topo.senders;
+    NodeContainer router = topo.routers;
+    NodeContainer server = topo.receivers;
+    Ipv4InterfaceContainer serverIf = topo.bottleneckIf;
+
+    NodeContainer tcpClients;
+    NodeContainer udpClients;
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        (i < nTcp ? tcpClients : udpClients).Add(clients.Get(i));
+    }
+
+    // ---------- PARTITIONS ----------
+    // Router and server in the main partition, the clients spread over the
+    // others; the 2ms access links give the lookahead
+    if (partitions > 1)
+    {
+        ParallelSimulator::Assign(NodeContainer(router, server), 0);
+        ParallelSimulator::Spread(clients, 1, partitions);
+        ParallelSimulator::Install();
+    }
 
     // ---------- MOBILITY (for NetAnim) ----------
     MobilityHelper mobility;
@@ -37,39 +147,24 @@ int main(int argc, char *argv[])
     mobility.Install(router);
     mobility.Install(server);
 
-    // ---------- LINKS ----------
-    PointToPointHelper accessLink;
-    accessLink.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
-    accessLink.SetChannelAttribute("Delay", StringValue("2ms"));
-
-    PointToPointHelper bottleneck;
-    bottleneck.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
-    bottleneck.SetChannelAttribute("Delay", StringValue("10ms"));
-    bottleneck.SetQueue("ns3::DropTailQueue<Packet>",
-                        "MaxSize", QueueSizeValue(QueueSize("5p")));
-
-    NetDeviceContainer d02 = accessLink.Install(clients.Get(0), router.Get(0));
-    NetDeviceContainer d12 = accessLink.Install(clients.Get(1), router.Get(0));
-    NetDeviceContainer d23 = bottleneck.Install(router.Get(0), server.Get(0));
-
-    // ---------- INTERNET ----------
-    InternetStackHelper stack;
-    stack.Install(clients);
-    stack.Install(router);
-    stack.Install(server);
-
-    // ---------- IP ADDRESSING ----------
-    Ipv4AddressHelper address;
-    address.SetBase("10.1.1.0", "255.255.255.0");
-    address.Assign(d02);
-
-    address.SetBase("10.1.2.0", "255.255.255.0");
-    address.Assign(d12);
-
-    address.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer serverIf = address.Assign(d23);
+    if (routing == "global")
+    {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    // ---------- BOTTLENECK QUEUE ----------
+    // Fluid background needs a FIFO bottleneck; --fifo gives the packet
+    // model the same queue for comparison
+    Ptr<FluidQueueDisc> fluid;
+    if (background == "fluid")
+    {
+        fluid = FluidQueueDisc::Install(topo.bottleneck.Get(0), QueueSize("0p"));
+    }
+    else if (fifo)
+    {
+        TrafficControlHelper tch;
+        tch.Uninstall(topo.bottleneck.Get(0));
+    }
 
     // ---------- TCP APPLICATION ----------
     uint16_t tcpPort = 9000;
@@ -78,21 +173,24 @@ int main(int argc, char *argv[])
         InetSocketAddress(serverIf.GetAddress(1), tcpPort));
     tcpClient.SetAttribute("MaxBytes", UintegerValue(0));
 
-    ApplicationContainer tcpApps = tcpClient.Install(clients.Get(0));
+    ApplicationContainer tcpApps = tcpClient.Install(tcpClients);
     tcpApps.Start(Seconds(1.0));
-    tcpApps.Stop(Seconds(10.0));
+    tcpApps.Stop(Seconds(simTime));
 
     PacketSinkHelper tcpSink("ns3::TcpSocketFactory",
         InetSocketAddress(Ipv4Address::GetAny(), tcpPort));
     ApplicationContainer tcpSinkApp = tcpSink.Install(server.Get(0));
     tcpSinkApp.Start(Seconds(0.0));
-    tcpSinkApp.Stop(Seconds(10.0));
+    tcpSinkApp.Stop(Seconds(simTime));
 
-    // Trace TCP CWND
-    Ptr<Socket> tcpSocket =
-        Socket::CreateSocket(clients.Get(0), TcpSocketFactory::GetTypeId());
-    tcpSocket->TraceConnectWithoutContext(
-        "CongestionWindow", MakeCallback(&CwndTracer));
+    // Sample cwnd/ssthresh/RTT/in-flight/retransmits of the BulkSend sockets
+    TcpStateSampler sampler;
+    sampler.SetInterval(Time::FromDouble(sampleInterval, Time::MS));
+    sampler.SetDecimation(sampleDecimation);
+    if (!sampleFile.empty())
+    {
+        sampler.Watch(tcpApps, Seconds(1.0));
+    }
 
     // ---------- UDP APPLICATION ----------
     uint16_t udpPort = 8000;
@@ -106,54 +204,169 @@ int main(int argc, char *argv[])
     udpClient.SetAttribute("OffTime",
         StringValue("ns3::ConstantRandomVariable[Constant=0]"));
 
-    ApplicationContainer udpApps = udpClient.Install(clients.Get(1));
-    udpApps.Start(Seconds(1.0));
-    udpApps.Stop(Seconds(10.0));
+    if (fluid)
+    {
+        // Same load as the OnOff clients, without the packets
+        for (uint32_t i = 0; i < udpClients.GetN(); i++)
+        {
+            fluid->AddCbrFlow(DataRate("20Mbps"), 1472, Seconds(1.0), Seconds(simTime));
+        }
+    }
+    else
+    {
+        ApplicationContainer udpApps = udpClient.Install(udpClients);
+        udpApps.Start(Seconds(1.0));
+        udpApps.Stop(Seconds(simTime));
+    }
 
     PacketSinkHelper udpSink("ns3::UdpSocketFactory",
         InetSocketAddress(Ipv4Address::GetAny(), udpPort));
     ApplicationContainer udpSinkApp = udpSink.Install(server.Get(0));
     udpSinkApp.Start(Seconds(0.0));
-    udpSinkApp.Stop(Seconds(10.0));
+    udpSinkApp.Stop(Seconds(simTime));
 
     // ---------- FLOW MONITOR ----------
     FlowMonitorHelper flowmon;
-    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+    Ptr<FlowMonitor> monitor;
+    LightFlowMonitor light;
+    DelaySketchMonitor sketches;
+    bool lightMonitor = flowMonitor == "light";
+    if (lightMonitor)
+    {
+        // Tagged, so --sequential gives the same numbers as --partitions
+        // (partition-check compares the two)
+        light.SetSampling(flowSample);
+        light.SetTimestampTags(true);
+        light.SetDelayCallback([&sketches](FlowId id, Time delay) {
+            sketches.Add(id, delay.GetNanoSeconds());
+        });
+        light.Install(NodeContainer::GetGlobal());
+    }
+    else
+    {
+        monitor = flowmon.InstallAll();
+        sketches.Install(NodeContainer::GetGlobal(),
+            DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()));
+    }
+
+    // Warm-up truncation and early stop on the TCP and UDP data flows
+    SteadyStateMonitor steady;
+    if (steadyState)
+    {
+        steady.SetWindow(Time::FromDouble(ssWindow, Time::MS));
+        steady.SetTolerance(ssTolerance);
+        steady.SetPorts({tcpPort, udpPort});
+        steady.Install(monitor, DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()),
+                       Seconds(1.0));
+    }
 
     // ---------- NETANIM ----------
-    AnimationInterface anim("scratch/tcp-vs-udp.xml");
+    AnimRecorder anim("scratch/tcp-vs-udp", animMode);
+    anim.SetSampling(animSample);
 
-    anim.SetConstantPosition(clients.Get(0), 5, 10);
-    anim.SetConstantPosition(clients.Get(1), 5, 20);
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        anim.SetConstantPosition(clients.Get(i), 5, 10 + 10 * i);
+    }
     anim.SetConstantPosition(router.Get(0), 25, 15);
     anim.SetConstantPosition(server.Get(0), 45, 15);
 
-    anim.UpdateNodeDescription(clients.Get(0), "TCP Client");
-    anim.UpdateNodeDescription(clients.Get(1), "UDP Client");
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        anim.UpdateNodeDescription(clients.Get(i), i < nTcp ? "TCP Client" : "UDP Client");
+    }
     anim.UpdateNodeDescription(router.Get(0), "Bottleneck Router");
     anim.UpdateNodeDescription(server.Get(0), "Server");
 
-    anim.UpdateNodeColor(clients.Get(0), 0, 255, 0);
-    anim.UpdateNodeColor(clients.Get(1), 255, 255, 0);
+    for (uint32_t i = 0; i < clients.GetN(); i++)
+    {
+        if (i < nTcp)
+            anim.UpdateNodeColor(clients.Get(i), 0, 255, 0);
+        else
+            anim.UpdateNodeColor(clients.Get(i), 255, 255, 0);
+    }
     anim.UpdateNodeColor(router.Get(0), 255, 0, 0);
     anim.UpdateNodeColor(server.Get(0), 0, 0, 255);
 
     // ---------- RUN ----------
-    Simulator::Stop(Seconds(10.0));
+    Simulator::Stop(Seconds(simTime));
+    RunStats runStats;
+    runStats.Start();
     Simulator::Run();
+    runStats.Stop();
+
+    if (!sampleFile.empty())
+    {
+        sampler.Close(sampleFile);
+        std::cout << "TCP samples: " << sampler.GetColumns().GetN()
+                  << " rows of " << sampler.GetNFlows() << " flows -> "
+                  << sampleFile << "\n";
+    }
+
+    // ---------- PARTITION RESULTS ----------
+    // Each partition saw its own ends of the flows; the main one merges them.
+    // Delay sketches live where a flow is delivered, which is a client
+    // partition for the TCP ACK flows, so they travel keyed by 5-tuple too.
+    if (partitions > 1)
+    {
+        auto tupleKey = [&light](FlowId id) {
+            Ipv4FlowClassifier::FiveTuple t = light.FindFlow(id);
+            std::ostringstream key;
+            key << t.sourceAddress << ' ' << t.sourcePort << ' ' << t.destinationAddress << ' '
+                << t.destinationPort << ' ' << uint32_t(t.protocol);
+            return key.str();
+        };
+        std::vector<LightFlowRecord> others = ParallelSimulator::Gather(light.GetRecords());
+        std::ostringstream mine;
+        if (!ParallelSimulator::IsMain())
+        {
+            for (FlowId id = 1; id <= light.GetNFlows(); id++)
+            {
+                mine << tupleKey(id) << ' ' << sketches.Serialize(id) << '\n';
+            }
+        }
+        std::vector<std::string> otherSketches = ParallelSimulator::Gather(mine.str());
+        if (!ParallelSimulator::IsMain())
+        {
+            Simulator::Destroy();
+            return 0;
+        }
+        light.Merge(others);
+
+        std::map<std::string, FlowId> byTuple;
+        for (FlowId id = 1; id <= light.GetNFlows(); id++)
+        {
+            byTuple[tupleKey(id)] = id;
+        }
+        for (const std::string &part : otherSketches)
+        {
+            std::istringstream in(part);
+            std::string src, srcPort, dst, dstPort, protocol, text;
+            while (in >> src >> srcPort >> dst >> dstPort >> protocol >> text)
+            {
+                auto it = byTuple.find(src + ' ' + srcPort + ' ' + dst + ' ' + dstPort + ' ' + protocol);
+                if (it != byTuple.end())
+                {
+                    sketches.Merge(it->second, text);
+                }
+            }
+        }
+    }
 
     // ---------- FLOW RESULTS ----------
-    monitor->CheckForLostPackets();
-    Ptr<Ipv4FlowClassifier> classifier =
-        DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    Ptr<Ipv4FlowClassifier> classifier;
+    if (!lightMonitor)
+    {
+        monitor->CheckForLostPackets();
+        classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    }
 
-    for (auto &flow : monitor->GetFlowStats())
+    for (auto &flow : lightMonitor ? light.GetFlowStats() : monitor->GetFlowStats())
     {
-        auto t = classifier->FindFlow(flow.first);
-        double throughput =
-            flow.second.rxBytes * 8.0 /
-            (flow.second.timeLastRxPacket.GetSeconds()
-            - flow.second.timeFirstTxPacket.GetSeconds()) / 1e6;
+        auto t = lightMonitor ? light.FindFlow(flow.first) : classifier->FindFlow(flow.first);
+        double duration = flow.second.timeLastRxPacket.GetSeconds()
+                          - flow.second.timeFirstTxPacket.GetSeconds();
+        double throughput = duration > 0 ? flow.second.rxBytes * 8.0 / duration / 1e6 : 0;
 
         std::cout << "Flow " << flow.first
                   << " (" << t.sourceAddress
@@ -161,7 +374,55 @@ int main(int argc, char *argv[])
         std::cout << "  Throughput: " << throughput
                   << " Mbps, Lost Packets: "
                   << flow.second.lostPackets << "\n";
+        sketches.Print(flow.first, std::cout);
+
+        if (summary)
+        {
+            const DelaySketchMonitor::FlowSketches &fs = sketches.Get(flow.first);
+            double meanDelay = flow.second.rxPackets > 0
+                ? flow.second.delaySum.GetSeconds() / flow.second.rxPackets : 0;
+            std::cout << "SUMMARY scope=flow flow=" << flow.first
+                      << " src=" << t.sourceAddress
+                      << " srcPort=" << t.sourcePort
+                      << " dst=" << t.destinationAddress
+                      << " dstPort=" << t.destinationPort
+                      << " protocol=" << uint32_t(t.protocol)
+                      << " txPackets=" << flow.second.txPackets
+                      << " rxPackets=" << flow.second.rxPackets
+                      << " lostPackets=" << flow.second.lostPackets
+                      << " meanDelay=" << meanDelay
+                      << " throughputMbps=" << throughput
+                      << " delayP50=" << fs.delay.Quantile(0.5) / 1e9
+                      << " delayP99=" << fs.delay.Quantile(0.99) / 1e9 << "\n";
+        }
+    }
+
+    if (fluid)
+    {
+        fluid->Print(std::cout);
+    }
+    if (steadyState)
+    {
+        steady.Print(std::cout);
+    }
+    runStats.Print(std::cout);
+    PacketPool::Print(std::cout);
+    ParallelSimulator::Print(std::cout);
+    if (summary)
+    {
+        runStats.PrintSummary(std::cout);
+        PacketPool::PrintSummary(std::cout);
+        ParallelSimulator::PrintSummary(std::cout);
+        if (fluid)
+        {
+            fluid->PrintSummary(std::cout);
+        }
+        if (steadyState)
+        {
+            steady.PrintSummary(std::cout);
+        }
     }
+    cache.Store();
 
     Simulator::Destroy();
     return 0;
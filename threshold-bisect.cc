@@ -0,0 +1,211 @@
+/*
+ * Threshold search over one scenario parameter with watchpoints.
+ *
+ * The scenario runs with --<param>=<value><unit> and --watch=<watch>:stop,
+ * so every run ends as soon as the watchpoint fires (or at its normal stop
+ * time if it never does). A run "hits" if any SUMMARY scope=watch line has
+ * hit=1. Assuming the outcome flips once over [low, high], the bracket is
+ * narrowed until it is no wider than --tolerance: with --jobs=1 by plain
+ * bisection, with more jobs by evaluating that many evenly spaced points
+ * of the bracket in parallel per round.
+ *
+ * The exit status is 1 if low and high give the same outcome or a run
+ * fails.
+ *
+ * Usage:
+ *    ./ns3 build tcpqueuedelay threshold-bisect
+ *    ./ns3 run "threshold-bisect --binary=build/scratch/ns3-dev-tcpqueuedelay-default
+ *               --param=bottleneckRate --unit=Mbps --low=1 --high=100 --watch=firstDrop
+ *               --args='--animMode=none'"
+ *    ./ns3 run "threshold-bisect --binary=build/scratch/ns3-dev-IP-default
+ *               --param=attackRate --low=1 --high=1000 --watch=spoofedDrops=50 --integer"
+ */
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace ns3;
+using namespace std;
+
+struct Probe
+{
+    double value = 0;
+    bool hit = false;
+    double hitTime = -1;
+    double wallSeconds = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    string binary = "";
+    string args = "";
+    string param = "";
+    string unit = "";
+    double low = 0;
+    double high = 0;
+    string watch = "firstDrop";
+    double tolerance = 0;
+    bool integer = false;
+    unsigned jobs = 1;
+    uint32_t maxRounds = 30;
+    string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("binary", "Path to the built scenario", binary);
+    cmd.AddValue("args", "Space-separated extra arguments for every run", args);
+    cmd.AddValue("param", "Scenario parameter to search over", param);
+    cmd.AddValue("unit", "Suffix of the parameter value, e.g. Mbps", unit);
+    cmd.AddValue("low", "Lower end of the search range", low);
+    cmd.AddValue("high", "Upper end of the search range", high);
+    cmd.AddValue("watch", "Watchpoint predicate[=value] passed as --watch=<watch>:stop", watch);
+    cmd.AddValue("tolerance", "Final bracket width (0 = 1% of the range)", tolerance);
+    cmd.AddValue("integer", "Search integer values only", integer);
+    cmd.AddValue("jobs", "Points evaluated in parallel per round", jobs);
+    cmd.AddValue("maxRounds", "Upper bound on the number of rounds", maxRounds);
+    cmd.AddValue("output", "CSV file with every run", output);
+    cmd.Parse(argc, argv);
+
+    if (binary.empty() || param.empty() || !(high > low))
+    {
+        cerr << "--binary, --param and --low < --high are required" << endl;
+        return 1;
+    }
+    jobs = max(jobs, 1u);
+    if (tolerance <= 0)
+    {
+        tolerance = integer ? 1 : (high - low) / 100;
+    }
+    tolerance = integer ? max(tolerance, 1.0) : tolerance;
+
+    vector<string> extra = SplitList(args, ' ');
+    vector<Probe> probes;
+    bool failed = false;
+
+    // Runs the scenario at every value in parallel, in input order
+    auto evaluate = [&](const vector<double> &values) {
+        ProcessPool pool(jobs);
+        for (double v : values)
+        {
+            ostringstream value;
+            value << v << unit;
+            vector<string> argv = {binary, "--summary=1", "--" + param + "=" + value.str(),
+                                   "--watch=" + watch + ":stop"};
+            argv.insert(argv.end(), extra.begin(), extra.end());
+            pool.Submit(argv);
+        }
+        vector<Probe> results(values.size());
+        pool.Wait([&](size_t index, const ProcessResult &result) {
+            Probe &p = results[index];
+            p.value = values[index];
+            p.wallSeconds = result.wallSeconds;
+            vector<SummaryLine> lines = ParseSummary(result.output);
+            if (result.status != 0 || FindSummary(lines, "scope", "run").empty())
+            {
+                cerr << "Run with " << param << "=" << values[index] << unit << " failed (exit "
+                     << result.status << ")" << endl;
+                failed = true;
+                return;
+            }
+            for (SummaryLine &l : lines)
+            {
+                if (l["scope"] == "watch" && l["hit"] == "1")
+                {
+                    double t = stod(l["time"]);
+                    p.hitTime = p.hit ? min(p.hitTime, t) : t;
+                    p.hit = true;
+                }
+            }
+        });
+        for (const Probe &p : results)
+        {
+            cout << left << setw(14) << p.value << setw(6) << (p.hit ? "hit" : "-")
+                 << setw(12) << (p.hit ? to_string(p.hitTime) : "") << p.wallSeconds << " s\n";
+        }
+        probes.insert(probes.end(), results.begin(), results.end());
+        return results;
+    };
+
+    /* ---------- SEARCH ---------- */
+    cout << left << setw(14) << param + unit << setw(6) << "watch" << setw(12) << "hitTime"
+         << "wall\n";
+    vector<Probe> ends = evaluate({low, high});
+    if (failed)
+    {
+        return 1;
+    }
+    if (ends[0].hit == ends[1].hit)
+    {
+        cout << "Same outcome at " << low << " and " << high << " (" << (ends[0].hit ? "hit" : "no hit")
+             << "); no threshold in range\n";
+        return 1;
+    }
+    bool lowHit = ends[0].hit;
+
+    uint32_t rounds = 0;
+    while (high - low > tolerance && rounds++ < maxRounds)
+    {
+        vector<double> points;
+        for (unsigned i = 1; i <= jobs; i++)
+        {
+            double v = low + (high - low) * i / (jobs + 1);
+            v = integer ? std::round(v) : v;
+            if (v > low && v < high && (points.empty() || v > points.back()))
+            {
+                points.push_back(v);
+            }
+        }
+        if (points.empty())
+        {
+            break;
+        }
+        vector<Probe> results = evaluate(points);
+        if (failed)
+        {
+            return 1;
+        }
+        // The bracket ends just before the first point with high's outcome
+        for (const Probe &p : results)
+        {
+            if (p.hit == lowHit)
+            {
+                low = p.value;
+            }
+            else
+            {
+                high = p.value;
+                break;
+            }
+        }
+    }
+
+    /* ---------- RESULT ---------- */
+    double wall = 0;
+    for (const Probe &p : probes)
+    {
+        wall += p.wallSeconds;
+    }
+    cout << "\nThreshold of " << watch << " on " << param << ": between " << low << unit << " ("
+         << (lowHit ? "hit" : "no hit") << ") and " << high << unit << " ("
+         << (lowHit ? "no hit" : "hit") << ")\n"
+         << probes.size() << " runs, " << wall << " s of run time\n";
+
+    if (!output.empty())
+    {
+        ofstream csv(output);
+        csv << "value,hit,hitTime,wallSeconds\n";
+        for (const Probe &p : probes)
+        {
+            csv << p.value << ',' << p.hit << ',' << p.hitTime << ',' << p.wallSeconds << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,385 @@
+/*
+ * Parametric point-to-point topologies with bulk setup.
+ *
+ * TopologyBuilder creates the nodes, links, internet stacks and addresses of
+ * a dumbbell, parking-lot, chain, mesh or fat-tree in one pass. Every link gets
+ * its own subnet, taken in creation order from a base network (10.1.1.0/24,
+ * 10.1.2.0/24, ... by default, which matches the hand-written scripts), and
+ * addresses are written straight into Ipv4 instead of going through
+ * Ipv4AddressHelper, whose allocation bookkeeping grows with every address
+ * handed out. Setup time and memory are linear in nodes plus links.
+ *
+ * Usage:
+ *    TopologyBuilder builder;
+ *    Topology t = builder.Dumbbell(nSenders, 1, LinkSpec("100Mbps", "2ms"),
+ *                                  LinkSpec("5Mbps", "10ms", "5p"));
+ *    Ipv4Address server = t.GetReceiverAddress(0);
+ *
+ * Addresses set here are not known to Ipv4AddressHelper; pick a different
+ * base if a script also assigns addresses by hand.
+ */
+
+#ifndef TOPOLOGY_BUILDER_H
+#define TOPOLOGY_BUILDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+struct LinkSpec
+{
+    LinkSpec(const std::string& rate = "100Mbps",
+             const std::string& delay = "2ms",
+             const std::string& queueSize = "")
+        : rate(rate),
+          delay(delay),
+          queueSize(queueSize)
+    {
+    }
+
+    std::string rate;
+    std::string delay;
+    std::string queueSize; // device DropTail MaxSize, empty = ns-3 default
+};
+
+struct Topology
+{
+    NodeContainer hosts;
+    NodeContainer senders;
+    NodeContainer receivers;
+    NodeContainer routers;
+
+    // Every link in creation order; device 0 is the first node given
+    std::vector<NetDeviceContainer> links;
+    std::vector<Ipv4InterfaceContainer> interfaces;
+
+    // Mesh only: indices into links of the router-to-router links
+    std::vector<size_t> core;
+
+    // Dumbbell only: router side is device/interface 0
+    NetDeviceContainer bottleneck;
+    Ipv4InterfaceContainer bottleneckIf;
+
+    NodeContainer GetAll() const
+    {
+        return NodeContainer(hosts, routers);
+    }
+
+    // First address of a node (interface 0 is loopback)
+    static Ipv4Address GetAddress(Ptr<Node> node)
+    {
+        return node->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+    }
+
+    Ipv4Address GetReceiverAddress(uint32_t i) const
+    {
+        return GetAddress(receivers.Get(i));
+    }
+
+    Ipv4Address GetSenderAddress(uint32_t i) const
+    {
+        return GetAddress(senders.Get(i));
+    }
+};
+
+class TopologyBuilder
+{
+  public:
+    // Network of the first link and prefix length of every link subnet
+    void SetBase(Ipv4Address network, uint8_t linkPrefix)
+    {
+        m_base = network.Get();
+        m_prefix = linkPrefix;
+    }
+
+    // Routing stack for the nodes built from now on (default: static + global)
+    void SetRoutingHelper(const Ipv4RoutingHelper& routing)
+    {
+        m_routing.reset(routing.Copy());
+    }
+
+    /* ---------- DUMBBELL ----------
+     * nSenders -- access -- left router
+     * nReceivers == 1: left router -- bottleneck -- receiver
+     * nReceivers > 1:  left router -- bottleneck -- right router -- access -- receivers
+     */
+    Topology Dumbbell(uint32_t nSenders,
+                      uint32_t nReceivers,
+                      const LinkSpec& access,
+                      const LinkSpec& bottleneck)
+    {
+        Topology t;
+        t.senders.Create(nSenders);
+        t.routers.Create(nReceivers > 1 ? 2 : 1);
+        t.receivers.Create(nReceivers);
+        t.hosts.Add(t.senders);
+        t.hosts.Add(t.receivers);
+        Install(t);
+
+        PointToPointHelper accessLink = Helper(access);
+        PointToPointHelper bottleneckLink = Helper(bottleneck);
+        Ptr<Node> left = t.routers.Get(0);
+        for (uint32_t i = 0; i < nSenders; i++)
+        {
+            Connect(t, accessLink, t.senders.Get(i), left);
+        }
+        if (nReceivers == 1)
+        {
+            Connect(t, bottleneckLink, left, t.receivers.Get(0));
+        }
+        else
+        {
+            Ptr<Node> right = t.routers.Get(1);
+            Connect(t, bottleneckLink, left, right);
+            for (uint32_t i = 0; i < nReceivers; i++)
+            {
+                Connect(t, accessLink, right, t.receivers.Get(i));
+            }
+        }
+        size_t b = nSenders;
+        t.bottleneck = t.links[b];
+        t.bottleneckIf = t.interfaces[b];
+        return t;
+    }
+
+    /* ---------- CHAIN ----------
+     * sender -- hops[0] -- router -- hops[1] -- ... -- receiver
+     */
+    Topology Chain(const std::vector<LinkSpec>& hops)
+    {
+        Topology t;
+        NodeContainer nodes;
+        nodes.Create(hops.size() + 1);
+        t.senders.Add(nodes.Get(0));
+        for (uint32_t i = 1; i < hops.size(); i++)
+        {
+            t.routers.Add(nodes.Get(i));
+        }
+        t.receivers.Add(nodes.Get(hops.size()));
+        t.hosts.Add(t.senders);
+        t.hosts.Add(t.receivers);
+        Install(t);
+
+        for (uint32_t i = 0; i < hops.size(); i++)
+        {
+            PointToPointHelper link = Helper(hops[i]);
+            Connect(t, link, nodes.Get(i), nodes.Get(i + 1));
+        }
+        return t;
+    }
+
+    Topology Chain(uint32_t nHops, const LinkSpec& hop)
+    {
+        return Chain(std::vector<LinkSpec>(nHops, hop));
+    }
+
+    /* ---------- PARKING LOT ----------
+     * nRouters routers in a line joined by core links. Sender/receiver 0 is
+     * the long flow from the first to the last router; sender/receiver i + 1
+     * is the cross flow over core link i.
+     */
+    Topology ParkingLot(uint32_t nRouters, const LinkSpec& core, const LinkSpec& access)
+    {
+        NS_ABORT_MSG_IF(nRouters < 2, "ParkingLot needs at least two routers");
+        Topology t;
+        t.routers.Create(nRouters);
+        t.senders.Create(nRouters);
+        t.receivers.Create(nRouters);
+        t.hosts.Add(t.senders);
+        t.hosts.Add(t.receivers);
+        Install(t);
+
+        PointToPointHelper coreLink = Helper(core);
+        PointToPointHelper accessLink = Helper(access);
+        for (uint32_t i = 0; i + 1 < nRouters; i++)
+        {
+            Connect(t, coreLink, t.routers.Get(i), t.routers.Get(i + 1));
+        }
+        Connect(t, accessLink, t.senders.Get(0), t.routers.Get(0));
+        Connect(t, accessLink, t.routers.Get(nRouters - 1), t.receivers.Get(0));
+        for (uint32_t i = 0; i + 1 < nRouters; i++)
+        {
+            Connect(t, accessLink, t.senders.Get(i + 1), t.routers.Get(i));
+            Connect(t, accessLink, t.routers.Get(i + 1), t.receivers.Get(i + 1));
+        }
+        return t;
+    }
+
+    /* ---------- MESH ----------
+     * rows x cols grid of routers, each joined to its right and lower
+     * neighbour (and lower-right one with diagonals), so every router pair
+     * has at least two disjoint paths once rows and cols are both >= 2.
+     * Sender 0 hangs off router (0, 0), receiver 0 off the opposite corner.
+     * Router (r, c) is routers.Get(r * cols + c).
+     */
+    Topology Mesh(uint32_t rows,
+                  uint32_t cols,
+                  const LinkSpec& core,
+                  const LinkSpec& access,
+                  bool diagonals = false)
+    {
+        NS_ABORT_MSG_IF(rows * cols < 2, "Mesh needs at least two routers");
+        Topology t;
+        t.routers.Create(rows * cols);
+        t.senders.Create(1);
+        t.receivers.Create(1);
+        t.hosts.Add(t.senders);
+        t.hosts.Add(t.receivers);
+        Install(t);
+
+        PointToPointHelper coreLink = Helper(core);
+        PointToPointHelper accessLink = Helper(access);
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            for (uint32_t c = 0; c < cols; c++)
+            {
+                Ptr<Node> router = t.routers.Get(r * cols + c);
+                if (c + 1 < cols)
+                {
+                    t.core.push_back(t.links.size());
+                    Connect(t, coreLink, router, t.routers.Get(r * cols + c + 1));
+                }
+                if (r + 1 < rows)
+                {
+                    t.core.push_back(t.links.size());
+                    Connect(t, coreLink, router, t.routers.Get((r + 1) * cols + c));
+                }
+                if (diagonals && r + 1 < rows && c + 1 < cols)
+                {
+                    t.core.push_back(t.links.size());
+                    Connect(t, coreLink, router, t.routers.Get((r + 1) * cols + c + 1));
+                }
+            }
+        }
+        Connect(t, accessLink, t.senders.Get(0), t.routers.Get(0));
+        Connect(t, accessLink, t.routers.Get(rows * cols - 1), t.receivers.Get(0));
+        return t;
+    }
+
+    /* ---------- FAT TREE ----------
+     * k-ary fat-tree (k even): (k/2)^2 core, k pods of k/2 aggregation and
+     * k/2 edge switches, k^3/4 hosts. Hosts are both senders and receivers.
+     */
+    Topology FatTree(uint32_t k, const LinkSpec& hostLink, const LinkSpec& fabric)
+    {
+        NS_ABORT_MSG_IF(k < 2 || k % 2, "FatTree needs an even k");
+        uint32_t half = k / 2;
+        Topology t;
+        NodeContainer core;
+        NodeContainer aggregation;
+        NodeContainer edge;
+        core.Create(half * half);
+        aggregation.Create(k * half);
+        edge.Create(k * half);
+        t.hosts.Create(k * half * half);
+        t.routers.Add(core);
+        t.routers.Add(aggregation);
+        t.routers.Add(edge);
+        t.senders.Add(t.hosts);
+        t.receivers.Add(t.hosts);
+        Install(t);
+
+        PointToPointHelper hostHelper = Helper(hostLink);
+        PointToPointHelper fabricHelper = Helper(fabric);
+        for (uint32_t pod = 0; pod < k; pod++)
+        {
+            for (uint32_t e = 0; e < half; e++)
+            {
+                Ptr<Node> sw = edge.Get(pod * half + e);
+                for (uint32_t h = 0; h < half; h++)
+                {
+                    Connect(t, hostHelper, t.hosts.Get((pod * half + e) * half + h), sw);
+                }
+                for (uint32_t a = 0; a < half; a++)
+                {
+                    Connect(t, fabricHelper, sw, aggregation.Get(pod * half + a));
+                }
+            }
+            for (uint32_t a = 0; a < half; a++)
+            {
+                for (uint32_t c = 0; c < half; c++)
+                {
+                    Connect(t, fabricHelper, aggregation.Get(pod * half + a), core.Get(a * half + c));
+                }
+            }
+        }
+        return t;
+    }
+
+  private:
+    static PointToPointHelper Helper(const LinkSpec& spec)
+    {
+        PointToPointHelper p2p;
+        p2p.SetDeviceAttribute("DataRate", StringValue(spec.rate));
+        p2p.SetChannelAttribute("Delay", StringValue(spec.delay));
+        if (!spec.queueSize.empty())
+        {
+            p2p.SetQueue("ns3::DropTailQueue<Packet>",
+                         "MaxSize", QueueSizeValue(QueueSize(spec.queueSize)));
+        }
+        return p2p;
+    }
+
+    // One stack install over all nodes of the topology
+    void Install(Topology& t)
+    {
+        InternetStackHelper stack;
+        if (m_routing)
+        {
+            stack.SetRoutingHelper(*m_routing);
+        }
+        stack.Install(t.GetAll());
+    }
+
+    // Creates the link and gives both ends an address of the next subnet
+    void Connect(Topology& t, PointToPointHelper& helper, Ptr<Node> a, Ptr<Node> b)
+    {
+        NetDeviceContainer devices = helper.Install(a, b);
+        uint64_t network = uint64_t(m_base) + (uint64_t(m_links) << (32 - m_prefix));
+        NS_ABORT_MSG_IF(network + (1u << (32 - m_prefix)) > (uint64_t(1) << 32),
+                        "TopologyBuilder: address space exhausted after " << m_links << " links");
+        Ipv4Mask mask(~0u << (32 - m_prefix));
+
+        Ipv4InterfaceContainer interfaces;
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            Ptr<NetDevice> dev = devices.Get(j);
+            Ptr<Node> node = dev->GetNode();
+            Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+            int32_t iface = ipv4->AddInterface(dev);
+            ipv4->AddAddress(iface, Ipv4InterfaceAddress(Ipv4Address(uint32_t(network) + j + 1), mask));
+            ipv4->SetMetric(iface, 1);
+            ipv4->SetUp(iface);
+            interfaces.Add(ipv4, iface);
+
+            // Same default queue disc Ipv4AddressHelper::Assign installs
+            Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+            Ptr<NetDeviceQueueInterface> ndqi = dev->GetObject<NetDeviceQueueInterface>();
+            if (tc && ndqi && !tc->GetRootQueueDiscOnDevice(dev))
+            {
+                TrafficControlHelper::Default(ndqi->GetNTxQueues()).Install(dev);
+            }
+        }
+        t.links.push_back(devices);
+        t.interfaces.push_back(interfaces);
+        m_links++;
+    }
+
+    uint32_t m_base = Ipv4Address("10.1.1.0").Get();
+    uint8_t m_prefix = 24;
+    uint32_t m_links = 0;
+    std::shared_ptr<Ipv4RoutingHelper> m_routing;
+};
+
+} // namespace ns3
+
+#endif /* TOPOLOGY_BUILDER_H */
@@ -0,0 +1,238 @@
+/*
+ * Warm-start branching: run the common prefix of several variants once.
+ *
+ * WarmStartBrancher schedules a branch event at branchAt. At that point the
+ * process forks one child per variant (at most `jobs` alive at once, all
+ * forked from the same frozen state). Each child applies its variant, e.g.
+ * a different bottleneck queue disc, and runs to the end of the simulation,
+ * printing its usual results. The parent collects the children's stdout
+ * and stops. Every variant therefore shares the TCP warm-up up to branchAt
+ * and pays only for its own tail.
+ *
+ * Results of a child cover the whole run, prefix included, as they would
+ * in a full run of that variant that switched configuration at branchAt.
+ * Files opened before the branch are shared by all children, so keep file
+ * output (NetAnim, traces) off when branching.
+ *
+ * Usage:
+ *    WarmStartBrancher brancher;
+ *    brancher.AddVariant("minTh=5", [&]() { ... reconfigure ... });
+ *    brancher.Schedule(Seconds(5), jobs);
+ *    Simulator::Run();
+ *    if (brancher.IsParent())
+ *    {
+ *        brancher.Print(std::cout);   // each branch's output, SUMMARY lines tagged
+ *        return 0;
+ *    }
+ *    ... normal result printing, in each child ...
+ *
+ * ReplaceRootQueueDisc() swaps a device's root queue disc at run time and
+ * moves the queued packets into the new one.
+ *
+ * ScheduleCold() applies one variant at branchAt without forking. Comparing
+ * its ResultLines() with those of the matching branch checks that a branch
+ * measures the same thing as a single uninterrupted run.
+ */
+
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include "process-pool.h"
+
+#include "ns3/core-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+// "key=value,key=value" as a map
+inline std::map<std::string, std::string>
+ParseVariant(const std::string& spec)
+{
+    std::map<std::string, std::string> values;
+    for (const std::string& item : SplitList(spec))
+    {
+        size_t eq = item.find('=');
+        NS_ABORT_MSG_IF(eq == std::string::npos, "Variant item without '=': " << item);
+        values[item.substr(0, eq)] = item.substr(eq + 1);
+    }
+    return values;
+}
+
+// Installs the root queue disc configured in helper in place of the current
+// one. Packets queued in the old disc are dequeued in order and enqueued
+// into the new one (which may drop some of them).
+inline Ptr<QueueDisc>
+ReplaceRootQueueDisc(Ptr<NetDevice> device, TrafficControlHelper& helper)
+{
+    Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+    std::vector<Ptr<QueueDiscItem>> queued;
+    Ptr<QueueDisc> old = tc->GetRootQueueDiscOnDevice(device);
+    if (old)
+    {
+        while (Ptr<QueueDiscItem> item = old->Dequeue())
+        {
+            queued.push_back(item);
+        }
+        helper.Uninstall(device);
+    }
+    Ptr<QueueDisc> qdisc = helper.Install(device).Get(0);
+    qdisc->Initialize();
+    // TrafficControlLayer only sets the wake callbacks while scanning the
+    // devices at start-up; without them a stopped device queue would only
+    // be drained again by the next arriving packet
+    Ptr<NetDeviceQueueInterface> ndqi = device->GetObject<NetDeviceQueueInterface>();
+    if (ndqi)
+    {
+        for (std::size_t i = 0; i < ndqi->GetNTxQueues(); i++)
+        {
+            ndqi->GetTxQueue(i)->SetWakeCallback(MakeCallback(&QueueDisc::Run, qdisc));
+        }
+    }
+    for (Ptr<QueueDiscItem>& item : queued)
+    {
+        qdisc->Enqueue(item);
+    }
+    qdisc->Run();
+    return qdisc;
+}
+
+// Lines of a scenario's output from the first one starting with `from`,
+// SUMMARY lines (which carry wall times) left out
+inline std::vector<std::string>
+ResultLines(const std::string& output, const std::string& from)
+{
+    std::vector<std::string> lines;
+    std::istringstream in(output);
+    std::string line;
+    bool found = false;
+    while (std::getline(in, line))
+    {
+        found = found || line.compare(0, from.size(), from) == 0;
+        if (found && line.compare(0, 8, "SUMMARY ") != 0)
+        {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+class WarmStartBrancher
+{
+  public:
+    struct Branch
+    {
+        std::string name;
+        std::function<void()> apply;
+        ProcessResult result;
+    };
+
+    void AddVariant(const std::string& name, const std::function<void()>& apply)
+    {
+        m_branches.push_back(Branch{name, apply, ProcessResult()});
+    }
+
+    // jobs == 0 runs one child per hardware thread
+    void Schedule(Time branchAt, unsigned jobs = 0)
+    {
+        m_branchAt = branchAt;
+        m_jobs = jobs;
+        m_start = std::chrono::steady_clock::now();
+        Simulator::Schedule(branchAt - Simulator::Now(), &WarmStartBrancher::Fork, this);
+    }
+
+    // Applies variant index at branchAt in this process, without forking.
+    // Its output is what branch index of Schedule() should reproduce.
+    void ScheduleCold(Time branchAt, size_t index)
+    {
+        NS_ABORT_MSG_IF(index >= m_branches.size(), "No variant " << index);
+        m_branchAt = branchAt;
+        m_branch = index;
+        Simulator::Schedule(branchAt - Simulator::Now(), m_branches[index].apply);
+    }
+
+    // True in the parent once the branches are done
+    bool IsParent() const
+    {
+        return m_parent;
+    }
+
+    // Index of this child's variant, -1 in the parent or before the branch
+    long GetBranch() const
+    {
+        return m_branch;
+    }
+
+    const std::vector<Branch>& GetBranches() const
+    {
+        return m_branches;
+    }
+
+    // Each branch's output under a header; SUMMARY lines gain branch= and variant=
+    void Print(std::ostream& os) const
+    {
+        for (size_t i = 0; i < m_branches.size(); i++)
+        {
+            const Branch& b = m_branches[i];
+            os << "=== Branch " << i << ": " << b.name << " (exit " << b.result.status << ", "
+               << b.result.wallSeconds << " s) ===\n";
+            std::istringstream in(b.result.output);
+            std::string line;
+            while (std::getline(in, line))
+            {
+                if (line.compare(0, 8, "SUMMARY ") == 0)
+                {
+                    line = "SUMMARY branch=" + std::to_string(i) + " variant=" + b.name +
+                           line.substr(7);
+                }
+                os << line << "\n";
+            }
+        }
+        os << "Shared prefix: " << m_branchAt.GetSeconds() << " s simulated in " << m_prefixWall
+           << " s; " << m_branches.size() << " branches in " << m_branchWall << " s\n";
+    }
+
+  private:
+    void Fork()
+    {
+        m_prefixWall =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        auto start = std::chrono::steady_clock::now();
+
+        ProcessPool pool(m_jobs);
+        long branch = pool.Fork(m_branches.size(), [this](size_t i, const ProcessResult& r) {
+            m_branches[i].result = r;
+        });
+        if (branch >= 0)
+        {
+            m_branch = branch;
+            m_branches[branch].apply();
+            return;
+        }
+
+        m_branchWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        m_parent = true;
+        Simulator::Stop();
+    }
+
+    std::vector<Branch> m_branches;
+    Time m_branchAt;
+    unsigned m_jobs = 0;
+    bool m_parent = false;
+    long m_branch = -1;
+    std::chrono::steady_clock::time_point m_start;
+    double m_prefixWall = 0;
+    double m_branchWall = 0;
+};
+
+} // namespace ns3
+
+#endif /* WARM_START_H */
@@ -0,0 +1,431 @@
+/*
+ * Condition watchpoints on trace sources.
+ *
+ * A watchpoint fires the first time its predicate holds and then runs its
+ * actions, in this order:
+ *
+ *    snapshot   runs the snapshot callback into a buffer printed later
+ *    quiet      runs the quiet callback, e.g. to switch off NetAnim and
+ *               FlowMonitor for the rest of the run
+ *    stop       Simulator::Stop() after the current event
+ *
+ * Predicates:
+ *
+ *    OnFirstDrop(qdisc)           any drop in the queue disc
+ *    OnQueueAbove(qdisc, n)       more than n packets queued
+ *    OnCwndBelow(node, bytes, t)  a TCP socket of the node, followed from
+ *                                 t on, falls below bytes after that same
+ *                                 socket was at or above it; sockets
+ *                                 opened later are picked up every 100 ms
+ *    OnCount<Args...>(obj, source, n)  n firings of any trace source
+ *
+ * Scenarios take watchpoints as "predicate[=value][:action,action]" specs
+ * separated by ';', see Parse(). Search-style runs then end as soon as the
+ * answer is known, and a driver such as threshold-bisect reads the
+ * SUMMARY scope=watch lines.
+ *
+ * Usage:
+ *    Watchpoints watch;
+ *    watch.SetSnapshot([&](std::ostream& os) { queues.Print(os); });
+ *    watch.SetQuiet([&]() { anim.StopRecording(); });
+ *    watch.OnFirstDrop(qdisc).Then("snapshot,stop");
+ *    Simulator::Run();
+ *    watch.Print(std::cout);
+ *    watch.PrintSummary(std::cout);       // SUMMARY scope=watch ...
+ */
+
+#ifndef WATCHPOINT_H
+#define WATCHPOINT_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <functional>
+#include <list>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class Watchpoints;
+
+class Watchpoint
+{
+  public:
+    Watchpoint(Watchpoints* owner, const std::string& name)
+        : m_owner(owner),
+          m_name(name)
+    {
+    }
+
+    // Comma-separated subset of snapshot,quiet,stop
+    Watchpoint& Then(const std::string& actions)
+    {
+        std::istringstream in(actions);
+        std::string a;
+        while (std::getline(in, a, ','))
+        {
+            if (a == "snapshot")
+            {
+                m_snapshot = true;
+            }
+            else if (a == "quiet")
+            {
+                m_quiet = true;
+            }
+            else if (a == "stop")
+            {
+                m_stop = true;
+            }
+            else
+            {
+                NS_ABORT_MSG_IF(!a.empty(), "Unknown watchpoint action " << a);
+            }
+        }
+        return *this;
+    }
+
+    // Extra action, run after snapshot and quiet
+    Watchpoint& Then(const std::function<void()>& action)
+    {
+        m_actions.push_back(action);
+        return *this;
+    }
+
+    const std::string& GetName() const
+    {
+        return m_name;
+    }
+
+    bool IsHit() const
+    {
+        return m_hit;
+    }
+
+    Time GetTime() const
+    {
+        return m_time;
+    }
+
+    // Value that made the predicate true (drops, packets, bytes, count)
+    double GetValue() const
+    {
+        return m_value;
+    }
+
+    const std::string& GetSnapshot() const
+    {
+        return m_snapshotText;
+    }
+
+    // Fires the watchpoint; later calls do nothing
+    void Hit(double value);
+
+  private:
+    friend class Watchpoints;
+
+    void QueueDrop(Ptr<const QueueDiscItem> item)
+    {
+        Hit(++m_count);
+    }
+
+    void QueueEnqueue(Ptr<const QueueDiscItem> item)
+    {
+        if (m_qdisc->GetNPackets() > m_threshold)
+        {
+            Hit(m_qdisc->GetNPackets());
+        }
+    }
+
+    // One socket followed by a cwndBelow watchpoint
+    struct CwndSocket
+    {
+        Watchpoint* watch;
+        bool armed = false;
+
+        void Cwnd(uint32_t oldValue, uint32_t newValue)
+        {
+            if (newValue >= watch->m_threshold)
+            {
+                armed = true;
+            }
+            else if (armed)
+            {
+                watch->Hit(newValue);
+            }
+        }
+    };
+
+    template <typename... Args>
+    void Count(Args...)
+    {
+        if (++m_count >= m_threshold)
+        {
+            Hit(m_count);
+        }
+    }
+
+    Watchpoints* m_owner;
+    std::string m_name;
+    bool m_snapshot = false;
+    bool m_quiet = false;
+    bool m_stop = false;
+    std::vector<std::function<void()>> m_actions;
+
+    Ptr<QueueDisc> m_qdisc;
+    std::string m_source; // trace source on m_qdisc
+    uint64_t m_threshold = 0;
+    uint64_t m_count = 0;
+    Ptr<Node> m_node;
+    std::set<Ptr<Socket>> m_connected; // held, so a new socket never reuses an address
+    std::list<CwndSocket> m_sockets;   // stable addresses for the bound callbacks
+
+    bool m_hit = false;
+    Time m_time;
+    double m_value = 0;
+    std::string m_snapshotText;
+};
+
+class Watchpoints
+{
+  public:
+    // One "predicate[=value][:actions]" item of a --watch option
+    struct Spec
+    {
+        std::string predicate;
+        double value = 0;
+        std::string actions;
+    };
+
+    static std::vector<Spec> Parse(const std::string& list)
+    {
+        std::vector<Spec> specs;
+        std::istringstream in(list);
+        std::string item;
+        while (std::getline(in, item, ';'))
+        {
+            if (item.empty())
+            {
+                continue;
+            }
+            Spec s;
+            size_t colon = item.find(':');
+            if (colon != std::string::npos)
+            {
+                s.actions = item.substr(colon + 1);
+                item = item.substr(0, colon);
+            }
+            size_t eq = item.find('=');
+            s.predicate = item.substr(0, eq);
+            if (eq != std::string::npos)
+            {
+                s.value = std::stod(item.substr(eq + 1));
+            }
+            specs.push_back(s);
+        }
+        return specs;
+    }
+
+    // Output of the snapshot action
+    void SetSnapshot(const std::function<void(std::ostream&)>& snapshot)
+    {
+        m_snapshot = snapshot;
+    }
+
+    // Run by the quiet action
+    void SetQuiet(const std::function<void()>& quiet)
+    {
+        m_quiet = quiet;
+    }
+
+    Watchpoint& OnFirstDrop(Ptr<QueueDisc> qdisc, const std::string& name = "firstDrop")
+    {
+        Watchpoint& w = Add(name);
+        w.m_qdisc = qdisc;
+        w.m_source = "Drop";
+        ConnectQueue(w);
+        return w;
+    }
+
+    Watchpoint& OnQueueAbove(Ptr<QueueDisc> qdisc, uint32_t packets,
+                             const std::string& name = "queueAbove")
+    {
+        Watchpoint& w = Add(name);
+        w.m_qdisc = qdisc;
+        w.m_source = "Enqueue";
+        w.m_threshold = packets;
+        ConnectQueue(w);
+        return w;
+    }
+
+    // Moves the queue disc watchpoints from one disc to its replacement,
+    // e.g. after ReplaceRootQueueDisc(); counts and hits carry over
+    void MoveQueueDisc(Ptr<QueueDisc> from, Ptr<QueueDisc> to)
+    {
+        for (Watchpoint& w : m_watches)
+        {
+            if (w.m_qdisc && w.m_qdisc == from)
+            {
+                w.m_qdisc = to;
+                ConnectQueue(w);
+            }
+        }
+    }
+
+    // Sockets exist once the applications start, so they are looked up from
+    // armAt on, and again every 100 ms until the watchpoint fires
+    Watchpoint& OnCwndBelow(Ptr<Node> node, uint32_t bytes, Time armAt,
+                            const std::string& name = "cwndBelow")
+    {
+        Watchpoint& w = Add(name);
+        w.m_threshold = bytes;
+        w.m_node = node;
+        Simulator::Schedule(armAt - Simulator::Now(), &Watchpoints::ScanCwnd, &w);
+        return w;
+    }
+
+    // Fires on the n-th call of a trace source with signature void(Args...)
+    template <typename... Args>
+    Watchpoint& OnCount(Ptr<Object> object, const std::string& source, uint64_t n,
+                        const std::string& name)
+    {
+        Watchpoint& w = Add(name);
+        w.m_threshold = n;
+        object->TraceConnectWithoutContext(
+            source, MakeCallback(&Watchpoint::template Count<Args...>, &w));
+        return w;
+    }
+
+    // For predicates checked by the scenario itself; call Hit() on it
+    Watchpoint& Add(const std::string& name)
+    {
+        m_watches.emplace_back(this, name);
+        return m_watches.back();
+    }
+
+    bool AnyHit() const
+    {
+        for (const Watchpoint& w : m_watches)
+        {
+            if (w.IsHit())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Print(std::ostream& os) const
+    {
+        for (const Watchpoint& w : m_watches)
+        {
+            os << "Watch " << w.GetName() << ": ";
+            if (!w.IsHit())
+            {
+                os << "not hit\n";
+                continue;
+            }
+            os << "hit at " << w.GetTime().GetSeconds() << " s (value " << w.GetValue() << ")\n"
+               << w.GetSnapshot();
+        }
+    }
+
+    void PrintSummary(std::ostream& os) const
+    {
+        for (const Watchpoint& w : m_watches)
+        {
+            os << "SUMMARY scope=watch name=" << w.GetName()
+               << " hit=" << w.IsHit()
+               << " time=" << (w.IsHit() ? w.GetTime().GetSeconds() : -1)
+               << " value=" << w.GetValue() << "\n";
+        }
+    }
+
+  private:
+    friend class Watchpoint;
+
+    static void ConnectQueue(Watchpoint& w)
+    {
+        if (w.m_source == "Drop")
+        {
+            w.m_qdisc->TraceConnectWithoutContext("Drop", MakeCallback(&Watchpoint::QueueDrop, &w));
+        }
+        else
+        {
+            w.m_qdisc->TraceConnectWithoutContext("Enqueue",
+                                                  MakeCallback(&Watchpoint::QueueEnqueue, &w));
+        }
+    }
+
+    // Connects the node's TCP sockets not followed yet, each with its own
+    // armed state
+    static void ScanCwnd(Watchpoint* w)
+    {
+        if (w->m_hit)
+        {
+            return;
+        }
+        Ptr<TcpL4Protocol> tcp = w->m_node->GetObject<TcpL4Protocol>();
+        if (tcp)
+        {
+            ObjectVectorValue sockets;
+            tcp->GetAttribute("SocketList", sockets);
+            for (auto it = sockets.Begin(); it != sockets.End(); it++)
+            {
+                Ptr<TcpSocketBase> socket = DynamicCast<TcpSocketBase>(it->second);
+                if (socket && w->m_connected.insert(socket).second)
+                {
+                    w->m_sockets.push_back(Watchpoint::CwndSocket{w});
+                    socket->TraceConnectWithoutContext(
+                        "CongestionWindow",
+                        MakeCallback(&Watchpoint::CwndSocket::Cwnd, &w->m_sockets.back()));
+                }
+            }
+        }
+        Simulator::Schedule(MilliSeconds(100), &Watchpoints::ScanCwnd, w);
+    }
+
+    std::list<Watchpoint> m_watches; // stable addresses for the bound callbacks
+    std::function<void(std::ostream&)> m_snapshot;
+    std::function<void()> m_quiet;
+};
+
+inline void
+Watchpoint::Hit(double value)
+{
+    if (m_hit)
+    {
+        return;
+    }
+    m_hit = true;
+    m_time = Simulator::Now();
+    m_value = value;
+    if (m_snapshot && m_owner->m_snapshot)
+    {
+        std::ostringstream os;
+        m_owner->m_snapshot(os);
+        m_snapshotText = os.str();
+    }
+    if (m_quiet && m_owner->m_quiet)
+    {
+        m_owner->m_quiet();
+    }
+    for (const std::function<void()>& action : m_actions)
+    {
+        action();
+    }
+    if (m_stop)
+    {
+        Simulator::Stop();
+    }
+}
+
+} // namespace ns3
+
+#endif /* WATCHPOINT_H */